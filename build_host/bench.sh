@@ -0,0 +1,66 @@
+#!/bin/sh
+# Cross-FTL benchmark on the host simulator
+#
+# Builds every FTL with CAPACITY=reduced (2GB drive, so that garbage collection starts within a short run),
+# runs the same workload matrix against each of them and prints one table:
+# throughput, write amplification, block erases and tail latency (99th and 99.9th percentile of all commands).
+#
+#	seqfill		sequential 128KB writes over the lba range
+#	rand4k		4KB random overwrite of the preconditioned (filled) range
+#	mixed		4KB random, 70% reads and 30% writes, preconditioned
+#	hotcold		4KB random writes, 80% of them to 20% of the range, preconditioned
+#	zoneseq		sequential 32KB writes into 4 zones at a time
+#
+# usage: ./bench.sh [ftl ...]		(default: greedy_backup cb dac faster tutorial zns)
+#        BENCH_CMDS=n ./bench.sh	(commands per random workload, default 100000)
+#
+# ftl_zns accepts random writes only in its conventional (page-mapped) zones at the beginning of the drive.
+# Its random workloads run on that area, and its sequential workloads on the zones after it.
+# A workload that the FTL cannot complete is reported as "failed" (assertion) or "halted" (the FTL stopped,
+# e.g. ftl_tutorial without garbage collection when the drive is full).
+
+set -u
+cd "$(dirname "$0")"
+
+FTLS=${*:-"greedy_backup cb dac faster tutorial zns"}
+CMDS=${BENCH_CMDS:-100000}
+RANGE=1048576		# 512MB
+ZNS_CONV=393216		# 6 conventional zones of ftl_zns
+
+printf "%-14s %-8s %9s %8s %7s %7s %10s %10s\n" ftl workload "MB/s" IOPS WAF erases p99_us p99.9_us
+
+for ftl in $FTLS; do
+	if ! make -s FTL=$ftl CAPACITY=reduced >/dev/null 2>&1; then
+		printf "%-14s build failed\n" $ftl
+		continue
+	fi
+
+	if [ $ftl = zns ]; then
+		rand="-l 0 -r $ZNS_CONV"
+		seq="-l $ZNS_CONV -r $RANGE"
+	else
+		rand="-l 0 -r $RANGE"
+		seq="$rand"
+	fi
+
+	for wl in seqfill rand4k mixed hotcold zoneseq; do
+		case $wl in
+			seqfill)	args="-w seqwrite -s 256 -n $((RANGE / 256)) $seq" ;;
+			rand4k)		args="-P -w randwrite -s 8 -n $CMDS $rand" ;;
+			mixed)		args="-P -w mixed -p 70 -s 8 -n $CMDS $rand" ;;
+			hotcold)	args="-P -w hotcold -s 8 -n $CMDS $rand" ;;
+			zoneseq)	args="-w zoneseq -s 64 -n $((RANGE / 64)) $seq" ;;
+		esac
+
+		{ out=$(./jasmine_sim_${ftl}_reduced -b $args); rc=$?; } 2>/dev/null
+
+		if [ $rc -eq 0 ]; then
+			echo "$out" | grep '^bench' | awk -F'\t' -v ftl=$ftl -v wl=$wl \
+				'{ printf "%-14s %-8s %9s %8s %7s %7s %10s %10s\n", ftl, wl, $4, $5, $6, $7, $8, $9 }'
+		elif [ $rc -eq 3 ]; then
+			printf "%-14s %-8s %9s\n" $ftl $wl halted
+		else
+			printf "%-14s %-8s %9s\n" $ftl $wl failed
+		fi
+	done
+done
@@ -38,7 +38,7 @@
 #define NUM_TEMP_BUFFERS	1
 
 #define DRAM_BYTES_OTHER	((NUM_COPY_BUFFERS + NUM_FTL_BUFFERS + NUM_HIL_BUFFERS + NUM_TEMP_BUFFERS) * BYTES_PER_PAGE \
-+ BAD_BLK_BMP_BYTES + PAGE_MAP_BYTES + VCOUNT_BYTES + AGE_BYTES)
++ BAD_BLK_BMP_BYTES + PAGE_MAP_BYTES + VCOUNT_BYTES + AGE_BYTES + FLASH_TRACE_BYTES)
 
 #define WR_BUF_PTR(BUF_ID)	(WR_BUF_ADDR + ((UINT32)(BUF_ID)) * BYTES_PER_PAGE)
 #define WR_BUF_ID(BUF_PTR)	((((UINT32)BUF_PTR) - WR_BUF_ADDR) / BYTES_PER_PAGE)
@@ -83,6 +83,8 @@
 #define AGE_ADDR			(VCOUNT_ADDR + VCOUNT_BYTES)
 #define AGE_BYTES			((NUM_BANKS * VBLKS_PER_BANK * sizeof(UINT32) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
 
+#define FLASH_TRACE_ADDR	(AGE_ADDR + AGE_BYTES)		// ring of issued flash commands (see ftl_stat.h)
+
 // #define BLKS_PER_BANK		VBLKS_PER_BANK
 
 
@@ -96,5 +98,6 @@ void ftl_write(UINT32 const lba, UINT32 const num_sectors);
 void ftl_test_write(UINT32 const lba, UINT32 const num_sectors);
 void ftl_flush(void);
 void ftl_isr(void);
+BOOL32 ftl_idle(void);
 
 #endif //FTL_H
@@ -121,7 +121,7 @@ UINT32 				  g_ftl_write_buf_id;
 #define inc_global_age(bank)    (g_misc_meta[bank].global_age++)
 
 #define is_full_all_blks(bank)  (g_misc_meta[bank].free_blk_cnt <= NUM_REGION)
-#define inc_full_blk_cnt(bank)  (g_misc_meta[bank].free_blk_cnt--)
+#define inc_full_blk_cnt(bank)  (g_misc_meta[bank].free_blk_cnt--, ftl_stat_free_blks(bank, g_misc_meta[bank].free_blk_cnt))
 #define dec_full_blk_cnt(bank)  (g_misc_meta[bank].free_blk_cnt++)
 #define inc_mapblk_vpn(bank, mapblk_lbn)    (g_misc_meta[bank].cur_mapblk_vpn[mapblk_lbn]++)
 #define inc_miscblk_vpn(bank)               (g_misc_meta[bank].cur_miscblk_vpn++)
@@ -490,6 +490,13 @@ void ftl_flush(void)
     flush_misc_metadata();
     /* ptimer_stop_and_uart_print(); */
 }
+
+// called by Main() when there is no host command; returns FALSE when there is nothing left to do
+BOOL32 ftl_idle(void)
+{
+    return FALSE;
+}
+
 // logging misc + vcount metadata
 static void flush_misc_metadata(void)
 {
@@ -1127,7 +1134,9 @@ static UINT32 assign_new_write_vpn(UINT32 const bank, UINT32 const lpn, UINT32 c
         inc_full_blk_cnt(bank);
 
         while (is_full_all_blks(bank)) {
+            ftl_stat_gc_begin(bank);
             garbage_collection(bank);
+            ftl_stat_gc_end(bank);
         }
 
         if ((get_cur_write_vpn_of_region(bank, new_region_num) % PAGES_PER_BLK) != (PAGES_PER_BLK - 2)) {
@@ -45,7 +45,7 @@
 #define NUM_TEMP_BUFFERS	1
 
 #define DRAM_BYTES_OTHER	((NUM_COPY_BUFFERS + NUM_FTL_BUFFERS + NUM_HIL_BUFFERS + NUM_TEMP_BUFFERS) * BYTES_PER_PAGE \
-+ BAD_BLK_BMP_BYTES + PAGE_MAP_BYTES + VCOUNT_BYTES + VBLK_AGE_BYTES + VBLK_REGION_BYTES)
++ BAD_BLK_BMP_BYTES + PAGE_MAP_BYTES + VCOUNT_BYTES + VBLK_AGE_BYTES + VBLK_REGION_BYTES + FLASH_TRACE_BYTES)
 
 #define WR_BUF_PTR(BUF_ID)	(WR_BUF_ADDR + ((UINT32)(BUF_ID)) * BYTES_PER_PAGE)
 #define WR_BUF_ID(BUF_PTR)	((((UINT32)BUF_PTR) - WR_BUF_ADDR) / BYTES_PER_PAGE)
@@ -102,6 +102,8 @@
 #define VBLK_REGION_ADDR   (VBLK_AGE_ADDR + VBLK_AGE_BYTES)
 #define VBLK_REGION_BYTES  ((NUM_BANKS * VBLKS_PER_BANK * sizeof(UINT16) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
 
+#define FLASH_TRACE_ADDR	(VBLK_REGION_ADDR + VBLK_REGION_BYTES)	// ring of issued flash commands (see ftl_stat.h)
+
 
 ///////////////////////////////
 // FTL public functions
@@ -113,5 +115,6 @@ void ftl_write(UINT32 const lba, UINT32 const num_sectors);
 void ftl_test_write(UINT32 const lba, UINT32 const num_sectors);
 void ftl_flush(void);
 void ftl_isr(void);
+BOOL32 ftl_idle(void);
 
 #endif //FTL_H
@@ -98,6 +98,11 @@ void ftl_flush(void)
 {
 }
 
+BOOL32 ftl_idle(void)
+{
+	return FALSE;
+}
+
 void ftl_isr(void)
 {
 }
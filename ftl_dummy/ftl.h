@@ -31,7 +31,7 @@
 #define NUM_COPY_BUFFERS	NUM_BANKS_MAX
 #define NUM_HIL_BUFFERS		1
 
-#define DRAM_BYTES_OTHER	((NUM_COPY_BUFFERS + NUM_HIL_BUFFERS) * BYTES_PER_PAGE)
+#define DRAM_BYTES_OTHER	((NUM_COPY_BUFFERS + NUM_HIL_BUFFERS) * BYTES_PER_PAGE + FLASH_TRACE_BYTES)
 
 #define WR_BUF_PTR(BUF_ID)	(WR_BUF_ADDR + ((UINT32)(BUF_ID)) * BYTES_PER_PAGE)
 #define WR_BUF_ID(BUF_PTR)	((((UINT32)BUF_PTR) - WR_BUF_ADDR) / BYTES_PER_PAGE)
@@ -57,6 +57,8 @@
 #define HIL_BUF_ADDR		(COPY_BUF_ADDR + COPY_BUF_BYTES)					// a buffer dedicated to HIL internal purpose
 #define HIL_BUF_BYTES		(NUM_HIL_BUFFERS * BYTES_PER_PAGE)
 
+#define FLASH_TRACE_ADDR	(HIL_BUF_ADDR + HIL_BUF_BYTES)	// ring of issued flash commands (see ftl_stat.h)
+
 ///////////////////////////////
 // FTL public functions
 ///////////////////////////////
@@ -67,6 +69,7 @@ void ftl_write(UINT32 const lba, UINT32 const num_sectors);
 void ftl_test_write(UINT32 const lba, UINT32 const num_sectors);
 void ftl_flush(void);
 void ftl_isr(void);
+BOOL32 ftl_idle(void);
 
 #endif //FTL_H
 
@@ -104,7 +104,7 @@ UINT32 		  g_ftl_write_buf_id;
 #define is_full_swlog_blk(bank)             (g_misc_meta[bank].cur_write_swlog_offset == (PAGES_PER_BLK - 1))
 #define is_full_rwlog_blks(bank)            (g_misc_meta[bank].rwlog_free_blk_cnt == 0)
 #define is_full_isol_blks(bank)             (g_misc_meta[bank].isol_free_blk_cnt <= RESERV_ISOL_BLK)
-#define inc_full_rwlog_blk_cnt(bank)        (g_misc_meta[bank].rwlog_free_blk_cnt--)
+#define inc_full_rwlog_blk_cnt(bank)        (g_misc_meta[bank].rwlog_free_blk_cnt--, ftl_stat_free_blks(bank, g_misc_meta[bank].rwlog_free_blk_cnt))
 #define dec_full_rwlog_blk_cnt(bank)        (g_misc_meta[bank].rwlog_free_blk_cnt++)
 #define inc_full_isol_blk_cnt(bank)         (g_misc_meta[bank].isol_free_blk_cnt--)
 #define dec_full_isol_blk_cnt(bank)         (g_misc_meta[bank].isol_free_blk_cnt++)
@@ -514,6 +514,13 @@ void ftl_flush(void)
 
     /* ptimer_stop_and_uart_print(); */
 }
+
+// called by Main() when there is no host command; returns FALSE when there is nothing left to do
+BOOL32 ftl_idle(void)
+{
+    return FALSE;
+}
+
 // flush misc metadata into misc. block (vblock #1)
 // Assumption: the size of misc metadata is less than BYTES_PER_PAGE
 #define NUM_MISC_META_SECT   ((sizeof(misc_metadata) + sizeof(ftl_statistics) + sizeof(SHASHTBL) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR)
@@ -1133,7 +1140,9 @@ static UINT32 assign_cur_write_rwlog_lpn(UINT32 const bank)
 
         // check 'full state of rw log area'
         while (is_full_rwlog_blks(bank)) {
+            ftl_stat_gc_begin(bank);
             garbage_collection(bank);
+            ftl_stat_gc_end(bank);
         }
         if (get_cur_write_rwlog_lpn(bank) % PAGES_PER_BLK != (PAGES_PER_BLK - 2)) {
             inc_cur_write_rwlog_lpn(bank);
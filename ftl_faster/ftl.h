@@ -41,7 +41,7 @@
 #define NUM_TEMP_BUFFERS	1
 
 #define DRAM_BYTES_OTHER	((NUM_COPY_BUFFERS + NUM_FTL_BUFFERS + NUM_HIL_BUFFERS + NUM_TEMP_BUFFERS) * BYTES_PER_PAGE + BAD_BLK_BMP_BYTES \
-                             + FTL_BMT_BYTES + HASH_BUCKET_BYTES + HASH_NODE_BYTES + VC_BITMAP_BYTES + SC_BITMAP_BYTES + BLK_ERASE_CNT_BYTES)
+                             + FTL_BMT_BYTES + HASH_BUCKET_BYTES + HASH_NODE_BYTES + VC_BITMAP_BYTES + SC_BITMAP_BYTES + BLK_ERASE_CNT_BYTES + FLASH_TRACE_BYTES)
 
 #define WR_BUF_PTR(BUF_ID)	(WR_BUF_ADDR + ((UINT32)(BUF_ID)) * BYTES_PER_PAGE)
 #define WR_BUF_ID(BUF_PTR)	((((UINT32)BUF_PTR) - WR_BUF_ADDR) / BYTES_PER_PAGE)
@@ -170,6 +170,8 @@
 #define BLK_ERASE_CNT_ADDR  (SC_BITMAP_ADDR + SC_BITMAP_BYTES)
 #define BLK_ERASE_CNT_BYTES ((NUM_BANKS * VBLKS_PER_BANK * sizeof(UINT32) + DRAM_ECC_UNIT - 1) / DRAM_ECC_UNIT * DRAM_ECC_UNIT)
 
+#define FLASH_TRACE_ADDR	(BLK_ERASE_CNT_ADDR + BLK_ERASE_CNT_BYTES)	// ring of issued flash commands (see ftl_stat.h)
+
 // non-volatile metadata structure (SRAM)
 typedef struct _ftl_statistics
 {
@@ -220,5 +222,6 @@ void ftl_write(UINT32 const lba, UINT32 const num_sectors);
 void ftl_test_write(UINT32 const lba, UINT32 const num_sectors);
 void ftl_flush(void);
 void ftl_isr(void);
+BOOL32 ftl_idle(void);
 
 #endif //FTL_H
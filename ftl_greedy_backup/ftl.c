@@ -82,7 +82,7 @@ UINT32 				  g_ftl_write_buf_id;
 // macro functions
 //----------------------------------
 #define is_full_all_blks(bank)  (g_misc_meta[bank].free_blk_cnt == 1)
-#define inc_full_blk_cnt(bank)  (g_misc_meta[bank].free_blk_cnt--)
+#define inc_full_blk_cnt(bank)  (g_misc_meta[bank].free_blk_cnt--, ftl_stat_free_blks(bank, g_misc_meta[bank].free_blk_cnt))
 #define dec_full_blk_cnt(bank)  (g_misc_meta[bank].free_blk_cnt++)
 #define inc_mapblk_vpn(bank, mapblk_lbn)    (g_misc_meta[bank].cur_mapblk_vpn[mapblk_lbn]++)
 #define inc_miscblk_vpn(bank)               (g_misc_meta[bank].cur_miscblk_vpn++)
@@ -306,6 +306,13 @@ void ftl_flush(void)
     logging_misc_metadata();
     /* ptimer_stop_and_uart_print(); */
 }
+
+// called by Main() when there is no host command; returns FALSE when there is nothing left to do
+BOOL32 ftl_idle(void)
+{
+    return FALSE;
+}
+
 // Testing FTL protocol APIs
 void ftl_test_write(UINT32 const lba, UINT32 const num_sectors)
 {
@@ -578,7 +585,9 @@ static UINT32 assign_new_write_vpn(UINT32 const bank)
         // do garbage collection if necessary
         if (is_full_all_blks(bank))
         {
+            ftl_stat_gc_begin(bank);
             garbage_collection(bank);
+            ftl_stat_gc_end(bank);
             return get_cur_write_vpn(bank);
         }
         do
@@ -880,6 +889,7 @@ static void logging_misc_metadata(void)
 }
 static void logging_pmap_table(void)
 {
+    UINT32 start_time = ftl_stat_time();
     UINT32 pmap_addr  = PAGE_MAP_ADDR;
     UINT32 pmap_bytes = BYTES_PER_PAGE; // per bank
     UINT32 mapblk_vpn;
@@ -939,6 +949,8 @@ static void logging_pmap_table(void)
         }
     }
     flash_finish();
+
+    ftl_stat_lat(LAT_PMAP_LOG, start_time);
 }
 // load flushed FTL metadta
 static void load_metadata(void)
@@ -395,6 +395,12 @@ void ftl_flush(void)
 	// do nothing
 }
 
+BOOL32 ftl_idle(void)
+{
+	// nothing to do in idle time
+	return FALSE;
+}
+
 static BOOL32 is_bad_block(UINT32 const bank, UINT32 const vblk_offset)
 {
 	// The scan list, which is installed by installer.c:install_block_zero(), contains physical block offsets of initial bad blocks.
@@ -469,6 +475,8 @@ static UINT32 get_free_page(UINT32 const bank)
 		{
 			vblk_offset++;	// We have to skip bad vblocks.
 		}
+
+		ftl_stat_free_blks(bank, (vblk_offset < VBLKS_PER_BANK) ? VBLKS_PER_BANK - vblk_offset - 1 : 0);
 	}
 
 	if (vblk_offset >= VBLKS_PER_BANK)
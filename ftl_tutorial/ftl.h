@@ -34,7 +34,7 @@
 #define NUM_TEMP_BUFFERS	1
 
 #define DRAM_BYTES_OTHER	((NUM_COPY_BUFFERS + NUM_FTL_BUFFERS + NUM_HIL_BUFFERS + NUM_TEMP_BUFFERS) * BYTES_PER_PAGE \
-+ SCAN_LIST_BYTES + PAGE_MAP_BYTES)
++ SCAN_LIST_BYTES + PAGE_MAP_BYTES + FLASH_TRACE_BYTES)
 
 #define WR_BUF_PTR(BUF_ID)	(WR_BUF_ADDR + ((UINT32)(BUF_ID)) * BYTES_PER_PAGE)
 #define WR_BUF_ID(BUF_PTR)	((((UINT32)BUF_PTR) - WR_BUF_ADDR) / BYTES_PER_PAGE)
@@ -72,6 +72,8 @@
 #define PAGE_MAP_ADDR		(SCAN_LIST_ADDR + SCAN_LIST_BYTES)				// page mapping table
 #define PAGE_MAP_BYTES		((NUM_LPAGES * sizeof(UINT32) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
 
+#define FLASH_TRACE_ADDR	(PAGE_MAP_ADDR + PAGE_MAP_BYTES)	// ring of issued flash commands (see ftl_stat.h)
+
 
 ///////////////////////////////
 // FTL public functions
@@ -83,5 +85,6 @@ void ftl_write(UINT32 const lba, UINT32 const num_sectors);
 void ftl_test_write(UINT32 const lba, UINT32 const num_sectors);
 void ftl_flush(void);
 void ftl_isr(void);
+BOOL32 ftl_idle(void);
 
 #endif //FTL_H
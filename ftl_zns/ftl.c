@@ -33,12 +33,29 @@
 #define VC_MAX              0xCDCD
 #define MISCBLK_VBN         0x1 // vblock #1 <- misc metadata
 #define MAPBLKS_PER_BANK    (((PAGE_MAP_BYTES / NUM_BANKS) + BYTES_PER_PAGE - 1) / BYTES_PER_PAGE)
-#define META_BLKS_PER_BANK  (1 + 1 + MAPBLKS_PER_BANK) // include block #0, misc block
+#define ZONEMETA_BLKS_PER_BANK  2 // zone metadata checkpoints, the two blocks are used in turn
+#define META_BLKS_PER_BANK  (1 + 1 + MAPBLKS_PER_BANK + ZONEMETA_BLKS_PER_BANK) // include block #0, misc block
+#define CONV_FBGS           ((PAGE_MAP_ENTRIES + NUM_BANKS * PAGES_PER_BLK - 1) / (NUM_BANKS * PAGES_PER_BLK))
+#define RAND_WRITE_FBGS     (CONV_FBGS + CONV_FBGS / 8 + 1)   // free block groups reserved for page-mapped random writes
+#define NO_ZONE_BUF         INVALID8
+#define ZONE_BUF_RESERVE    (NUM_ZONE_BUFFERS / 8)  // free pool buffers that ftl_idle() keeps by spilling the least recently written ones
+#define ZONE_SPILL_LPN(ZONE)    (CONV_LPAGES + (ZONE) - NUM_CONV_ZONES)  // page map entry of the spilled partial page of a zone (past the conventional zones)
+#define NO_TL_SLOT          INVALID8
+#define ZONE_FCG(ZONE)      ((ZONE) % NUM_FCG)  // flash channel group of a zone (see DEG_ZONE in ftl.h)
+#define ZONE_BANK(ZONE, PAGE) (ZONE_FCG(ZONE) * DEG_ZONE + (PAGE) % DEG_ZONE)  // bank of zone page PAGE (PAGE / DEG_ZONE is its page offset)
+#define FBQ(FCG)            (FBQ_ADDR + (FCG) * NBLK * sizeof(UINT32))  // free block group queue of an FCG
+#define ZONE_CACHE_SIZE     64  // entries of the zone descriptor cache (a power of two, zone n goes to entry n % ZONE_CACHE_SIZE)
 
 // the number of sectors of misc. metadata info.
 #define NUM_MISC_META_SECT  ((sizeof(misc_metadata) + BYTES_PER_SECTOR - 1)/ BYTES_PER_SECTOR)
 #define NUM_VCOUNT_SECT     ((VBLKS_PER_BANK * sizeof(UINT16) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR)
 
+// page i of a zone metadata checkpoint is in bank (i % NUM_BANKS), so a checkpoint takes this many pages of each bank
+#define ZONEMETA_PAGES_PER_BANK ((ZONE_META_PAGES + NUM_BANKS - 1) / NUM_BANKS)
+#define ZONE_META_SIGNATURE     0x4D5A4A46 // "FJZM"
+#define ZONE_META_VERSION       6          // a checkpoint of another layout is not loaded (the drive is formatted)
+#define ZONE_TAIL_SIGNATURE     0x545A4A46 // "FJZT"
+
 //----------------------------------
 // metadata structure
 //----------------------------------
@@ -53,21 +70,88 @@ typedef struct _ftl_statistics
 
 typedef struct _misc_metadata
 {
+    UINT32 num_conv_zones; // NUM_CONV_ZONES of the firmware that formatted the drive
+    UINT32 deg_zone; // and its DEG_ZONE
     UINT32 cur_write_vpn; // physical page for new write
     UINT32 cur_miscblk_vpn; // current write vpn for logging the misc. metadata
     UINT32 cur_mapblk_vpn[MAPBLKS_PER_BANK]; // current write vpn for logging the age mapping info.
     UINT32 gc_vblock; // vblock number for garbage collection
     UINT32 free_blk_cnt; // total number of free block count
     UINT32 lpn_list_of_cur_vblock[PAGES_PER_BLK]; // logging lpn list of current write vblock for GC
+    UINT32 zonemeta_vbn[ZONEMETA_BLKS_PER_BANK]; // zone metadata blocks
 }misc_metadata; // per bank
 
+// a TL_OPEN zone, whose valid page bitmap is TL_BITMAP() of the same slot
+typedef struct _tl_zone
+{
+    UINT32 zone; // INVALID32 if the slot is free
+    UINT32 wp; // TL write pointer, in sectors from the start of the zone
+    UINT32 dest_vblk; // block group that receives the pages
+}tl_zone;
+
+// the first bytes of a zone metadata checkpoint (ZONE_META_HDR_ADDR)
+typedef struct _zone_meta_header
+{
+    UINT32 signature;
+    UINT32 version;
+    UINT32 seq; // incremented at each checkpoint
+    UINT32 fbq_rp[NUM_FCG], fbq_wp[NUM_FCG]; // g_fbq_rp, g_fbq_wp
+    UINT32 erase_q_rp, erase_q_wp; // g_erase_q_rp, g_erase_q_wp
+    UINT32 open_id_rp, open_id_wp; // rp_open, wp_open
+    UINT32 num_open_zones; // OPEN_ZONE
+    UINT32 rand_write_blks;
+    tl_zone tl[NUM_TL_ZONES]; // g_tl_zone
+}zone_meta_header;
+
+// SRAM copy of the descriptor of a recently used zone (see get_zone_desc_cache())
+// The state, block group and open zone id are written through to DRAM, since they change only when
+// a zone is opened, filled or reset and mem_search_equ_dram() looks for TL_OPEN zones in ZONE_STATE_ADDR.
+// The write pointer moves with every sector and is written back when the entry is evicted or checkpointed.
+typedef struct _zone_desc_cache
+{
+    UINT32 zone; // INVALID32 if the entry is empty
+    UINT32 wp;
+    UINT32 fbg;
+    UINT8  state;
+    UINT8  open_id;
+    UINT8  wp_dirty; // wp has not been written to ZONE_WP_ADDR
+    UINT8  reserved;
+}zone_desc_cache;
+
+// last sector of a spilled partial page (see write_zone_tail()), which is past the write pointer of its zone
+typedef struct _zone_tail
+{
+    UINT32 signature; // ZONE_TAIL_SIGNATURE
+    UINT32 zone;
+    UINT32 fbg; // block group that the page is to be programmed to
+    UINT32 wp; // sectors written from the start of the zone (the TL write pointer of a TL_OPEN zone)
+}zone_tail;
+
 //----------------------------------
 // FTL metadata (maintain in SRAM)
 //----------------------------------
 static misc_metadata  g_misc_meta[NUM_BANKS];
 static ftl_statistics g_ftl_statistics[NUM_BANKS];
 static UINT32		  g_bad_blk_count[NUM_BANKS];
-UINT32 rp,wp;
+static UINT32		  g_zonemeta_blk; // zone metadata block being written (0 ~ ZONEMETA_BLKS_PER_BANK - 1)
+static UINT32		  g_zonemeta_page; // page offset of the next checkpoint in it
+static UINT32		  g_zonemeta_seq; // sequence number of the last checkpoint
+static UINT32		  g_erase_q_rp, g_erase_q_wp; // erase queue (ERASE_Q_ADDR): block groups waiting for their erase
+static zone_append_hdr_t g_zone_append_hdr; // header of the zone append log, copied to ZONE_APPEND_ADDR
+static zone_append_hdr_t g_simple_copy_hdr; // header of the simple copy log, copied to SIMPLE_COPY_ADDR
+static UINT8		  g_zone_buf_of[MAX_OPEN_ZONE]; // pool buffer (ZONE_BUF()) of each open zone id, NO_ZONE_BUF if none
+static UINT8		  g_zone_buf_owner[NUM_ZONE_BUFFERS]; // open zone id of each pool buffer, NO_ZONE_BUF if free
+static UINT32		  g_zone_buf_time[NUM_ZONE_BUFFERS]; // g_zone_buf_clock at the last write to each pool buffer
+static BOOL8		  g_zone_buf_dirty[NUM_ZONE_BUFFERS]; // written since its partial page was last spilled (see ftl_flush())
+static UINT32		  g_zone_buf_clock;
+static UINT32		  g_num_free_zone_bufs;
+static UINT16		  g_open_zone_of[MAX_OPEN_ZONE]; // zone of each open zone id, INVALID16 if the id is free
+static UINT32		  g_open_zone_time[MAX_OPEN_ZONE]; // g_open_zone_clock at the last write to the zone of each open zone id
+static UINT32		  g_open_zone_clock;
+static zone_desc_cache g_zone_cache[ZONE_CACHE_SIZE];
+static tl_zone		  g_tl_zone[NUM_TL_ZONES];
+static UINT8		  g_tl_slot_of[MAX_OPEN_ZONE]; // TL slot of each open zone id, NO_TL_SLOT if none
+UINT32 g_fbq_rp[NUM_FCG], g_fbq_wp[NUM_FCG]; // free block group queue of each FCG (FBQ())
 UINT32 wp_open, rp_open;
 UINT32 wp_tlopen, rp_tlopen;
 UINT32 OPEN_ZONE;
@@ -82,15 +166,16 @@ UINT32 				  g_ftl_write_buf_id;
 //----------------------------------
 // block #0: scan list, firmware binary image, etc.
 // block #1: FTL misc. metadata
-// block #2 ~ #31: page mapping table
-// block #32: a free block for gc
-// block #33~: user data blocks
+// block #2 ~ : page mapping table (MAPBLKS_PER_BANK blocks, one with the default NUM_CONV_ZONES)
+// next 2 blocks: zone metadata checkpoints
+// next block: a free block for gc
+// the rest: user data blocks (page-mapped conventional area, then the free block groups of the zones)
 
 //----------------------------------
 // macro functions
 //----------------------------------
 #define is_full_all_blks(bank)  (g_misc_meta[bank].free_blk_cnt == 1)
-#define inc_full_blk_cnt(bank)  (g_misc_meta[bank].free_blk_cnt--)
+#define inc_full_blk_cnt(bank)  (g_misc_meta[bank].free_blk_cnt--, ftl_stat_free_blks(bank, g_misc_meta[bank].free_blk_cnt))
 #define dec_full_blk_cnt(bank)  (g_misc_meta[bank].free_blk_cnt++)
 #define inc_mapblk_vpn(bank, mapblk_lbn)    (g_misc_meta[bank].cur_mapblk_vpn[mapblk_lbn]++)
 #define inc_miscblk_vpn(bank)               (g_misc_meta[bank].cur_miscblk_vpn++)
@@ -108,7 +193,9 @@ UINT32 				  g_ftl_write_buf_id;
 #define set_miscblk_vpn(bank, vpn)    (g_misc_meta[bank].cur_miscblk_vpn = vpn)
 #define get_mapblk_vpn(bank, mapblk_lbn)      (g_misc_meta[bank].cur_mapblk_vpn[mapblk_lbn])
 #define set_mapblk_vpn(bank, mapblk_lbn, vpn) (g_misc_meta[bank].cur_mapblk_vpn[mapblk_lbn] = vpn)
-#define CHECK_LPAGE(lpn)              ASSERT((lpn) < NUM_LPAGES)
+#define get_zonemeta_vbn(bank, i)             (g_misc_meta[bank].zonemeta_vbn[i])
+#define set_zonemeta_vbn(bank, i, vblock)     (g_misc_meta[bank].zonemeta_vbn[i] = vblock)
+#define CHECK_LPAGE(lpn)              ASSERT((lpn) < PAGE_MAP_ENTRIES)
 #define CHECK_VPAGE(vpn)              ASSERT((vpn) < (rand_write_blks * PAGES_PER_BLK))
 
 //----------------------------------
@@ -120,9 +207,11 @@ static void   sanity_check(void);
 static void   load_pmap_table(void);
 static void   load_misc_metadata(void);
 static void   init_metadata_sram(void);
-static void   load_metadata(void);
+static BOOL32 load_metadata(void);
+static BOOL32 load_zone_metadata(void);
 static void   logging_pmap_table(void);
 static void   logging_misc_metadata(void);
+static void   logging_zone_metadata(void);
 static void   write_page(UINT32 const lpn, UINT32 const sect_offset, UINT32 const num_sectors);
 static void   set_vpn(UINT32 const lpn, UINT32 const vpn);
 static void   garbage_collection(UINT32 const bank);
@@ -133,50 +222,96 @@ static UINT32 get_vcount(UINT32 const bank, UINT32 const vblock);
 static UINT32 get_vpn(UINT32 const lpn);
 static UINT32 get_vt_vblock(UINT32 const bank);
 static UINT32 assign_new_write_vpn(UINT32 const bank);
+static void   next_write_vblock(UINT32 const bank);
+static void   roll_forward_write_vpn(void);
+static BOOL32 is_page_erased(UINT32 const bank, UINT32 const vblk, UINT32 const page_num);
 static void zns_read(UINT32 const start_lba, UINT32 const num_sectors, UINT32 const read_buffer_addr);
-static void zns_read_internal(UINT32 const start_lba, UINT32 const num_sectors, UINT32 const read_buffer_addr);
-static void zns_write(UINT32 const start_lba, UINT32 const num_sectors, UINT32 const write_buffer_addr);
-static void zns_write_internal(UINT32 const start_lba, UINT32 const num_sectors, UINT32 const write_buffer_addr);
+static void zns_read_unprogrammed(UINT32 const bank, UINT32 const vblk, UINT32 const p_offset, UINT32 const zone,
+                                  UINT32 const buffered, UINT32 const sect_offset, UINT32 const num_sectors);
+static void zns_write(UINT32 const start_lba, UINT32 const num_sectors);
+static void zns_append(UINT32 const zslba, UINT32 const num_sectors);
+static void zns_append_log(UINT32 const zslba, UINT32 const lba, UINT32 const num_sectors, UINT32 const status);
+static void init_zone_append_log(void);
+static void simple_copy_log(simple_copy_t const* const entry);
+static void init_simple_copy_log(void);
+static void zns_page_program(UINT32 const bank, UINT32 const vblk, UINT32 const page_num, UINT32 const buf_addr);
+static void release_write_buf(void);
+static void release_write_bufs(UINT32 const num_bufs);
+static void set_zone_full(UINT32 zone_number);
+static void init_zone_bufs(void);
+static UINT32 get_zone_buf(UINT32 const zone);
+static void put_zone_buf(UINT8 const open_id);
+static void drop_zone_buf(UINT32 const zone);
+static UINT32 alloc_zone_buf(void);
+static void spill_zone_buf(UINT32 const idx);
+static void write_zone_tail(UINT32 const idx);
+static UINT32 load_zone_tail(UINT32 const zone, UINT32 const vblk, UINT32 const num_pages);
+static UINT32 lru_zone_buf(void);
+static void write_page_dram(UINT32 const lpn, UINT32 const buf_addr);
+static void trim_page(UINT32 const lpn);
 static void zns_init(void);
-static void zns_get_desc(UINT32 c_zone, UINT32 nzone);
+static void zns_format(void);
+static BOOL32 is_zone_page_erased(UINT32 const fcg, UINT32 const vblk, UINT32 const page_idx);
+static UINT32 find_zone_page_wp(UINT32 const fcg, UINT32 const vblk, UINT32 const page_idx);
+static void zns_report_zones(UINT32 const cmd, UINT32 const locator, UINT32 const num_sectors);
+static UINT32 get_zone_report_state(UINT32 const zone);
+static BOOL32 is_reported_zone(UINT32 const zone, UINT32 const filter);
+static void get_zone_desc(UINT32 const zone, zac_zone_desc_t* const desc);
+static void get_zone_report_desc(UINT32 const zone, zone_report_desc_t* const desc);
+static void zns_payload_cmd(UINT32 const cmd, UINT32 const zslba, UINT32 const num_sectors);
+static BOOL32 is_seq_zone_start(UINT32 const zslba);
+static BOOL32 open_zone(UINT32 const zone);
+static void close_zone(UINT32 const zone);
+static BOOL32 finish_zone(UINT32 const zone);
+static UINT32 lru_open_zone(void);
+static void map_open_zones(void);
+static void reset_zone(UINT32 const zone);
+static BOOL32 zone_mgmt_all(UINT32 const action);
 static UINT8 get_zone_state(UINT32 zone_number);
 static void set_zone_state(UINT32 zone_number, UINT8 state);
 static UINT32 get_zone_wp(UINT32 zone_number);
 static void set_zone_wp(UINT32 zone_number, UINT32 wp);
 static UINT32 get_zone_slba(UINT32 zone_number);
-static void set_zone_slba(UINT32 zone_number, UINT32 slba);
-static UINT32 get_buffer_sector(UINT32 zone_number, UINT32 sector_offset);
-static void set_buffer_sector(UINT32 zone_number, UINT32 sector_offset, UINT32 data);
+static zone_desc_cache* get_zone_desc_cache(UINT32 const zone);
+static void init_zone_cache(void);
+static void flush_zone_cache(void);
 static UINT32 get_zone_to_FBG(UINT32 zone_number);
 static void set_zone_to_FBG(UINT32 zone_number, int FBG);
-static void enqueue_FBG(UINT32 block_num);
-static UINT32 dequeue_FBG(void);
-static void zns_reset(UINT32 c_zone);
+static void enqueue_FBG(UINT32 const fcg, UINT32 block_num);
+static UINT32 dequeue_FBG(UINT32 const fcg);
+static void enqueue_erase(UINT32 const fcg, UINT32 block_num);
+static BOOL32 erase_pending_FBG(BOOL32 const wait);
+static BOOL32 zns_reset(UINT32 c_zone);
 static void search_bad_blk_zone(void);
+static BOOL32 is_good_block_group(UINT32 const first_bank, UINT32 const num_banks, UINT32 const vblk);
 static void enqueue_open_id(UINT8 open_zone_id);
 static UINT8 dequeue_open_id(void); 
 static UINT8 get_zone_to_ID(UINT32 zone_number);
 static void set_zone_to_ID(UINT32 zone_number, UINT8 id);
 
 static void zns_izc(UINT32 src_zone, UINT32 dest_zone, UINT32 copy_len, UINT32 izc_addr);
-static UINT8 get_TL_bitmap(UINT32 zone_number, UINT32 page_offset);
-static void set_TL_bitmap(UINT32 zone_number, UINT32 page_offset, UINT8 data);
+static void zns_simple_copy(UINT32 const dest_zone, UINT32 const range_addr, UINT32 const num_ranges);
+static UINT32 get_zone_programmed_pages(UINT32 const zone);
+static void copy_zone_pages(UINT32 const dest_zone, UINT32 const copy_len, UINT32 const copy_addr);
+static void zns_tl_open(UINT32 zone, UINT32 tl_addr);
+static UINT32 get_tl_slot(UINT32 const zone);
+static void map_tl_slots(void);
+static UINT32 find_TL_page(UINT32 const zone, UINT32 page_offset, UINT32 const val);
 static UINT32 get_TL_wp(UINT32 zone_number);
 static void set_TL_wp(UINT32 zone_number, UINT32 wp);
-static UINT32 get_TL_buffer(UINT32 zone_number, UINT32 sector_offset);
-static void set_TL_buffer(UINT32 zone_number,UINT32 sector_offset, UINT32 data);
 static UINT32 get_TL_src_to_dest_zone(UINT32 zone_number);
-static void set_TL_src_to_dest_zone(UINT32 zone_number, UINT32 num);
 
-static void fill_tl(int zone, int c_lba, int tl_num);
+static UINT32 fill_tl(UINT32 const zone, UINT32 const end_page, UINT32 const max_pages);
+static void complete_tl(UINT32 const zone);
+static UINT32 next_tl_zone(UINT32 zone);
 
 
 static void sanity_check(void)
 {
     UINT32 dram_requirement = RD_BUF_BYTES + WR_BUF_BYTES + COPY_BUF_BYTES + FTL_BUF_BYTES
-        + HIL_BUF_BYTES + TEMP_BUF_BYTES + BAD_BLK_BMP_BYTES + PAGE_MAP_BYTES + VCOUNT_BYTES
-		+ ZONE_STATE_BYTES + ZONE_WP_BYTES + ZONE_SLBA_BYTES +ZONE_BUFFER_BYTES + ZONE_TO_FBG_BYTES
-		+ FBQ_BYTES + OPEN_ZONE_Q_BYTES + ZONE_TO_ID_BYTES + IZC_BYTES + TL_INTERNAL_BUFFER_BYTES + TL_BYTES + TL_BITMAP_BYTES + TL_WP_BYTES + TL_NUM_BYTES;
+        + HIL_BUF_BYTES + TEMP_BUF_BYTES + ZONE_PROG_BUF_BYTES + BAD_BLK_BMP_BYTES + PAGE_MAP_BYTES + VCOUNT_BYTES
+		+ ZONE_STATE_BYTES + ZONE_WP_BYTES + ZONE_BUFFER_BYTES + ZONE_TO_FBG_BYTES
+		+ ZONE_META_HDR_BYTES + FBQ_BYTES + OPEN_ZONE_Q_BYTES + ZONE_TO_ID_BYTES + IZC_BYTES + TL_BYTES + TL_BITMAP_BYTES;
     
     uart_printf("DRAM_BASE: 0x%x / %u",DRAM_BASE,DRAM_BASE);
     uart_printf("COPY_BUF_ADDR: 0x%x / %u", COPY_BUF_ADDR, COPY_BUF_ADDR);
@@ -191,18 +326,21 @@ static void sanity_check(void)
     uart_printf("HIL_BUF_BYTES  : 0x%x / %u", HIL_BUF_BYTES, HIL_BUF_BYTES);
     uart_printf("TEMP_BUF_BYTES : 0x%x / %u", TEMP_BUF_BYTES, TEMP_BUF_BYTES);
     uart_printf("BAD_BLK_BMP_BYTES: 0x%x / %u", BAD_BLK_BMP_BYTES, BAD_BLK_BMP_BYTES);
+    uart_printf("NUM_CONV_ZONES: %u", NUM_CONV_ZONES);
     uart_printf("PAGE_MAP_BYTES: 0x%x / %u", PAGE_MAP_BYTES, PAGE_MAP_BYTES);
     uart_printf("VCOUNT_BYTES: 0x%x / %u", VCOUNT_BYTES, VCOUNT_BYTES);
     uart_printf("ZONE_STATE_BYTES: 0x%x / %u", ZONE_STATE_BYTES, ZONE_STATE_BYTES);
     uart_printf("ZONE_WP_BYTES: 0x%x / %u", ZONE_WP_BYTES, ZONE_WP_BYTES);
-    uart_printf("ZONE_SLBA_BYTES: 0x%x / %u", ZONE_SLBA_BYTES, ZONE_SLBA_BYTES);
     uart_printf("ZONE_BUFFER_BYTES: 0x%x / %u", ZONE_BUFFER_BYTES, ZONE_BUFFER_BYTES);
     uart_printf("ZONE_TO_FBG_BYTES: 0x%x / %u", ZONE_TO_FBG_BYTES, ZONE_TO_FBG_BYTES);
     uart_printf("FBQ_BYTES: 0x%x / %u", FBQ_BYTES, FBQ_BYTES);
+    uart_printf("ZONE_META_BYTES: 0x%x / %u", ZONE_META_BYTES, ZONE_META_BYTES);
 
 
     if ((dram_requirement > DRAM_SIZE) || // DRAM metadata size check
-        (sizeof(misc_metadata) > BYTES_PER_PAGE)) // misc metadata size check
+        (sizeof(misc_metadata) > BYTES_PER_PAGE) || // misc metadata size check
+        (sizeof(zone_meta_header) > ZONE_META_HDR_BYTES) ||
+        (CONV_SECTORS >= NUM_LSECTORS)) // at least one sequential write zone
     {
         led_blink();
         while (1);
@@ -337,6 +475,7 @@ void ftl_open(void)
 
 	led(0);
     sanity_check();
+    init_zone_cache();
     //----------------------------------------
     // read scan lists from NAND flash
     // and build bitmap of bad blocks
@@ -347,40 +486,30 @@ void ftl_open(void)
 	// If necessary, do low-level format
 	// format() should be called after loading scan lists, because format() calls is_bad_block().
     //----------------------------------------
- 	//if (check_format_mark() == FALSE) 
-	if (TRUE)
+ 	if (check_format_mark() == FALSE)
 	{
         uart_print("do format");
 		format();
         uart_print("end format");
 	}
-    // load FTL metadata
-    else
+    // load FTL metadata (a drive formatted without zone metadata checkpoints or with another NUM_CONV_ZONES is formatted again)
+    else if (load_metadata() == FALSE)
     {
-
-        load_metadata();
+        uart_print("no zone metadata, do format");
+		format();
+        uart_print("end format");
     }
 	g_ftl_read_buf_id = 0;
 	g_ftl_write_buf_id = 0;
+    init_zone_append_log();
+    init_simple_copy_log();
+    init_zone_bufs();
     // This example FTL can handle runtime bad block interrupts and read fail (uncorrectable bit errors) interrupts
     flash_clear_irq();
     SETREG(INTR_MASK, FIRQ_DATA_CORRUPT | FIRQ_BADBLK_L | FIRQ_BADBLK_H);
 	SETREG(FCONF_PAUSE, FIRQ_DATA_CORRUPT | FIRQ_BADBLK_L | FIRQ_BADBLK_H);
 	enable_irq();
-	wp = 0; rp = 0; 
-    wp_open = 0; rp_open = 0;
-	wp_tlopen = 0; rp_tlopen = 0;
-	OPEN_ZONE = 0;	
-
-    search_bad_blk_zone();
-    UINT32 zone_number = -1;
-    for (int i = 0; i < 8; i++)
-    {
-        zone_number = dequeue_FBG();
-    }
-    rand_write_blks = zone_number + 1;
 
-	zns_init();
     /****FTL 세팅값 ******/
     uart_printf("\n----------------------");
     uart_printf("NUM_LSECTORS : %d", NUM_LSECTORS);
@@ -393,34 +522,104 @@ void ftl_open(void)
     uart_printf("----------------------");
     /********************/
 }
+// the free block groups of a freshly formatted drive: from rand_write_blks on, the vblocks that are good
+// on every bank of an FCG
 void search_bad_blk_zone(void)
 {
-	UINT32 vcount , j ,i ;
-	for(j = 0; j < VBLKS_PER_BANK; j++)
+	UINT32 fcg, j;
+
+	for(fcg = 0; fcg < NUM_FCG; fcg++)
 	{
-		BOOL32 flag = TRUE;
-		for( i = 0; i < NUM_BANKS; i++)
+		for(j = rand_write_blks; j < VBLKS_PER_BANK; j++)
 		{
-			 vcount = read_dram_16(VCOUNT_ADDR + ((i * VBLKS_PER_BANK) + j) * sizeof(UINT16));
-			if(vcount == VC_MAX)
-			{				
-				flag = FALSE;
-				break;
+			if(is_good_block_group(fcg * DEG_ZONE, DEG_ZONE, j))
+			{
+				enqueue_FBG(fcg, j);
 			}
 		}
-		if(flag)
+	}
+}
+static BOOL32 is_good_block_group(UINT32 const first_bank, UINT32 const num_banks, UINT32 const vblk)
+{
+	UINT32 i;
+
+	for(i = first_bank; i < first_bank + num_banks; i++)
+	{
+		if(read_dram_16(VCOUNT_ADDR + ((i * VBLKS_PER_BANK) + vblk) * sizeof(UINT16)) == VC_MAX)
 		{
-			enqueue_FBG(j);
+			return FALSE;
 		}
 	}
+	return TRUE;
 }
+// The partial pages at the write pointers that were written since the last flush are spilled first, and keep their pool buffers.
+// The page map checkpoint then covers them, and load_metadata() puts the write pointers back on them after a power loss,
+// so a zone is not padded to a page boundary and keeps its capacity.
 void ftl_flush(void)
 {
+    UINT32 idx;
+
+    for (idx = 0; idx < NUM_ZONE_BUFFERS; idx++)
+    {
+        if (g_zone_buf_owner[idx] != NO_ZONE_BUF && g_zone_buf_dirty[idx])
+        {
+            write_zone_tail(idx);
+        }
+    }
     /* ptimer_start(); */
     logging_pmap_table();
     logging_misc_metadata();
+    logging_zone_metadata();
     /* ptimer_stop_and_uart_print(); */
 }
+
+// Idle time operations: the block groups of reset zones are erased, partial pages are spilled while the pool of open zone
+// buffers is short of ZONE_BUF_RESERVE, and the TL_OPEN zones are filled one page per bank at a time,
+// so that a host write to such a zone only waits for the copies of the pages before it.
+// returns FALSE when there is nothing left to do
+BOOL32 ftl_idle(void)
+{
+    UINT32 zone;
+
+    if (g_erase_q_rp != g_erase_q_wp)
+    {
+        erase_pending_FBG(FALSE);
+        return TRUE;
+    }
+    if (g_num_free_zone_bufs < ZONE_BUF_RESERVE)
+    {
+        spill_zone_buf(lru_zone_buf());
+        return TRUE;
+    }
+
+    for (zone = next_tl_zone(0); zone < NZONE; zone = next_tl_zone(zone + 1))
+    {
+        if (fill_tl(zone, DEG_ZONE * NPAGE, DEG_ZONE) != 0)
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+// the first TL_OPEN zone from 'zone' on, NZONE if there is none
+static UINT32 next_tl_zone(UINT32 zone)
+{
+    // the memory utility searches from a word boundary
+    while (zone % sizeof(UINT32) != 0 && zone < NZONE)
+    {
+        if (get_zone_state(zone) == ZONE_TL_OPEN)
+        {
+            return zone;
+        }
+        zone++;
+    }
+    if (zone >= NZONE)
+    {
+        return NZONE;
+    }
+    return zone + mem_search_equ_dram(ZONE_STATE_ADDR + zone, sizeof(UINT8), NZONE - zone, ZONE_TL_OPEN);
+}
 // Testing FTL protocol APIs
 void ftl_test_write(UINT32 const lba, UINT32 const num_sectors)
 {
@@ -430,12 +629,38 @@ void ftl_test_write(UINT32 const lba, UINT32 const num_sectors)
     ftl_write(lba, num_sectors);
 }
 
+// zone metadata of a freshly formatted drive (called from format())
+void zns_format(void)
+{
+	for (UINT32 fcg = 0; fcg < NUM_FCG; fcg++)
+	{
+		g_fbq_wp[fcg] = 0; g_fbq_rp[fcg] = 0;
+	}
+    wp_open = 0; rp_open = 0;
+    g_erase_q_rp = 0; g_erase_q_wp = 0;
+	wp_tlopen = 0; rp_tlopen = 0;
+	OPEN_ZONE = 0;	
+
+    // the page mapped blocks are below rand_write_blks, which leaves RAND_WRITE_FBGS vblocks good on every bank
+    UINT32 num_rand_fbgs = 0;
+    for (rand_write_blks = 0; num_rand_fbgs < RAND_WRITE_FBGS; rand_write_blks++)
+    {
+        num_rand_fbgs += is_good_block_group(0, NUM_BANKS, rand_write_blks);
+    }
+    search_bad_blk_zone();
+
+	zns_init();
+
+	g_zonemeta_blk = 0;
+	g_zonemeta_page = 0;
+	g_zonemeta_seq = 0;
+}
+
 void zns_init(void)
 {
 	for(UINT32 i = 0; i < NZONE; i++)
 	{
-		set_zone_state(i, 0);    
-		set_zone_slba(i, i * ZONE_SIZE);
+		set_zone_state(i, ZONE_EMPTY);    
 		set_zone_wp(i, i * ZONE_SIZE);
 		set_zone_to_FBG(i, -1);
 	}
@@ -444,27 +669,21 @@ void zns_init(void)
 	for(UINT8 i = 0; i < MAX_OPEN_ZONE; i++)
 	{
 		enqueue_open_id(i);
-		for(UINT32 j = 0; j < NSECT; j++)
-		{
-			set_buffer_sector(i, j, -1);
-		}
 	}
 	
-	for(UINT32 i = 0; i < NZONE; i++)
-	{	
-		for(UINT32 j = 0; j < DEG_ZONE * NPAGE; j++)
-		{
-			set_TL_bitmap(i, j, 0);
-		}
-		set_TL_wp(i, 0);
+	for(UINT32 i = 0; i < NUM_TL_ZONES; i++)
+	{
+		g_tl_zone[i].zone = INVALID32;
 	}
-	
+	map_tl_slots();
+	map_open_zones();
 }
 
-void zns_write(UINT32 const start_lba, UINT32 const num_sectors, UINT32 const write_buffer_addr)
+// The data is in the SATA write buffers from g_ftl_write_buf_id on, at the sector offsets of start_lba.
+void zns_write(UINT32 const start_lba, UINT32 const num_sectors)
 {
     UINT32 i_sect = 0;
-    UINT32 _write_buffer_addr = write_buffer_addr;
+    UINT32 last_buf = (start_lba + num_sectors - 1) / NSECT; // the write buffer of the last sector, counted in pages from LBA 0
 
     while (i_sect < num_sectors)
     {
@@ -480,10 +699,7 @@ void zns_write(UINT32 const start_lba, UINT32 const num_sectors, UINT32 const wr
 
         UINT32 c_zone = lba;
         if (c_zone >= NZONE) {
-            g_ftl_write_buf_id = (g_ftl_write_buf_id + 1) % NUM_WR_BUFFERS;
-            flash_finish();
-            SETREG(BM_STACK_WRSET, g_ftl_write_buf_id);   // change bm_read_limit
-            SETREG(BM_STACK_RESET, 0x01);            // change bm_read_limit
+            release_write_bufs(last_buf - c_lba / NSECT + 1);
             return;
         }
         UINT32 c_bank = c_fcg * DEG_ZONE + b_offset;
@@ -499,71 +715,67 @@ void zns_write(UINT32 const start_lba, UINT32 const num_sectors, UINT32 const wr
             #endif
         }
 
-        if (zone_state == 0 || zone_state == 1)
+        if (zone_state == ZONE_EMPTY || zone_state == ZONE_OPEN || zone_state == ZONE_CLOSED)
         {
             if (c_lba != zone_wp) {
-                g_ftl_write_buf_id = (g_ftl_write_buf_id + 1) % NUM_WR_BUFFERS;
-                flash_finish();
-                SETREG(BM_STACK_WRSET, g_ftl_write_buf_id);   // change bm_read_limit
-                SETREG(BM_STACK_RESET, 0x01);            // change bm_read_limit
+                release_write_bufs(last_buf - c_lba / NSECT + 1);
+                return;
+            }
+            // an empty or closed zone is opened implicitly
+            if (zone_state != ZONE_OPEN && open_zone(c_zone) == FALSE)
+            {
+                release_write_bufs(last_buf - c_lba / NSECT + 1);
                 return;
             }
-            if (zone_state == 0)
+            g_open_zone_time[get_zone_to_ID(c_zone)] = ++g_open_zone_clock;
+
+            // A full page at the write pointer is programmed straight from the SATA write buffer,
+            // and the buffer manager releases the buffer when the flash has read it (FO_B_SATA_W).
+            // Only if the command ends on a page boundary: a partial tail page would be released by hand,
+            // which has to wait until the flash has read all the buffers before it.
+            if (c_sect == 0 && num_sectors - i_sect >= NSECT && (start_lba + num_sectors) % NSECT == 0)
             {
-                if (OPEN_ZONE == MAX_OPEN_ZONE) {
-                    g_ftl_write_buf_id = (g_ftl_write_buf_id + 1) % NUM_WR_BUFFERS;
-                    flash_finish();
-                    SETREG(BM_STACK_WRSET, g_ftl_write_buf_id);   // change bm_read_limit
-                    SETREG(BM_STACK_RESET, 0x01);            // change bm_read_limit
-                    return;
+                nand_page_program_from_host(c_bank, get_zone_to_FBG(c_zone), p_offset);
+                set_zone_wp(c_zone, zone_wp + NSECT);
+
+                if (get_zone_wp(c_zone) == get_zone_slba(c_zone) + ZONE_SIZE)
+                {
+                    set_zone_full(c_zone);
                 }
-                UINT32 dequeue_fbg = dequeue_FBG();
-                UINT32 open_id = dequeue_open_id();
-                set_zone_to_FBG(c_zone, dequeue_fbg);
-                set_zone_to_ID(c_zone, open_id);
-                OPEN_ZONE += 1;
-                set_zone_state(c_zone, 1);
+                i_sect += NSECT;
+                continue;
             }
 
+            UINT32 zone_buf = get_zone_buf(c_zone);
+
             set_zone_wp(c_zone, get_zone_wp(c_zone) + 1);
-            UINT8 open_id = get_zone_to_ID(c_zone);
 
             UINT32 data;
-            mem_copy(ZONE_BUFFER_ADDR + open_id * BYTES_PER_PAGE + c_sect * BYTES_PER_SECTOR
+            mem_copy(zone_buf + c_sect * BYTES_PER_SECTOR
                 ,WR_BUF_PTR(g_ftl_write_buf_id) + c_sect * BYTES_PER_SECTOR, BYTES_PER_SECTOR);
 
             if (c_sect == NSECT - 1)
             {
                 UINT32 vblk = get_zone_to_FBG(c_zone);
-                nand_page_program(c_bank, vblk, p_offset, ZONE_BUFFER_ADDR + (open_id * BYTES_PER_PAGE));
-                flash_finish();
+                zns_page_program(c_bank, vblk, p_offset, zone_buf);
+                put_zone_buf(get_zone_to_ID(c_zone));
             }
             if (get_zone_wp(c_zone) == get_zone_slba(c_zone) + ZONE_SIZE)
             {
-                set_zone_state(c_zone, 2);
-                UINT8 open_id = get_zone_to_ID(c_zone);
-                enqueue_open_id(open_id);
-                mem_set_dram(ZONE_BUFFER_ADDR + open_id * BYTES_PER_PAGE, 0xABCDEF23, BYTES_PER_PAGE);
-                OPEN_ZONE -= 1;
+                set_zone_full(c_zone);
             }
             if (c_sect == NSECT - 1) 
             {
-                g_ftl_write_buf_id = (g_ftl_write_buf_id + 1) % NUM_WR_BUFFERS;
-                flash_finish();
-                SETREG(BM_STACK_WRSET, g_ftl_write_buf_id);   // change bm_read_limit
-                SETREG(BM_STACK_RESET, 0x01);            // change bm_read_limit
+                release_write_buf();
             }
         }
 
-        else if (zone_state == 2) {
-            g_ftl_write_buf_id = (g_ftl_write_buf_id + 1) % NUM_WR_BUFFERS;
-            flash_finish();
-            SETREG(BM_STACK_WRSET, g_ftl_write_buf_id);   // change bm_read_limit
-            SETREG(BM_STACK_RESET, 0x01);            // change bm_read_limit
+        else if (zone_state == ZONE_FULL) {
+            release_write_bufs(last_buf - c_lba / NSECT + 1);
             return;
         }
 
-        else if (zone_state == 3)
+        else if (zone_state == ZONE_TL_OPEN)
         {
 
             UINT32 tl_num = p_offset * DEG_ZONE * NSECT + b_offset * NSECT + c_sect;
@@ -572,54 +784,42 @@ void zns_write(UINT32 const start_lba, UINT32 const num_sectors, UINT32 const wr
             int end_lba = start_lba + num_sectors - 1;
             int start_page = (start_lba - get_zone_slba(c_zone))/SECTORS_PER_PAGE;
             int end_page = (end_lba - get_zone_slba(c_zone)) / SECTORS_PER_PAGE;
-            for (int i = start_page; i <= end_page; i++) {
-                if (get_TL_bitmap(open_id,i) == 1) {
-                    for (int j = start_page; j <= end_page; j++) {
-                        while (g_ftl_write_buf_id == GETREG(SATA_WBUF_PTR));
-                        g_ftl_write_buf_id = (g_ftl_write_buf_id + 1) % NUM_WR_BUFFERS;
-                        flash_finish();
-                        SETREG(BM_STACK_WRSET, g_ftl_write_buf_id);   // change bm_read_limit
-                        SETREG(BM_STACK_RESET, 0x01);            // change bm_read_limit
-                    }
-                    return;
-                }
+            if (find_TL_page(c_zone, start_page, 1) <= end_page) {
+                release_write_bufs(last_buf - c_lba / NSECT + 1);
+                return;
+            }
+            // the valid pages before this one are copied first
+            if (c_sect == 0)
+            {
+                fill_tl(c_zone, tl_num / NSECT, DEG_ZONE * NPAGE);
             }
+
             UINT32 TL_WP = get_TL_wp(c_zone);
             if (TL_WP != tl_num) {
-                g_ftl_write_buf_id = (g_ftl_write_buf_id + 1) % NUM_WR_BUFFERS;
-                flash_finish();
-                SETREG(BM_STACK_WRSET, g_ftl_write_buf_id);   // change bm_read_limit
-                SETREG(BM_STACK_RESET, 0x01);            // change bm_read_limit
+                release_write_bufs(last_buf - c_lba / NSECT + 1);
                 return;
             }
+            UINT32 zone_buf = get_zone_buf(c_zone);
+
             set_TL_wp(c_zone, TL_WP + 1);
 
-            mem_copy(ZONE_BUFFER_ADDR + open_id * BYTES_PER_PAGE + c_sect * BYTES_PER_SECTOR
+            mem_copy(zone_buf + c_sect * BYTES_PER_SECTOR
                 , WR_BUF_PTR(g_ftl_write_buf_id) + c_sect * BYTES_PER_SECTOR, BYTES_PER_SECTOR);
 
             if (c_sect == NSECT - 1)
             {
                 UINT32 vblk = get_TL_src_to_dest_zone(c_zone);
 
-                nand_page_program(c_bank, vblk, p_offset, ZONE_BUFFER_ADDR + (open_id * BYTES_PER_PAGE));
-                flash_finish();
+                zns_page_program(c_bank, vblk, p_offset, zone_buf);
+                put_zone_buf(open_id);
             }
             if (c_sect == NSECT - 1)
             {
-                g_ftl_write_buf_id = (g_ftl_write_buf_id + 1) % NUM_WR_BUFFERS;
-                flash_finish();
-                SETREG(BM_STACK_WRSET, g_ftl_write_buf_id);   // change bm_read_limit
-                SETREG(BM_STACK_RESET, 0x01);            // change bm_read_limit
+                release_write_buf();
             }
 
-            fill_tl(c_zone, c_lba + 1, tl_num + 1);
-
-            TL_WP = get_TL_wp(c_zone);
-            if (TL_WP == DEG_ZONE * NSECT * NPAGE) {
-                zns_reset(c_zone);
-                set_zone_state(c_zone, 2);
-                set_zone_to_FBG(c_zone, get_TL_src_to_dest_zone(c_zone));
-                OPEN_ZONE -= 1;
+            if (get_TL_wp(c_zone) == DEG_ZONE * NSECT * NPAGE) {
+                complete_tl(c_zone);
             }
 
            
@@ -629,397 +829,1349 @@ void zns_write(UINT32 const start_lba, UINT32 const num_sectors, UINT32 const wr
         i_sect++;
         if (i_sect == num_sectors && c_sect != NSECT - 1) 
         {
-            g_ftl_write_buf_id = (g_ftl_write_buf_id + 1) % NUM_WR_BUFFERS;
-            flash_finish();
-            SETREG(BM_STACK_WRSET, g_ftl_write_buf_id);   // change bm_read_limit
-            SETREG(BM_STACK_RESET, 0x01);            // change bm_read_limit
+            release_write_buf();
         }
            
     }
 }
 
-void zns_write_internal(UINT32 const start_lba, UINT32 const num_sectors, UINT32 const write_buffer_addr)
+// Zone Append: write the data at the write pointer of the zone that starts at zslba,
+// and record the LBA of its first sector in the zone append log for the host (see ftl_stat.h).
+// SATA_SECT_OFFSET of the command is the zone start LBA, so the data begins at sector 0 of the current write buffer.
+void zns_append(UINT32 const zslba, UINT32 const num_sectors)
 {
-    UINT32 i_sect = 0;
-    UINT32 _write_buffer_addr = write_buffer_addr;
-
-    UINT32 c_lba = start_lba + i_sect;
-    UINT32 lba = start_lba + i_sect;
-    UINT32 c_sect = lba % NSECT;
-    lba = lba / NSECT;
-    UINT32 b_offset = lba % DEG_ZONE;
-    lba = lba / DEG_ZONE;
-    UINT32 p_offset = lba % NPAGE;
-    lba = lba / NPAGE;
-    UINT32 c_fcg = lba % NUM_FCG;
-
-    UINT32 c_zone = lba;
-    if (c_zone >= NZONE) return;
-    UINT32 c_bank = c_fcg * DEG_ZONE + b_offset;
-
-    UINT8 zone_state = get_zone_state(c_zone);
-    UINT32 zone_wp = get_zone_wp(c_zone);
-    UINT32 zone_slba = get_zone_slba(c_zone);
+    UINT32 num_bufs = (num_sectors + NSECT - 1) / NSECT;
+    UINT32 c_zone = zslba / ZONE_SIZE;
+    UINT32 status = ZONE_APPEND_OK;
+    UINT32 zone_wp, i;
 
-    UINT32 vblk = get_zone_to_FBG(c_zone);
-    nand_page_program(c_bank, vblk, p_offset, _write_buffer_addr);
-}
+    if (is_seq_zone_start(zslba) == FALSE)
+    {
+        status = ZONE_APPEND_INVALID;
+    }
+    else if (get_zone_state(c_zone) == ZONE_FULL || get_zone_wp(c_zone) + num_sectors > zslba + ZONE_SIZE)
+    {
+        status = ZONE_APPEND_FULL;
+    }
+    else if (get_zone_state(c_zone) == ZONE_TL_OPEN)
+    {
+        status = ZONE_APPEND_BUSY;
+    }
+    // an empty or closed zone is opened first, as by a write
+    else if (get_zone_state(c_zone) != ZONE_OPEN && open_zone(c_zone) == FALSE)
+    {
+        status = ZONE_APPEND_NOT_OPEN;
+    }
 
+    if (status != ZONE_APPEND_OK)
+    {
+        zns_append_log(zslba, INVALID32, num_sectors, status);
+        release_write_bufs(num_bufs);
+        return;
+    }
 
-void zns_read(UINT32 const start_lba, UINT32 const num_sectors, UINT32 const read_buffer_addr)
-{
-    UINT32 i_sect = 0;
+    zone_wp = get_zone_wp(c_zone);
 
-    while (i_sect < num_sectors)
+    // On a page boundary, the sector offsets in the write buffers are the same as those of an ordinary write
+    // at the write pointer, which the open zone takes.
+    if (zone_wp % NSECT == 0)
     {
-        UINT32 c_lba = start_lba + i_sect;
-        UINT32 lba = start_lba + i_sect;
-        UINT32 c_sect = lba % NSECT;
-        lba = lba / NSECT;
-        UINT32 b_offset = lba % DEG_ZONE;
-        lba = lba / DEG_ZONE;
-        UINT32 p_offset = lba % NPAGE;
-        lba = lba / NPAGE;
-        UINT32 c_fcg = lba % NUM_FCG;
+        zns_write(zone_wp, num_sectors);
+        zns_append_log(zslba, zone_wp, num_sectors, ZONE_APPEND_OK);
+        return;
+    }
 
-        UINT32 c_zone = lba;
-        if (c_zone >= NZONE) {  //wrong input : c_zone cannot bigger than NZONE
-            #if OPTION_FTL_TEST == 0
-            while ((g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS == GETREG(SATA_RBUF_PTR));   // wait if the read buffer is full (slow host)
-            #endif
-            
-            flash_finish();
-            SETREG(BM_STACK_RDSET, (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS);   // change bm_read_limit
-            SETREG(BM_STACK_RESET, 0x02);            // change bm_read_limit
-            g_ftl_read_buf_id = (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS;
-            return;
-        }
-        UINT32 c_bank = c_fcg * DEG_ZONE + b_offset;
+    // Otherwise its buffered page takes the data in runs that end where either the zone page or the write buffer ends.
+    g_open_zone_time[get_zone_to_ID(c_zone)] = ++g_open_zone_clock;
 
-        UINT8 zone_state = get_zone_state(c_zone);
-        UINT32 zone_wp = get_zone_wp(c_zone);
-        UINT32 zone_slba = get_zone_slba(c_zone);
+    UINT32 vblk = get_zone_to_FBG(c_zone);
+    UINT32 src_sect = 0;
 
-        if (c_sect == 0 || i_sect == 0)
+    i = 0;
+
+    while (i < num_sectors)
+    {
+        UINT32 c_sect = zone_wp % NSECT;
+        UINT32 n = MIN(num_sectors - i, MIN(NSECT - src_sect, NSECT - c_sect));
+
+        if (src_sect == 0)
         {
             #if OPTION_FTL_TEST == 0
-            while (((g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS) == GETREG(SATA_RBUF_PTR));   // wait if the read buffer is full (slow host)
+            while (g_ftl_write_buf_id == GETREG(SATA_WBUF_PTR));
             #endif
         }
 
+        UINT32 zone_buf = get_zone_buf(c_zone);
 
-        if (zone_state == 0)
-        {
-                mem_set_dram(RD_BUF_PTR(g_ftl_read_buf_id) + c_sect * BYTES_PER_SECTOR,
-                    0xFFFFFFFF, 1 * BYTES_PER_SECTOR);
-
-                if (c_sect == NSECT - 1) {
-                    flash_finish();
-                    SETREG(BM_STACK_RDSET, (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS );   // change bm_read_limit
-                    SETREG(BM_STACK_RESET, 0x02);            // change bm_read_limit
-                    g_ftl_read_buf_id = (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS;
-                }
-                   
+        mem_copy(zone_buf + c_sect * BYTES_PER_SECTOR,
+                 WR_BUF_PTR(g_ftl_write_buf_id) + src_sect * BYTES_PER_SECTOR, n * BYTES_PER_SECTOR);
 
-            i_sect++;
-            if (i_sect == num_sectors && c_sect != NSECT - 1) 
-            {
+        if (c_sect + n == NSECT)
+        {
+            UINT32 page = (zone_wp - zslba) / NSECT;
 
-                flash_finish();
-                SETREG(BM_STACK_RDSET, (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS );   // change bm_read_limit
-                SETREG(BM_STACK_RESET, 0x02);            // change bm_read_limit
-                g_ftl_read_buf_id = (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS;
-            }
-            continue;
+            zns_page_program(ZONE_BANK(c_zone, page), vblk, page / DEG_ZONE, zone_buf);
+            put_zone_buf(get_zone_to_ID(c_zone));
         }
-        else if (zone_state == 1 || zone_state == 2)
-        {
-            if (zone_wp <= c_lba)
-            {
-                flash_finish();
-                mem_set_dram(RD_BUF_PTR(g_ftl_read_buf_id) + c_sect * BYTES_PER_SECTOR,
-                        0xFFFFFFFF, 1 * BYTES_PER_SECTOR);
-               
-                if (c_sect == NSECT - 1) 
-                {
-                    flash_finish();
-                    SETREG(BM_STACK_RDSET, (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS);   // change bm_read_limit
-                    SETREG(BM_STACK_RESET, 0x02);            // change bm_read_limit
-                    g_ftl_read_buf_id = (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS;
-                }
-               
 
-                i_sect++;
-                if (i_sect == num_sectors && c_sect != NSECT - 1)
-                {
-                    flash_finish();
-                    SETREG(BM_STACK_RDSET, (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS);   // change bm_read_limit
-                    SETREG(BM_STACK_RESET, 0x02);            // change bm_read_limit
-                    g_ftl_read_buf_id = (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS;
-                }
-                continue;
-            }
+        zone_wp += n;
+        set_zone_wp(c_zone, zone_wp);
 
-            //데이터가 버퍼에 있을때
-            if (((zone_wp - 1) / NSECT) * NSECT <= c_lba && ((zone_wp - 1) % NSECT) != NSECT - 1)
-            {
-                UINT8 open_id = get_zone_to_ID(c_zone);
-                UINT32 data = get_buffer_sector(open_id, c_sect);
-                flash_finish();
-                mem_copy(RD_BUF_PTR(g_ftl_read_buf_id) + c_sect * BYTES_PER_SECTOR, ZONE_BUFFER_ADDR + open_id * BYTES_PER_PAGE + c_sect * BYTES_PER_SECTOR, BYTES_PER_SECTOR);
-                    UINT32 data2 = read_dram_32(RD_BUF_PTR(g_ftl_read_buf_id) + c_sect * BYTES_PER_SECTOR);
+        i += n;
+        src_sect += n;
 
-                if (c_sect == NSECT - 1)
-                {
-                    flash_finish();
-                    SETREG(BM_STACK_RDSET, (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS );   // change bm_read_limit
-                    SETREG(BM_STACK_RESET, 0x02);            // change bm_read_limit
-                    g_ftl_read_buf_id = ((g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS) ;
-                }
-            }
-            else
-            {
-               UINT32 vblk = get_zone_to_FBG(c_zone);
-               nand_page_read(c_bank, vblk, p_offset, RD_BUF_PTR(g_ftl_read_buf_id));
-               flash_finish();
+        if (src_sect == NSECT || i == num_sectors)
+        {
+            release_write_buf();
+            src_sect = 0;
+        }
+    }
+    zns_append_log(zslba, zone_wp - num_sectors, num_sectors, ZONE_APPEND_OK);
 
+    if (zone_wp == zslba + ZONE_SIZE)
+    {
+        set_zone_full(c_zone);
+    }
+}
 
-               if (c_sect == NSECT - 1) 
-               {
-                  flash_finish();
-                  SETREG(BM_STACK_RDSET, (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS);   // change bm_read_limit
-                  SETREG(BM_STACK_RESET, 0x02);            // change bm_read_limit
-                  g_ftl_read_buf_id = ((g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS);
-               }
-            }
-        }
-		
-        else if (zone_state == 3)
-        {
-            UINT32 i_tl = c_lba - c_zone * DEG_ZONE * NSECT * NPAGE;
-            UINT32 TL_WP = get_TL_wp(c_zone);
-            if (TL_WP > i_tl)
-            { // this data in tl zone
-                if (((TL_WP - 1) / NSECT) * NSECT <= i_tl && ((TL_WP - 1) % NSECT) != NSECT - 1)
-                {
-                    UINT8 open_id = get_zone_to_ID(c_zone);
-                    mem_copy(RD_BUF_PTR(g_ftl_read_buf_id) + c_sect * BYTES_PER_SECTOR, ZONE_BUFFER_ADDR + open_id * BYTES_PER_PAGE + c_sect * BYTES_PER_SECTOR, BYTES_PER_SECTOR);
+static void zns_append_log(UINT32 const zslba, UINT32 const lba, UINT32 const num_sectors, UINT32 const status)
+{
+    zone_append_t entry;
 
-                    if (c_sect == NSECT - 1)
-                    {
-                        flash_finish();
-                        SETREG(BM_STACK_RDSET, ((g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS));   // change bm_read_limit
-                        SETREG(BM_STACK_RESET, 0x02);            // change bm_read_limit
-                        g_ftl_read_buf_id = ((g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS);
-                    }
+    entry.zslba = zslba;
+    entry.lba = lba;
+    entry.num_sectors = num_sectors;
+    entry.status = status;
 
-                }
-                else
-                {
-                    UINT32 vblk = get_TL_src_to_dest_zone(c_zone);
-                   
-                    nand_page_read(c_bank, vblk, p_offset, RD_BUF_PTR(g_ftl_read_buf_id));
-
-                    if (c_sect == NSECT - 1)
-                    {
-                        flash_finish();
-                        SETREG(BM_STACK_RDSET, (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS);   // change bm_read_limit
-                        SETREG(BM_STACK_RESET, 0x02);            // change bm_read_limit
-                        g_ftl_read_buf_id = ((g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS);
-                    }
+    mem_copy(ZONE_APPEND_ADDR + BYTES_PER_SECTOR + (g_zone_append_hdr.count % ZONE_APPEND_ENTRIES) * sizeof(zone_append_t),
+             &entry, sizeof(zone_append_t));
 
-                }
-            }
-            else
-            {
-                UINT32 vblk = get_zone_to_FBG(c_zone);
-                nand_page_ptread(c_bank, vblk, p_offset, c_sect, 1, RD_BUF_PTR(g_ftl_read_buf_id), RETURN_ON_ISSUE);
+    g_zone_append_hdr.count++;
+    mem_copy(ZONE_APPEND_ADDR, &g_zone_append_hdr, sizeof(zone_append_hdr_t));
+}
 
-                if (c_sect == NSECT - 1)
-                {
-                    flash_finish();
-                    SETREG(BM_STACK_RDSET, (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS);   // change bm_read_limit
-                    SETREG(BM_STACK_RESET, 0x02);            // change bm_read_limit
-                    g_ftl_read_buf_id = ((g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS);
-                }
-            }
-        }
+// the zone append log covers the commands since boot
+static void init_zone_append_log(void)
+{
+    mem_set_sram(&g_zone_append_hdr, 0, sizeof(zone_append_hdr_t));
 
+    g_zone_append_hdr.signature = ZONE_APPEND_SIGNATURE;
+    g_zone_append_hdr.version = ZONE_APPEND_VERSION;
+    g_zone_append_hdr.entry_bytes = sizeof(zone_append_t);
+    g_zone_append_hdr.num_entries = ZONE_APPEND_ENTRIES;
+    g_zone_append_hdr.zone_sectors = ZONE_SIZE;
 
+    mem_set_dram(ZONE_APPEND_ADDR, 0, ZONE_APPEND_BYTES);
+    mem_copy(ZONE_APPEND_ADDR, &g_zone_append_hdr, sizeof(zone_append_hdr_t));
+}
 
-        i_sect++;
-        if (i_sect == num_sectors && c_sect != NSECT - 1) 
-        {
-            flash_finish();
-            SETREG(BM_STACK_RDSET, (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS);   // change bm_read_limit
-            SETREG(BM_STACK_RESET, 0x02);            // change bm_read_limit
-            g_ftl_read_buf_id = (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS;
-        }
-    }
-    return;
+static void simple_copy_log(simple_copy_t const* const entry)
+{
+    mem_copy(SIMPLE_COPY_ADDR + BYTES_PER_SECTOR + (g_simple_copy_hdr.count % SIMPLE_COPY_ENTRIES) * sizeof(simple_copy_t),
+             entry, sizeof(simple_copy_t));
+
+    g_simple_copy_hdr.count++;
+    mem_copy(SIMPLE_COPY_ADDR, &g_simple_copy_hdr, sizeof(zone_append_hdr_t));
 }
 
-void zns_read_internal(UINT32 const start_lba, UINT32 const num_sectors, UINT32 const read_buffer_addr)
+// the simple copy log covers the commands since boot
+static void init_simple_copy_log(void)
 {
-    UINT32 i_sect = 0;
-    UINT32 _read_buffer_addr = read_buffer_addr;
+    mem_set_sram(&g_simple_copy_hdr, 0, sizeof(zone_append_hdr_t));
 
-    UINT32 c_lba = start_lba + i_sect;
-    UINT32 lba = start_lba + i_sect;
-    UINT32 c_sect = lba % NSECT;
-    lba = lba / NSECT;
-    UINT32 b_offset = lba % DEG_ZONE;
-    lba = lba / DEG_ZONE;
-    UINT32 p_offset = lba % NPAGE;
-    lba = lba / NPAGE;
-    UINT32 c_fcg = lba % NUM_FCG;
+    g_simple_copy_hdr.signature = SIMPLE_COPY_SIGNATURE;
+    g_simple_copy_hdr.version = SIMPLE_COPY_VERSION;
+    g_simple_copy_hdr.entry_bytes = sizeof(simple_copy_t);
+    g_simple_copy_hdr.num_entries = SIMPLE_COPY_ENTRIES;
+    g_simple_copy_hdr.zone_sectors = ZONE_SIZE;
 
-    UINT32 c_zone = lba;
-    if (c_zone >= NZONE) return;
-    UINT32 c_bank = c_fcg * DEG_ZONE + b_offset;
+    mem_set_dram(SIMPLE_COPY_ADDR, 0, SIMPLE_COPY_BYTES);
+    mem_copy(SIMPLE_COPY_ADDR, &g_simple_copy_hdr, sizeof(zone_append_hdr_t));
+}
 
-    UINT8 zone_state = get_zone_state(c_zone);
-    UINT32 zone_wp = get_zone_wp(c_zone);
-    UINT32 zone_slba = get_zone_slba(c_zone);
+// Program a full zone page without waiting for it.
+// The page is staged in the bank's ZONE_PROG_BUF so that the open zone buffer can take the next page at once.
+// Consecutive pages of a zone are on consecutive banks, so the previous program of the bank has usually finished.
+void zns_page_program(UINT32 const bank, UINT32 const vblk, UINT32 const page_num, UINT32 const buf_addr)
+{
+    // An empty waiting room means that the bank has accepted every command issued to it,
+    // so an idle bank has also finished reading its staging buffer.
+    while ((GETREG(WR_STAT) & 0x00000001) != 0);
+    while (BSP_FSM(bank) != BANK_IDLE);
 
+    mem_copy(ZONE_PROG_BUF(bank), buf_addr, BYTES_PER_PAGE);
+    nand_page_program(bank, vblk, page_num, ZONE_PROG_BUF(bank));
+}
 
-    UINT32 vblk = get_zone_to_FBG(c_zone);
-    nand_page_read(c_bank, vblk, p_offset, _read_buffer_addr);
+// Release the current SATA write buffer after its sectors have been copied to the open zone buffer.
+// The buffers programmed with nand_page_program_from_host() are released by the buffer manager as the flash reads them;
+// bm_write_limit must catch up with them before it is moved by hand.
+void release_write_buf(void)
+{
+    #if OPTION_FTL_TEST == 0
+    while (GETREG(BM_WRITE_LIMIT) != g_ftl_write_buf_id);
+    #endif
+
+    g_ftl_write_buf_id = (g_ftl_write_buf_id + 1) % NUM_WR_BUFFERS;
+    SETREG(BM_STACK_WRSET, g_ftl_write_buf_id);   // change bm_write_limit
+    SETREG(BM_STACK_RESET, 0x01);                 // change bm_write_limit
+}
 
+// A rejected command: its next num_bufs write buffers are released without being read.
+static void release_write_bufs(UINT32 const num_bufs)
+{
+    UINT32 i;
 
-    return;
+    for (i = 0; i < num_bufs; i++)
+    {
+        #if OPTION_FTL_TEST == 0
+        while (g_ftl_write_buf_id == GETREG(SATA_WBUF_PTR));
+        #endif
+        release_write_buf();
+    }
 }
 
-void zns_reset(UINT32 c_zone)
+// the write pointer has reached the end of the zone: give its open zone id back
+void set_zone_full(UINT32 zone_number)
 {
-	UINT32 lba = c_zone / ZONE_SIZE;
-	UINT32 c_bank = (lba / NSECT) % DEG_ZONE;
-	
-	ASSERT(c_zone < NZONE);
-    if (get_zone_state(c_zone) != 2)    return;
-	
-	set_zone_state(c_zone, 0);
-	set_zone_wp(c_zone, get_zone_slba(c_zone));
-	
-	UINT32 i;
-	for(i = 0; i< NUM_BANKS; i++)
-	{
-		nand_block_erase(i, get_zone_to_FBG(c_zone));
-	}
-	
-	enqueue_FBG(get_zone_to_FBG(c_zone));
-	set_zone_to_FBG(c_zone, -1);
+    drop_zone_buf(zone_number);
+    enqueue_open_id(get_zone_to_ID(zone_number));
+    set_zone_state(zone_number, ZONE_FULL);
+    OPEN_ZONE -= 1;
 
+    logging_zone_metadata();
 }
 
-void zns_get_desc(UINT32 c_zone, UINT32 nzone)
+// Open zone buffers
+// The page at the write pointer of an open or TL_OPEN zone is assembled in a buffer of the pool (ZONE_BUF())
+// from its first sector on, and the buffer goes back to the pool as soon as the page is programmed,
+// so a zone whose write pointer is on a page boundary holds none. When the pool runs out, the partial page
+// that was written least recently is spilled to the page mapped blocks (ZONE_SPILL_LPN() of its zone)
+// and read back when its zone is written again. A closed zone keeps its partial page there (see close_zone()). ftl_idle() spills ahead of time to keep ZONE_BUF_RESERVE buffers free.
+// The spilled page stays mapped until the page is programmed, so FLUSH CACHE (ftl_flush()) only has to spill
+// the buffers written since, and the page map checkpoint keeps the partial pages over a power loss.
+
+// (called from ftl_open()) every pool buffer is free, and the partial pages spilled before power off are dropped
+// unless load_metadata() has put the write pointer of their zone on them
+static void init_zone_bufs(void)
 {
-	for(UINT32 i = 0; i < nzone; i++) 
-	{
-		ASSERT(i + c_zone < NZONE);
+    UINT32 i;
 
-		uart_printf("ZONE %d descriptor", c_zone + i);
-        
-        if(get_zone_state(i + c_zone) == 3)
+    for (i = 0; i < MAX_OPEN_ZONE; i++)
+    {
+        g_zone_buf_of[i] = NO_ZONE_BUF;
+    }
+    for (i = NUM_CONV_ZONES; i < NZONE; i++)
+    {
+        UINT8 state = get_zone_state(i);
+        UINT32 wp = (state == ZONE_TL_OPEN) ? get_TL_wp(i) : get_zone_wp(i);
+
+        if ((state != ZONE_OPEN && state != ZONE_TL_OPEN && state != ZONE_CLOSED) || wp % NSECT == 0)
         {
-            uart_printf("State : TL_OPEN");
-            uart_printf("Slba : %d", get_zone_slba(i + c_zone));
-            uart_printf("Wp : %d", get_TL_wp(i + c_zone) + get_zone_slba(i + c_zone));
-            continue;
+            trim_page(ZONE_SPILL_LPN(i));
         }
-    
-        if(get_zone_state(i + c_zone) == 0) uart_printf("State : EMPTY");
-		else if(get_zone_state(i + c_zone) == 1) uart_printf("State : OPEN");
-		else if(get_zone_state(i + c_zone) == 2) uart_printf("State : FULL");
-		
-		uart_printf("Slba : %d", get_zone_slba(i + c_zone));
-		uart_printf("Wp : %d", get_zone_wp(i + c_zone));
-	}
-  return;
+    }
+    for (i = 0; i < NUM_ZONE_BUFFERS; i++)
+    {
+        g_zone_buf_owner[i] = NO_ZONE_BUF;
+    }
+    g_num_free_zone_bufs = NUM_ZONE_BUFFERS;
+    g_zone_buf_clock = 0;
 }
 
-void zns_izc(UINT32 src_zone, UINT32 dest_zone, UINT32 copy_len, UINT32 izc_addr)
+// The pool buffer of an open or TL_OPEN zone for the page at its write pointer.
+// A zone without one takes a buffer, which gets the partial page back if it had been spilled.
+static UINT32 get_zone_buf(UINT32 const zone)
 {
-	ASSERT(src_zone < NZONE && dest_zone < NZONE);
-	if(src_zone == dest_zone) return;
-    if (get_zone_state(src_zone) != 2 || get_zone_state(dest_zone) != 0) {
-        uart_printf("src_zone_state : %d, dest_zone_state : %d", get_zone_state(src_zone), get_zone_state(dest_zone));
-        return;
+    UINT8 open_id = get_zone_to_ID(zone);
+    UINT32 idx = g_zone_buf_of[open_id];
+
+    if (idx == NO_ZONE_BUF)
+    {
+        UINT32 wp = (get_zone_state(zone) == ZONE_TL_OPEN) ? get_TL_wp(zone) : get_zone_wp(zone);
+
+        idx = alloc_zone_buf();
+        g_zone_buf_owner[idx] = open_id;
+        g_zone_buf_of[open_id] = idx;
+
+        if (wp % NSECT != 0)
+        {
+            UINT32 lpn = ZONE_SPILL_LPN(zone);
+            UINT32 vpn = get_vpn(lpn);
+
+            ASSERT(vpn != NULL);
+            nand_page_read(get_num_bank(lpn), vpn / PAGES_PER_BLK, vpn % PAGES_PER_BLK, ZONE_BUF(idx));
+        }
     }
-	if(MAX_OPEN_ZONE == OPEN_ZONE) return;
-	
-	set_zone_to_FBG(dest_zone, dequeue_FBG());
-	set_zone_to_ID(dest_zone, dequeue_open_id());
-	set_zone_state(dest_zone, 1);	
-	
-	for(UINT32 i = 0; i < copy_len; i++)
-	{		
-        UINT32 temp = read_dram_32(izc_addr + i * sizeof(int));
-		UINT32 s_lba = get_zone_slba(src_zone) + temp * NSECT;
-		zns_read_internal(s_lba, NSECT, TL_INTERNAL_BUFFER_ADDR);
-		UINT32 d_lba = get_zone_slba(dest_zone) + i * NSECT;
-		zns_write_internal(d_lba, NSECT, TL_INTERNAL_BUFFER_ADDR);
-		set_zone_wp(dest_zone, get_zone_wp(dest_zone) + NSECT);
-	}
-	
-	zns_reset(src_zone);
-	OPEN_ZONE++;
-	
-	if(copy_len == DEG_ZONE * NPAGE)
-	{
-		set_zone_state(dest_zone, 2);
-		enqueue_open_id(get_zone_to_ID(dest_zone));		
-		OPEN_ZONE -= 1;
-	}
+    g_zone_buf_time[idx] = ++g_zone_buf_clock;
+    g_zone_buf_dirty[idx] = TRUE;
+
+    return ZONE_BUF(idx);
 }
 
-void zns_tl_open(UINT32 zone, UINT32 tl_addr)
+// the page at the write pointer has been programmed (or dropped): its buffer goes back to the pool,
+// and its spilled copy is stale
+static void put_zone_buf(UINT8 const open_id)
 {
-	if(get_zone_state(zone) != 2) return;
-	if(OPEN_ZONE == MAX_OPEN_ZONE) return;
+    UINT32 idx = g_zone_buf_of[open_id];
+
+    if (idx != NO_ZONE_BUF)
+    {
+        g_zone_buf_owner[idx] = NO_ZONE_BUF;
+        g_zone_buf_of[open_id] = NO_ZONE_BUF;
+        g_num_free_zone_bufs++;
+    }
+    trim_page(ZONE_SPILL_LPN(g_open_zone_of[open_id]));
+}
+
+// the zone is reset or full: its partial page is dropped, whether in the pool or spilled
+static void drop_zone_buf(UINT32 const zone)
+{
+    if (get_zone_state(zone) == ZONE_OPEN || get_zone_state(zone) == ZONE_TL_OPEN)
+    {
+        put_zone_buf(get_zone_to_ID(zone));
+    }
+    trim_page(ZONE_SPILL_LPN(zone));
+}
+
+// a free pool buffer, made by spilling the least recently written partial page if there is none
+static UINT32 alloc_zone_buf(void)
+{
+    UINT32 idx;
+
+    if (g_num_free_zone_bufs == 0)
+    {
+        spill_zone_buf(lru_zone_buf());
+    }
+    for (idx = 0; g_zone_buf_owner[idx] != NO_ZONE_BUF; idx++);
+
+    g_num_free_zone_bufs--;
+
+    return idx;
+}
+
+// Spill the partial page in pool buffer idx and free the buffer.
+static void spill_zone_buf(UINT32 const idx)
+{
+    UINT8 open_id = g_zone_buf_owner[idx];
+
+    ASSERT(open_id != NO_ZONE_BUF);
+
+    write_zone_tail(idx);
+
+    g_zone_buf_owner[idx] = NO_ZONE_BUF;
+    g_zone_buf_of[open_id] = NO_ZONE_BUF;
+    g_num_free_zone_bufs++;
+}
+
+// Program the partial page in pool buffer idx to the page mapped blocks (ZONE_SPILL_LPN() of its zone), without waiting.
+// The rest of the page is whatever the buffer held before; the zone write pointer says which sectors count.
+// The last sector, which is never below the write pointer, is a zone_tail for load_zone_tail().
+static void write_zone_tail(UINT32 const idx)
+{
+    UINT32 zone = g_open_zone_of[g_zone_buf_owner[idx]];
+    zone_tail tail;
+
+    tail.signature = ZONE_TAIL_SIGNATURE;
+    tail.zone = zone;
+
+    if (get_zone_state(zone) == ZONE_TL_OPEN)
+    {
+        tail.fbg = get_TL_src_to_dest_zone(zone);
+        tail.wp = get_TL_wp(zone);
+    }
+    else
+    {
+        tail.fbg = get_zone_to_FBG(zone);
+        tail.wp = get_zone_wp(zone) - get_zone_slba(zone);
+    }
+    ASSERT(tail.wp % NSECT != 0);
+
+    mem_copy(ZONE_BUF(idx) + (NSECT - 1) * BYTES_PER_SECTOR, &tail, sizeof(zone_tail));
+    write_page_dram(ZONE_SPILL_LPN(zone), ZONE_BUF(idx));
+    g_zone_buf_dirty[idx] = FALSE;
+}
+
+// (called from load_metadata()) The sectors of zone page num_pages of 'zone', block group 'vblk', that were spilled
+// before the last page map checkpoint, 0 if there are none. A spilled page that is not that page (its zone has been
+// reset, or written further, since) is dropped.
+static UINT32 load_zone_tail(UINT32 const zone, UINT32 const vblk, UINT32 const num_pages)
+{
+    UINT32 lpn = ZONE_SPILL_LPN(zone);
+    UINT32 vpn = get_vpn(lpn);
+    UINT32 bank = get_num_bank(lpn);
+    zone_tail tail;
+
+    if (vpn == NULL)
+    {
+        return 0;
+    }
+    nand_page_ptread(bank, vpn / PAGES_PER_BLK, vpn % PAGES_PER_BLK, NSECT - 1, 1, FTL_BUF(bank), RETURN_WHEN_DONE);
+    mem_copy(&tail, FTL_BUF(bank) + (NSECT - 1) * BYTES_PER_SECTOR, sizeof(zone_tail));
+
+    if (tail.signature == ZONE_TAIL_SIGNATURE && tail.zone == zone && tail.fbg == vblk && tail.wp / NSECT == num_pages)
+    {
+        return tail.wp % NSECT;
+    }
+    trim_page(lpn);
+
+    return 0;
+}
+
+// the pool buffer in use that was written least recently
+static UINT32 lru_zone_buf(void)
+{
+    UINT32 idx, lru = 0, max_age = 0;
+
+    for (idx = 0; idx < NUM_ZONE_BUFFERS; idx++)
+    {
+        if (g_zone_buf_owner[idx] != NO_ZONE_BUF && g_zone_buf_clock - g_zone_buf_time[idx] >= max_age)
+        {
+            max_age = g_zone_buf_clock - g_zone_buf_time[idx];
+            lru = idx;
+        }
+    }
+    return lru;
+}
+
+// A zone read is split into page runs. The run of a page on the NAND is one nand_page_ptread_to_host(),
+// issued without waiting, so that consecutive pages are read from consecutive banks in parallel.
+// The run of a page that is not programmed yet is assembled in the read buffer by zns_read_unprogrammed().
+void zns_read(UINT32 const start_lba, UINT32 const num_sectors, UINT32 const read_buffer_addr)
+{
+    UINT32 c_lba = start_lba;
+    UINT32 remain_sects = num_sectors;
+
+    while (remain_sects != 0)
+    {
+        UINT32 lba = c_lba;
+        UINT32 c_sect = lba % NSECT;
+        lba = lba / NSECT;
+        UINT32 b_offset = lba % DEG_ZONE;
+        lba = lba / DEG_ZONE;
+        UINT32 p_offset = lba % NPAGE;
+        lba = lba / NPAGE;
+        UINT32 c_fcg = lba % NUM_FCG;
+
+        UINT32 c_zone = lba;
+        UINT32 c_bank = c_fcg * DEG_ZONE + b_offset;
+        UINT32 num_sectors_to_read = MIN(remain_sects, NSECT - c_sect);
+        UINT32 page_lba = c_lba - c_sect;
+
+        if (c_zone >= NZONE || get_zone_state(c_zone) == ZONE_EMPTY)
+        {
+            zns_read_unprogrammed(c_bank, INVALID32, p_offset, 0, 0, c_sect, num_sectors_to_read);
+        }
+        else if (get_zone_state(c_zone) == ZONE_OPEN || get_zone_state(c_zone) == ZONE_FULL || get_zone_state(c_zone) == ZONE_CLOSED)
+        {
+            UINT32 zone_wp = get_zone_wp(c_zone);
+
+            if (page_lba + NSECT <= zone_wp)
+            {
+                nand_page_ptread_to_host(c_bank, get_zone_to_FBG(c_zone), p_offset, c_sect, num_sectors_to_read);
+            }
+            else
+            {
+                // the page at the write pointer is in the pool buffer (or spilled) up to the write pointer
+                zns_read_unprogrammed(c_bank, INVALID32, p_offset, c_zone,
+                                      (zone_wp > page_lba) ? zone_wp - page_lba : 0, c_sect, num_sectors_to_read);
+            }
+        }
+        else if (get_zone_state(c_zone) == ZONE_TL_OPEN)
+        {
+            UINT32 tl_wp = get_zone_slba(c_zone) + get_TL_wp(c_zone);
+
+            // below the TL write pointer in the destination block, above it still in the source block
+            if (page_lba + NSECT <= tl_wp)
+            {
+                nand_page_ptread_to_host(c_bank, get_TL_src_to_dest_zone(c_zone), p_offset, c_sect, num_sectors_to_read);
+            }
+            else if (page_lba >= tl_wp)
+            {
+                nand_page_ptread_to_host(c_bank, get_zone_to_FBG(c_zone), p_offset, c_sect, num_sectors_to_read);
+            }
+            else
+            {
+                zns_read_unprogrammed(c_bank, get_zone_to_FBG(c_zone), p_offset, c_zone,
+                                      tl_wp - page_lba, c_sect, num_sectors_to_read);
+            }
+        }
+        c_lba += num_sectors_to_read;
+        remain_sects -= num_sectors_to_read;
+    }
+}
+
+// Hand the sectors [sect_offset, sect_offset + num_sectors) of a zone page that is not programmed yet to the host.
+// The first 'buffered' sectors of the page are in the pool buffer of 'zone' or spilled, the others are read from
+// 'vblk' (the source block of a TL zone) or are 0xFF if vblk is INVALID32.
+void zns_read_unprogrammed(UINT32 const bank, UINT32 const vblk, UINT32 const p_offset, UINT32 const zone,
+                           UINT32 const buffered, UINT32 const sect_offset, UINT32 const num_sectors)
+{
+    UINT32 next_read_buf_id = (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS;
+    UINT32 end_sect = sect_offset + num_sectors;
+    UINT32 split = MAX(sect_offset, MIN(buffered, end_sect));
+    UINT32 idx = NO_ZONE_BUF;
+
+    if (split > sect_offset && get_zone_state(zone) != ZONE_CLOSED)
+    {
+        idx = g_zone_buf_of[get_zone_to_ID(zone)];
+    }
+
+    #if OPTION_FTL_TEST == 0
+    while (next_read_buf_id == GETREG(SATA_RBUF_PTR));	// wait if the read buffer is full (slow host)
+    #endif
+
+    // the reads issued to the previous read buffers must complete before bm_read_limit is moved by hand
+    flash_finish();
+
+    if (split > sect_offset && idx != NO_ZONE_BUF)
+    {
+        mem_copy(RD_BUF_PTR(g_ftl_read_buf_id) + sect_offset * BYTES_PER_SECTOR,
+                 ZONE_BUF(idx) + sect_offset * BYTES_PER_SECTOR,
+                 (split - sect_offset) * BYTES_PER_SECTOR);
+    }
+    else if (split > sect_offset)
+    {
+        // the buffered sectors have been spilled (see spill_zone_buf() and close_zone())
+        UINT32 lpn = ZONE_SPILL_LPN(zone);
+        UINT32 vpn = get_vpn(lpn);
+
+        ASSERT(vpn != NULL);
+        nand_page_ptread(get_num_bank(lpn), vpn / PAGES_PER_BLK, vpn % PAGES_PER_BLK, sect_offset, split - sect_offset,
+                         RD_BUF_PTR(g_ftl_read_buf_id), RETURN_WHEN_DONE);
+    }
+    if (end_sect > split)
+    {
+        if (vblk == INVALID32)
+        {
+            mem_set_dram(RD_BUF_PTR(g_ftl_read_buf_id) + split * BYTES_PER_SECTOR,
+                         0xFFFFFFFF, (end_sect - split) * BYTES_PER_SECTOR);
+        }
+        else
+        {
+            nand_page_ptread(bank, vblk, p_offset, split, end_sect - split, RD_BUF_PTR(g_ftl_read_buf_id), RETURN_WHEN_DONE);
+        }
+    }
+    SETREG(BM_STACK_RDSET, next_read_buf_id);	// change bm_read_limit
+    SETREG(BM_STACK_RESET, 0x02);				// change bm_read_limit
+
+    g_ftl_read_buf_id = next_read_buf_id;
+}
+
+// the start LBA of a sequential write zone
+static BOOL32 is_seq_zone_start(UINT32 const zslba)
+{
+    return zslba % ZONE_SIZE == 0 && zslba >= CONV_SECTORS && zslba / ZONE_SIZE < NZONE;
+}
+
+// An empty or closed zone takes an open zone id, and an empty zone also takes a free block group.
+// If MAX_OPEN_ZONE zones are open, the open zone that was written least recently is closed first.
+// returns FALSE if every open zone is TL_OPEN (see NUM_TL_ZONES)
+static BOOL32 open_zone(UINT32 const zone)
+{
+    BOOL32 const empty = (get_zone_state(zone) == ZONE_EMPTY);
+
+    if (OPEN_ZONE == MAX_OPEN_ZONE)
+    {
+        UINT32 victim = lru_open_zone();
+
+        if (victim == NZONE)
+        {
+            return FALSE;
+        }
+        close_zone(victim);
+    }
+    if (empty)
+    {
+        set_zone_to_FBG(zone, dequeue_FBG(ZONE_FCG(zone)));
+    }
+    set_zone_to_ID(zone, dequeue_open_id());
+    OPEN_ZONE += 1;
+    set_zone_state(zone, ZONE_OPEN);
+    g_open_zone_time[get_zone_to_ID(zone)] = ++g_open_zone_clock;
+
+    // the free block group must be recorded as taken before its first page is programmed
+    // (a zone that is opened again has a checkpoint of it, and its pages are found by load_metadata())
+    if (empty)
+    {
+        logging_zone_metadata();
+    }
+    return TRUE;
+}
+
+// An open zone gives its open zone id back and keeps its block group and write pointer (ZONE_CLOSED).
+// Its partial page is spilled to ZONE_SPILL_LPN() and read back when the zone is opened again by a write.
+static void close_zone(UINT32 const zone)
+{
+    UINT8 open_id = get_zone_to_ID(zone);
+
+    ASSERT(get_zone_state(zone) == ZONE_OPEN);
+
+    if (g_zone_buf_of[open_id] != NO_ZONE_BUF)
+    {
+        spill_zone_buf(g_zone_buf_of[open_id]);
+    }
+    enqueue_open_id(open_id);
+    set_zone_state(zone, ZONE_CLOSED);
+    OPEN_ZONE -= 1;
+}
+
+// Fill an empty, open or closed zone: the partial page at the write pointer is programmed with 0xFF sectors
+// after the written ones, and the write pointer moves to the end of the zone. The pages above it stay erased
+// and read as 0xFF. returns FALSE if the zone cannot be opened
+static BOOL32 finish_zone(UINT32 const zone)
+{
+    UINT32 wp, zone_buf, page;
+
+    if (get_zone_state(zone) != ZONE_OPEN && open_zone(zone) == FALSE)
+    {
+        return FALSE;
+    }
+    wp = get_zone_wp(zone);
+
+    if (wp % NSECT != 0)
+    {
+        zone_buf = get_zone_buf(zone);
+        page = (wp - get_zone_slba(zone)) / NSECT;
+
+        mem_set_dram(zone_buf + (wp % NSECT) * BYTES_PER_SECTOR, 0xFFFFFFFF, (NSECT - wp % NSECT) * BYTES_PER_SECTOR);
+        zns_page_program(ZONE_BANK(zone, page), get_zone_to_FBG(zone), page / DEG_ZONE, zone_buf);
+        put_zone_buf(get_zone_to_ID(zone));
+    }
+    set_zone_wp(zone, get_zone_slba(zone) + ZONE_SIZE);
+    set_zone_full(zone);
+
+    return TRUE;
+}
+
+// the open zone (not TL_OPEN) that was written least recently, NZONE if there is none
+static UINT32 lru_open_zone(void)
+{
+    UINT32 open_id, lru = NZONE, max_age = 0;
+
+    for (open_id = 0; open_id < MAX_OPEN_ZONE; open_id++)
+    {
+        if (g_open_zone_of[open_id] != INVALID16 && g_tl_slot_of[open_id] == NO_TL_SLOT
+            && g_open_zone_clock - g_open_zone_time[open_id] >= max_age)
+        {
+            max_age = g_open_zone_clock - g_open_zone_time[open_id];
+            lru = g_open_zone_of[open_id];
+        }
+    }
+    return lru;
+}
+
+// g_open_zone_of[] of the open and TL_OPEN zones of a checkpoint (see set_zone_to_ID())
+static void map_open_zones(void)
+{
+    UINT32 i;
+
+    for (i = 0; i < MAX_OPEN_ZONE; i++)
+    {
+        g_open_zone_of[i] = INVALID16;
+        g_open_zone_time[i] = 0;
+    }
+    for (i = NUM_CONV_ZONES; i < NZONE; i++)
+    {
+        if (get_zone_state(i) == ZONE_OPEN || get_zone_state(i) == ZONE_TL_OPEN)
+        {
+            g_open_zone_of[get_zone_to_ID(i)] = i;
+        }
+    }
+    g_open_zone_clock = 0;
+}
+
+// Empty an open, closed or full zone. Only the zone metadata changes: the block group is erased in idle time
+// or when the free block groups run out (erase_pending_FBG()), and the partial page of an open or closed zone is dropped.
+static void reset_zone(UINT32 const zone)
+{
+    drop_zone_buf(zone);
+
+    if (get_zone_state(zone) == ZONE_OPEN)
+    {
+        enqueue_open_id(get_zone_to_ID(zone));
+        OPEN_ZONE -= 1;
+    }
+    set_zone_state(zone, ZONE_EMPTY);
+    set_zone_wp(zone, get_zone_slba(zone));
+
+    enqueue_erase(ZONE_FCG(zone), get_zone_to_FBG(zone));
+    set_zone_to_FBG(zone, -1);
+}
+
+// returns FALSE for a TL_OPEN zone
+BOOL32 zns_reset(UINT32 c_zone)
+{
+    ASSERT(c_zone < NZONE);
+
+    if (get_zone_state(c_zone) == ZONE_TL_OPEN)
+    {
+        return FALSE;
+    }
+    if (get_zone_state(c_zone) != ZONE_EMPTY)
+    {
+        reset_zone(c_zone);
+        logging_zone_metadata();
+    }
+    return TRUE;
+}
+
+// ZONE MANAGEMENT OUT (see ata_zone_management_out()) on the sequential write zone that starts at zslba,
+// or on every zone with 'all'. TL_OPEN zones are neither closed nor finished.
+// returns FALSE if the action is not possible
+BOOL32 ftl_zone_mgmt(UINT32 const action, UINT32 const zslba, BOOL32 const all)
+{
+    UINT32 zone;
+
+    if (all)
+    {
+        return zone_mgmt_all(action);
+    }
+    if (is_seq_zone_start(zslba) == FALSE)
+    {
+        return FALSE;
+    }
+    zone = zslba / ZONE_SIZE;
+
+    switch (action)
+    {
+        case ZM_OPEN_ZONE:
+            // an open, TL_OPEN or full zone stays as it is
+            return (get_zone_state(zone) != ZONE_EMPTY && get_zone_state(zone) != ZONE_CLOSED) || open_zone(zone);
+        case ZM_CLOSE_ZONE:
+            // an empty zone has nothing to close, and the other zones stay as they are
+            if (get_zone_state(zone) == ZONE_OPEN)
+            {
+                close_zone(zone);
+                logging_zone_metadata();
+            }
+            return get_zone_state(zone) != ZONE_TL_OPEN;
+        case ZM_FINISH_ZONE:
+            if (get_zone_state(zone) == ZONE_TL_OPEN)
+            {
+                return FALSE;
+            }
+            return get_zone_state(zone) == ZONE_FULL || finish_zone(zone);
+        case ZM_RESET_WP:
+            return zns_reset(zone);
+        default:
+            return FALSE;
+    }
+}
+
+// The ALL variants: OPEN ALL opens the closed zones (none of them if they do not all get an open zone id),
+// CLOSE ALL closes the open zones, FINISH ALL finishes the open and closed zones and RESET ALL empties
+// every zone but the TL_OPEN ones.
+static BOOL32 zone_mgmt_all(UINT32 const action)
+{
+    UINT32 zone, num_closed = 0;
+    BOOL32 changed = FALSE;
+
+    switch (action)
+    {
+        case ZM_OPEN_ZONE:
+            for (zone = NUM_CONV_ZONES; zone < NZONE; zone++)
+            {
+                num_closed += (get_zone_state(zone) == ZONE_CLOSED);
+            }
+            if (num_closed > MAX_OPEN_ZONE - OPEN_ZONE)
+            {
+                return FALSE;
+            }
+            for (zone = NUM_CONV_ZONES; zone < NZONE; zone++)
+            {
+                if (get_zone_state(zone) == ZONE_CLOSED)
+                {
+                    open_zone(zone);
+                }
+            }
+            return TRUE;
+        case ZM_CLOSE_ZONE:
+            for (zone = NUM_CONV_ZONES; zone < NZONE; zone++)
+            {
+                if (get_zone_state(zone) == ZONE_OPEN)
+                {
+                    close_zone(zone);
+                    changed = TRUE;
+                }
+            }
+            break;
+        case ZM_FINISH_ZONE:
+            // the open zones first: their open zone ids are enough to open the closed zones without closing any
+            for (zone = NUM_CONV_ZONES; zone < NZONE; zone++)
+            {
+                if (get_zone_state(zone) == ZONE_OPEN)
+                {
+                    finish_zone(zone);
+                }
+            }
+            for (zone = NUM_CONV_ZONES; zone < NZONE; zone++)
+            {
+                if (get_zone_state(zone) == ZONE_CLOSED)
+                {
+                    finish_zone(zone);
+                }
+            }
+            return TRUE;
+        case ZM_RESET_WP:
+            for (zone = NUM_CONV_ZONES; zone < NZONE; zone++)
+            {
+                if (get_zone_state(zone) == ZONE_OPEN || get_zone_state(zone) == ZONE_FULL || get_zone_state(zone) == ZONE_CLOSED)
+                {
+                    reset_zone(zone);
+                    changed = TRUE;
+                }
+            }
+            break;
+        default:
+            return FALSE;
+    }
+    if (changed)
+    {
+        logging_zone_metadata();
+    }
+    return TRUE;
+}
+
+// REPORT ZONES (ZONE MANAGEMENT IN, cmd ZONE_CMD_REPORT): zac_report_hdr_t and the descriptors of the zones
+// from the one that contains 'locator' on.
+// ZONE REPORT COMPACT (cmd ZONE_CMD_REPORT_COMPACT): zone_report_hdr_t and the descriptors of the zones that pass
+// the filter, from the start zone on. 'locator' is the LBA of the command (see ZR_START_ZONE() and ZR_FILTER()).
+// The report is num_sectors long and goes into the read buffers from sector locator % NSECT on,
+// where SATA_SECT_OFFSET of the command makes the host take it.
+void zns_report_zones(UINT32 const cmd, UINT32 const locator, UINT32 const num_sectors)
+{
+    BOOL32 const compact = (cmd == ZONE_CMD_REPORT_COMPACT);
+    UINT32 const slots_per_sect = BYTES_PER_SECTOR / (compact ? sizeof(zone_report_desc_t) : sizeof(zac_zone_desc_t));
+    UINT32 const num_zones = MIN(NZONE, NUM_LSECTORS / ZONE_SIZE);
+    UINT32 const filter = compact ? ZR_FILTER(locator) : 0;
+    UINT32 const first = compact ? ZR_START_ZONE(locator) : locator / ZONE_SIZE;
+    UINT32 zone = first;
+    UINT32 sect_offset = locator % NSECT;
+    UINT32 done = 0;
+
+    while (done < num_sectors)
+    {
+        UINT32 next_read_buf_id = (g_ftl_read_buf_id + 1) % NUM_RD_BUFFERS;
+        UINT32 num_sectors_to_fill = MIN(num_sectors - done, NSECT - sect_offset);
+        UINT32 buf_addr = RD_BUF_PTR(g_ftl_read_buf_id) + sect_offset * BYTES_PER_SECTOR;
+        UINT32 slot;
+
+        #if OPTION_FTL_TEST == 0
+        while (next_read_buf_id == GETREG(SATA_RBUF_PTR));	// wait if the read buffer is full (slow host)
+        #endif
+
+        mem_set_dram(buf_addr, 0, num_sectors_to_fill * BYTES_PER_SECTOR);
+
+        // slot 0 of the report is the header, and the other slots are the descriptors of the reported zones in ascending order
+        for (slot = done * slots_per_sect; slot < (done + num_sectors_to_fill) * slots_per_sect; slot++)
+        {
+            UINT32 slot_addr = buf_addr + (slot - done * slots_per_sect) * (BYTES_PER_SECTOR / slots_per_sect);
+
+            if (slot == 0 && compact)
+            {
+                zone_report_hdr_t hdr;
+                UINT32 z;
+
+                mem_set_sram(&hdr, 0, sizeof(hdr));
+                for (z = first; z < num_zones; z++)
+                {
+                    hdr.num_zones += is_reported_zone(z, filter);
+                }
+                hdr.max_lba = MAX_LBA;
+                hdr.zone_size = ZONE_SIZE;
+                hdr.num_conv_zones = NUM_CONV_ZONES;
+                mem_copy(slot_addr, &hdr, sizeof(hdr));
+            }
+            else if (slot == 0)
+            {
+                zac_report_hdr_t hdr;
+
+                mem_set_sram(&hdr, 0, sizeof(hdr));
+                hdr.zone_list_length = (first < num_zones) ? (num_zones - first) * sizeof(zac_zone_desc_t) : 0;
+                hdr.max_lba = MAX_LBA;
+                mem_copy(slot_addr, &hdr, sizeof(hdr));
+            }
+            else
+            {
+                while (zone < num_zones && !is_reported_zone(zone, filter))
+                {
+                    zone++;
+                }
+                if (zone >= num_zones)
+                {
+                    break;
+                }
+                if (compact)
+                {
+                    zone_report_desc_t desc;
+
+                    get_zone_report_desc(zone, &desc);
+                    mem_copy(slot_addr, &desc, sizeof(desc));
+                }
+                else
+                {
+                    zac_zone_desc_t desc;
+
+                    get_zone_desc(zone, &desc);
+                    mem_copy(slot_addr, &desc, sizeof(desc));
+                }
+                zone++;
+            }
+        }
+
+        // the reads issued to the previous read buffers must complete before bm_read_limit is moved by hand
+        flash_finish();
+
+        SETREG(BM_STACK_RDSET, next_read_buf_id);	// change bm_read_limit
+        SETREG(BM_STACK_RESET, 0x02);				// change bm_read_limit
+
+        g_ftl_read_buf_id = next_read_buf_id;
+
+        done += num_sectors_to_fill;
+        sect_offset = 0;
+    }
+}
+
+// ZR_STATE_* of a zone; the states of the sequential write zones have the values of get_zone_state()
+static UINT32 get_zone_report_state(UINT32 const zone)
+{
+    return (zone < NUM_CONV_ZONES) ? ZR_STATE_CONV : get_zone_state(zone);
+}
+
+// filter: a mask of (1 << ZR_STATE_*), 0 for every zone
+static BOOL32 is_reported_zone(UINT32 const zone, UINT32 const filter)
+{
+    return filter == 0 || (filter & (1 << get_zone_report_state(zone))) != 0;
+}
+
+// A TL_OPEN zone is reported as open, with the TL write pointer.
+static void get_zone_desc(UINT32 const zone, zac_zone_desc_t* const desc)
+{
+    mem_set_sram(desc, 0, sizeof(zac_zone_desc_t));
+
+    desc->zone_length = ZONE_SIZE;
+    desc->zone_start_lba = get_zone_slba(zone);
+
+    if (zone < NUM_CONV_ZONES)
+    {
+        desc->zone_type = ZAC_ZONE_TYPE_CONV;
+        desc->zone_condition = ZAC_ZC_NOT_WP << 4;
+        desc->write_pointer = 0xFFFFFFFFFFFFFFFFULL;
+        return;
+    }
+
+    desc->zone_type = ZAC_ZONE_TYPE_SEQ_REQ;
+    desc->write_pointer = get_zone_wp(zone);
+
+    switch (get_zone_state(zone))
+    {
+        case ZONE_EMPTY:
+            desc->zone_condition = ZAC_ZC_EMPTY << 4;
+            break;
+        case ZONE_OPEN:
+            desc->zone_condition = ZAC_ZC_IMP_OPEN << 4;
+            break;
+        case ZONE_FULL:
+            desc->zone_condition = ZAC_ZC_FULL << 4;
+            break;
+        case ZONE_CLOSED:
+            desc->zone_condition = ZAC_ZC_CLOSED << 4;
+            break;
+        default:
+            desc->zone_condition = ZAC_ZC_IMP_OPEN << 4;
+            desc->write_pointer = get_zone_slba(zone) + get_TL_wp(zone);
+            break;
+    }
+}
+
+static void get_zone_report_desc(UINT32 const zone, zone_report_desc_t* const desc)
+{
+    mem_set_sram(desc, 0, sizeof(zone_report_desc_t));
+
+    desc->zone_start_lba = get_zone_slba(zone);
+    desc->zone_capacity = ZONE_SIZE;
+    desc->zone_state = get_zone_report_state(zone);
+    desc->fcg = ZONE_FCG(zone);
+
+    if (desc->zone_state == ZR_STATE_CONV)
+    {
+        desc->write_pointer = INVALID32;
+    }
+    else if (desc->zone_state == ZR_STATE_TL_OPEN)
+    {
+        UINT32 page = find_TL_page(zone, get_TL_wp(zone) / NSECT, 1);
+        UINT32 end;
+
+        desc->write_pointer = get_zone_slba(zone) + get_TL_wp(zone);
+
+        // runs of valid pages
+        while (page < DEG_ZONE * NPAGE)
+        {
+            end = find_TL_page(zone, page, 0);
+            desc->tl_valid_pages += end - page;
+            page = find_TL_page(zone, end, 1);
+        }
+    }
+    else
+    {
+        desc->write_pointer = get_zone_wp(zone);
+    }
+}
+
+// The ZNS+ commands on the sequential write zone that starts at zslba. Their payload is in the current write buffer
+// from sector zslba % NSECT on and must fit into it:
+//	ZONE_CMD_COMPACT	UINT32 start LBA of the destination zone, UINT32 number of pages, UINT32 source zone page of each destination page
+//						or, for a Simple Copy into this zone, UINT32 ZC_SIMPLE_COPY | number of ranges and a simple_copy_range_t per range
+//	ZONE_CMD_TL_OPEN	UINT8 per zone page, 1 if the page is valid (copied into the TL_OPEN zone by the FTL)
+// A command that does not fit the zones is dropped; the host finds out from the zone report (or the simple copy log).
+void zns_payload_cmd(UINT32 const cmd, UINT32 const zslba, UINT32 const num_sectors)
+{
+    UINT32 sect_offset = zslba % NSECT;
+    UINT32 num_bufs = (sect_offset + num_sectors + NSECT - 1) / NSECT;
+    UINT32 payload_addr = WR_BUF_PTR(g_ftl_write_buf_id) + sect_offset * BYTES_PER_SECTOR;
+    UINT32 i;
+
+    #if OPTION_FTL_TEST == 0
+    while (g_ftl_write_buf_id == GETREG(SATA_WBUF_PTR));	// bm_write_limit should not outpace SATA_WBUF_PTR
+    #endif
+
+    if (cmd == ZONE_CMD_COMPACT && (read_dram_32(payload_addr) & ZC_SIMPLE_COPY))
+    {
+        UINT32 num_ranges = ZC_NUM_RANGES(read_dram_32(payload_addr));
+
+        if (num_bufs == 1 && is_seq_zone_start(zslba)
+            && sizeof(UINT32) + num_ranges * sizeof(simple_copy_range_t) <= num_sectors * BYTES_PER_SECTOR)
+        {
+            zns_simple_copy(zslba / ZONE_SIZE, payload_addr + sizeof(UINT32), num_ranges);
+        }
+        else
+        {
+            // every Simple Copy has its entry in the log, so that the host can match them with its commands
+            simple_copy_t entry;
+
+            entry.zslba = zslba;
+            entry.lba = INVALID32;
+            entry.num_sectors = 0;
+            entry.num_ranges = 0;
+            entry.status = SIMPLE_COPY_INVALID;
+            simple_copy_log(&entry);
+        }
+    }
+    else if (num_bufs == 1 && is_seq_zone_start(zslba))
+    {
+        if (cmd == ZONE_CMD_COMPACT)
+        {
+            UINT32 dest_zslba = read_dram_32(payload_addr);
+            UINT32 copy_len = read_dram_32(payload_addr + sizeof(UINT32));
+            BOOL32 valid = is_seq_zone_start(dest_zslba) && copy_len <= DEG_ZONE * NPAGE
+                && (2 + copy_len) * sizeof(UINT32) <= num_sectors * BYTES_PER_SECTOR;
+
+            for (i = 0; valid && i < copy_len; i++)
+            {
+                UINT32 src_page = read_dram_32(payload_addr + (2 + i) * sizeof(UINT32));
+
+                valid = (src_page < DEG_ZONE * NPAGE);
+                write_dram_32(IZC_ADDR + i * sizeof(UINT32), zslba / ZONE_SIZE * DEG_ZONE * NPAGE + src_page);
+            }
+            if (valid)
+            {
+                zns_izc(zslba / ZONE_SIZE, dest_zslba / ZONE_SIZE, copy_len, IZC_ADDR);
+            }
+        }
+        else if (cmd == ZONE_CMD_TL_OPEN && num_sectors * BYTES_PER_SECTOR >= DEG_ZONE * NPAGE)
+        {
+            for (i = 0; i < DEG_ZONE * NPAGE; i++)
+            {
+                write_dram_8(TL_ADDR + i, read_dram_8(payload_addr + i));
+            }
+            zns_tl_open(zslba / ZONE_SIZE, TL_ADDR);
+        }
+    }
+
+    for (i = 0; i < num_bufs; i++)
+    {
+        #if OPTION_FTL_TEST == 0
+        while (g_ftl_write_buf_id == GETREG(SATA_WBUF_PTR));
+        #endif
+        release_write_buf();
+    }
+}
+
+// izc_addr holds the source of each destination page (see copy_zone_pages()), all in src_zone.
+void zns_izc(UINT32 src_zone, UINT32 dest_zone, UINT32 copy_len, UINT32 izc_addr)
+{
+	ASSERT(src_zone < NZONE && dest_zone < NZONE);
+	if(src_zone == dest_zone) return;
+	if(get_zone_state(src_zone) != ZONE_FULL || get_zone_state(dest_zone) != ZONE_EMPTY) return;
+	if(open_zone(dest_zone) == FALSE) return;
+
+	copy_zone_pages(dest_zone, copy_len, izc_addr);
+
+	zns_reset(src_zone);
 	
-	set_TL_src_to_dest_zone(zone, dequeue_FBG());
+	if(copy_len == DEG_ZONE * NPAGE)
+	{
+		set_zone_full(dest_zone);
+	}
+	else
+	{
+		logging_zone_metadata();
+	}
+}
+
+// Simple Copy: the num_ranges simple_copy_range_t at range_addr are copied one after the other to dest_zone at its write pointer.
+// The ranges are taken up to the first one that is not in the programmed pages of a sequential write zone
+// or does not fit into the rest of dest_zone, and the outcome goes to the simple copy log.
+// Unlike zns_izc(), the source zones are left as they are; the host resets them when it sees fit.
+void zns_simple_copy(UINT32 const dest_zone, UINT32 const range_addr, UINT32 const num_ranges)
+{
+	UINT32 const state = get_zone_state(dest_zone);
+	UINT32 dest_page, copy_len = 0, r, i;
+	simple_copy_t entry;
+
+	entry.zslba = get_zone_slba(dest_zone);
+	entry.lba = get_zone_wp(dest_zone);
+	entry.num_sectors = 0;
+	entry.num_ranges = 0;
+	entry.status = SIMPLE_COPY_OK;
+
+	// the pages of the copy are programmed into the block group of the zone, so its write pointer must be on a page boundary
+	if ((state != ZONE_EMPTY && state != ZONE_OPEN && state != ZONE_CLOSED) || entry.lba % NSECT != 0)
+	{
+		entry.lba = INVALID32;
+		entry.status = SIMPLE_COPY_INVALID;
+		simple_copy_log(&entry);
+		return;
+	}
+	dest_page = (entry.lba - entry.zslba) / NSECT;
+
+	for (r = 0; r < num_ranges && entry.status == SIMPLE_COPY_OK; r++)
+	{
+		simple_copy_range_t range;
+
+		mem_copy(&range, range_addr + r * sizeof(simple_copy_range_t), sizeof(simple_copy_range_t));
+
+		if (is_seq_zone_start(range.zone_start_lba) == FALSE
+			|| range.page_offset > get_zone_programmed_pages(range.zone_start_lba / ZONE_SIZE)
+			|| range.num_pages > get_zone_programmed_pages(range.zone_start_lba / ZONE_SIZE) - range.page_offset)
+		{
+			entry.status = SIMPLE_COPY_RANGE;
+		}
+		else if (range.num_pages > DEG_ZONE * NPAGE - dest_page - copy_len)
+		{
+			entry.status = SIMPLE_COPY_FULL;
+		}
+		else
+		{
+			for (i = 0; i < range.num_pages; i++)
+			{
+				write_dram_32(IZC_ADDR + (copy_len + i) * sizeof(UINT32),
+							  range.zone_start_lba / ZONE_SIZE * DEG_ZONE * NPAGE + range.page_offset + i);
+			}
+			copy_len += range.num_pages;
+			entry.num_ranges++;
+		}
+	}
+
+	if (copy_len != 0)
+	{
+		if (state != ZONE_OPEN && open_zone(dest_zone) == FALSE)
+		{
+			entry.lba = INVALID32;
+			entry.num_ranges = 0;
+			entry.status = SIMPLE_COPY_INVALID;
+			simple_copy_log(&entry);
+			return;
+		}
+		g_open_zone_time[get_zone_to_ID(dest_zone)] = ++g_open_zone_clock;
+
+		copy_zone_pages(dest_zone, copy_len, IZC_ADDR);
+		entry.num_sectors = copy_len * NSECT;
+
+		if (dest_page + copy_len == DEG_ZONE * NPAGE)
+		{
+			set_zone_full(dest_zone);
+		}
+	}
+	simple_copy_log(&entry);
+}
+
+// zone pages that are in the block group of the zone (the partial page at the write pointer of an open or closed zone is not)
+static UINT32 get_zone_programmed_pages(UINT32 const zone)
+{
+	switch (get_zone_state(zone))
+	{
+		case ZONE_OPEN:
+		case ZONE_CLOSED:
+			return (get_zone_wp(zone) - get_zone_slba(zone)) / NSECT;
+		case ZONE_FULL:
+			return DEG_ZONE * NPAGE;
+		default:
+			return 0;	// empty, or TL_OPEN with its pages in two block groups
+	}
+}
+
+// Copy copy_len pages to the open zone dest_zone from its write pointer on, which is on a page boundary.
+// copy_addr holds the source of each page, zone * DEG_ZONE * NPAGE + zone page, in the programmed pages of a sequential write zone.
+// Consecutive pages of dest_zone are on consecutive banks (ZONE_BANK()), so the copies go in stripes of DEG_ZONE pages,
+// one page per bank, and the banks of a stripe work in parallel.
+// A page that stays on its bank is moved by copyback, without a round trip through DRAM.
+// A page that changes banks (or FCGs) is first read into ZONE_PROG_BUF of its destination bank;
+// all the reads of a stripe are issued before any of its programs, so that no read waits for a program of the stripe.
+// Each read and program waits only for the bank whose command it depends on, so the reads of a stripe
+// overlap the programs of the previous one on the other banks.
+static void copy_zone_pages(UINT32 const dest_zone, UINT32 const copy_len, UINT32 const copy_addr)
+{
+	UINT32 const first_page = (get_zone_wp(dest_zone) - get_zone_slba(dest_zone)) / NSECT;
+	UINT32 const dest_vblk = get_zone_to_FBG(dest_zone);
+	UINT32 stripe, i;
+
+	ASSERT(get_zone_state(dest_zone) == ZONE_OPEN && first_page + copy_len <= DEG_ZONE * NPAGE);
+
+	for(stripe = 0; stripe < copy_len; stripe += DEG_ZONE)
+	{
+		UINT32 stripe_end = MIN(stripe + DEG_ZONE, copy_len);
+
+		for(i = stripe; i < stripe_end; i++)
+		{
+			UINT32 src = read_dram_32(copy_addr + i * sizeof(UINT32));
+			UINT32 src_zone = src / (DEG_ZONE * NPAGE), src_page = src % (DEG_ZONE * NPAGE);
+			UINT32 bank = ZONE_BANK(dest_zone, first_page + i);
+
+			if (ZONE_BANK(src_zone, src_page) != bank)
+			{
+				// the previous program of the bank has read its staging buffer (see zns_page_program())
+				while ((GETREG(WR_STAT) & 0x00000001) != 0);
+				while (BSP_FSM(bank) != BANK_IDLE);
+
+				nand_page_ptread(ZONE_BANK(src_zone, src_page), get_zone_to_FBG(src_zone), src_page / DEG_ZONE, 0, NSECT,
+								 ZONE_PROG_BUF(bank), RETURN_ON_ISSUE);
+			}
+		}
+
+		for(i = stripe; i < stripe_end; i++)
+		{
+			UINT32 src = read_dram_32(copy_addr + i * sizeof(UINT32));
+			UINT32 src_zone = src / (DEG_ZONE * NPAGE), src_page = src % (DEG_ZONE * NPAGE);
+			UINT32 bank = ZONE_BANK(dest_zone, first_page + i);
+
+			if (ZONE_BANK(src_zone, src_page) == bank)
+			{
+				nand_page_copyback(bank, get_zone_to_FBG(src_zone), src_page / DEG_ZONE, dest_vblk, (first_page + i) / DEG_ZONE);
+			}
+			else
+			{
+				// the read into the staging buffer is done
+				while ((GETREG(WR_STAT) & 0x00000001) != 0);
+				while (BSP_FSM(ZONE_BANK(src_zone, src_page)) != BANK_IDLE);
+
+				nand_page_program(bank, dest_vblk, (first_page + i) / DEG_ZONE, ZONE_PROG_BUF(bank));
+			}
+			set_zone_wp(dest_zone, get_zone_wp(dest_zone) + NSECT);
+		}
+	}
+
+	// every page must be in the destination zone before a source zone is erased
+	flash_finish();
+}
+
+// A TL_OPEN zone takes one of the NUM_TL_ZONES slots of g_tl_zone and TL_BITMAP() until complete_tl().
+// tl_addr holds one byte per zone page, nonzero if the page is still valid.
+void zns_tl_open(UINT32 zone, UINT32 tl_addr)
+{
+	UINT32 slot, i, j, bits;
+
+	if(get_zone_state(zone) != ZONE_FULL) return;
+
+	for (slot = 0; slot < NUM_TL_ZONES && g_tl_zone[slot].zone != INVALID32; slot++);
+	if (slot == NUM_TL_ZONES) return;
+
+	// fewer than NUM_TL_ZONES zones are TL_OPEN, so there is an open zone to close
+	if(OPEN_ZONE == MAX_OPEN_ZONE) close_zone(lru_open_zone());
+
 	UINT8 open_id = dequeue_open_id();
 	set_zone_to_ID(zone, open_id);
-	set_zone_state(zone, 3);
+	set_zone_state(zone, ZONE_TL_OPEN);
 	OPEN_ZONE++;
-	
-	UINT8 flag = 0;
-	
-	for(UINT32 i = 0; i < DEG_ZONE * NPAGE; i++)
+
+	g_tl_zone[slot].zone = zone;
+	g_tl_zone[slot].wp = 0;
+	g_tl_zone[slot].dest_vblk = dequeue_FBG(ZONE_FCG(zone));
+	g_tl_slot_of[open_id] = slot;
+
+	for (i = 0; i < DEG_ZONE * NPAGE; i += 32)
 	{
-		UINT8 data = read_dram_8(tl_addr + i * sizeof(UINT8));
-		set_TL_bitmap(open_id, i, data);
-		if(data == 0) flag = 1;
+		bits = 0;
+
+		for (j = 0; j < 32; j++)
+		{
+			if (read_dram_8(tl_addr + i + j) != 0)
+			{
+				bits |= 1 << j;
+			}
+		}
+		write_dram_32(TL_BITMAP(slot) + i / 8, bits);
 	}
-	set_TL_wp(zone, 0);
-	
-	fill_tl(zone, zone*ZONE_SIZE, 0);
-	if(flag == 0)
+	logging_zone_metadata();
+
+	// the valid pages are copied in idle time (ftl_idle()), or when a host write needs the TL write pointer past them
+}
+
+// Copy the valid pages of a TL_OPEN zone at its TL write pointer to the destination block group,
+// up to zone page end_page and at most max_pages pages. The fill stops at the first page that the host has to write.
+// A valid page keeps its bank and page offset, so it is moved by copyback. Consecutive pages are on consecutive banks,
+// and the copybacks are issued without waiting for them.
+// returns the number of pages copied
+static UINT32 fill_tl(UINT32 const zone, UINT32 const end_page, UINT32 const max_pages)
+{
+	UINT32 src_vblk = get_zone_to_FBG(zone);
+	UINT32 dest_vblk = get_TL_src_to_dest_zone(zone);
+	UINT32 tl_wp = get_TL_wp(zone);
+	UINT32 page = tl_wp / NSECT;
+	UINT32 num_copied = 0;
+	UINT32 last;
+
+	if (tl_wp % NSECT != 0)
 	{
-		zns_reset(zone);
-        set_zone_state(zone, 2);
-        set_zone_to_FBG(zone, get_TL_src_to_dest_zone(zone));
-        OPEN_ZONE -= 1;
+		return 0;	// a page partially written by the host
+	}
+	last = MIN(MIN(end_page, page + max_pages), find_TL_page(zone, page, 0));
+
+	while (page < last)
+	{
+		nand_page_copyback(ZONE_BANK(zone, page), src_vblk, page / DEG_ZONE, dest_vblk, page / DEG_ZONE);
+		page++;
+		num_copied++;
+	}
+
+	if (num_copied != 0)
+	{
+		set_TL_wp(zone, page * NSECT);
+
+		if (page == DEG_ZONE * NPAGE)
+		{
+			complete_tl(zone);
+		}
 	}
+	return num_copied;
 }
 
-void fill_tl(int zone, int c_lba, int tl_num)
+// Every page of a TL_OPEN zone is in the destination block group: it becomes the zone's block group,
+// and the source block group waits for its erase.
+static void complete_tl(UINT32 const zone)
 {
-	UINT32 c_sect = c_lba % NSECT;
-	UINT32 c_bank = (c_lba / NSECT) % DEG_ZONE;
-	UINT32 p_offset = (c_lba / NSECT / DEG_ZONE) % NPAGE;
-	if(tl_num >= ZONE_SIZE) return;
-	UINT8 open_id = get_zone_to_ID(zone);
-	if(get_TL_bitmap(open_id, tl_num / NSECT) == 0) return;
-	
-	zns_read_internal(c_lba, NSECT, TL_INTERNAL_BUFFER_ADDR);
-	set_TL_wp(zone, get_TL_wp(zone) + NSECT);
-	
-	nand_page_program(c_bank, get_TL_src_to_dest_zone(zone), p_offset, TL_INTERNAL_BUFFER_ADDR);
-	flash_finish();
-	
-	fill_tl(zone, c_lba + NSECT, tl_num + NSECT);
+	flash_finish();	// the copies from the source blocks are done, and the destination blocks are complete
+
+	UINT32 slot = get_tl_slot(zone);
+
+	enqueue_erase(ZONE_FCG(zone), get_zone_to_FBG(zone));
+	set_zone_to_FBG(zone, get_TL_src_to_dest_zone(zone));
+
+	g_tl_zone[slot].zone = INVALID32;
+	g_tl_slot_of[get_zone_to_ID(zone)] = NO_TL_SLOT;
+
+	set_zone_full(zone);
 }
 
 
@@ -1030,42 +2182,30 @@ void ftl_read(UINT32 const lba, UINT32 const num_sectors)
     UINT32 lpn, sect_offset;
     UINT32 bank, vpn;
 
+    if (lba & ZONE_CMD_MASK)
+    {
+        zns_report_zones(lba & ZONE_CMD_MASK, lba & ~ZONE_CMD_MASK, num_sectors);
+        return;
+    }
+
     lpn          = lba / SECTORS_PER_PAGE;
     sect_offset  = lba % SECTORS_PER_PAGE;
     remain_sects = num_sectors;
-    bank = get_num_bank(lpn);
-
-
-	if(lba == 7 && num_sectors == 7){
-		UINT32 next_read_buf_id = (g_ftl_read_buf_id+1) % NUM_RD_BUFFERS;
-		while(next_read_buf_id == GETREG(SATA_RBUF_PTR));
-		
-		flash_finish();
-		
-		SETREG(BM_STACK_RDSET, next_read_buf_id);
-		SETREG(BM_STACK_RESET, 0x02);
-		g_ftl_read_buf_id = next_read_buf_id;
-		
-        //print stats
-        uart_printf("gc_cnt : %d\n", g_ftl_statistics[bank].gc_cnt);
-        uart_printf("gc_write : %d\n", g_ftl_statistics[bank].gc_write);
-        uart_printf("host_write : %d\n", g_ftl_statistics[bank].host_write);
-        uart_printf("nand_write : %d\n", g_ftl_statistics[bank].nand_write);
-        uart_printf("page_wcount : %d\n", g_ftl_statistics[bank].page_wcount);
-
-
-
-		return;
-	}
 
     //seq_zone
-    if (lba >= 6*ZONE_SIZE) 
+    if (lba >= CONV_SECTORS)
     {
         zns_read(lba, num_sectors,g_ftl_read_buf_id);
     }
     //random_zone
     else 
     {
+        // the page map ends with the conventional zones (the spilled partial pages follow it):
+        // the sectors past them are read from the first sequential write zone
+        if (lba + num_sectors > CONV_SECTORS)
+        {
+            remain_sects = CONV_SECTORS - lba;
+        }
         while (remain_sects != 0)
         {
             if ((sect_offset + remain_sects) < SECTORS_PER_PAGE)
@@ -1076,6 +2216,8 @@ void ftl_read(UINT32 const lba, UINT32 const num_sectors)
             {
                 num_sectors_to_read = SECTORS_PER_PAGE - sect_offset;
             }
+            ASSERT(lpn < CONV_LPAGES);
+
             bank = get_num_bank(lpn); // page striping
             vpn  = get_vpn(lpn);
             CHECK_VPAGE(vpn);
@@ -1115,6 +2257,10 @@ void ftl_read(UINT32 const lba, UINT32 const num_sectors)
             remain_sects -= num_sectors_to_read;
             lpn++;
         }
+        if (lba + num_sectors > CONV_SECTORS)
+        {
+            zns_read(CONV_SECTORS, lba + num_sectors - CONV_SECTORS, g_ftl_read_buf_id);
+        }
     }
 }
 
@@ -1124,78 +2270,32 @@ void ftl_write(UINT32 const lba, UINT32 const num_sectors)
     UINT32 remain_sects, num_sectors_to_write;
     UINT32 lpn, sect_offset;
 
+    if ((lba & ZONE_CMD_MASK) == ZONE_CMD_APPEND)
+    {
+        zns_append(lba & ~ZONE_CMD_MASK, num_sectors);
+        return;
+    }
+    if (lba & ZONE_CMD_MASK)
+    {
+        zns_payload_cmd(lba & ZONE_CMD_MASK, lba & ~ZONE_CMD_MASK, num_sectors);
+        return;
+    }
+
     lpn          = lba / SECTORS_PER_PAGE;
     sect_offset  = lba % SECTORS_PER_PAGE;
     remain_sects = num_sectors;
 
 	g_ftl_statistics[get_num_bank(lpn)].host_write++;
 
-    if (lba == 7 && num_sectors == 11) // zone reset
-    {
-        while (g_ftl_write_buf_id == GETREG(SATA_WBUF_PTR));	// bm_write_limit should not outpace SATA_WBUF_PTR
-        UINT32 zone = read_dram_32(WR_BUF_PTR(g_ftl_write_buf_id) + lba * BYTES_PER_SECTOR);
-        g_ftl_write_buf_id = (g_ftl_write_buf_id + 1) % NUM_WR_BUFFERS;		// Circular buffer
-        flash_finish();
-        SETREG(BM_STACK_WRSET, g_ftl_write_buf_id);	// change bm_write_limit
-        SETREG(BM_STACK_RESET, 0x01);				// change bm_write_limit
-		zns_reset(zone);
-        //call zns_reset
-        return;
-    }
-    if (lba == 7 && num_sectors == 13) {
-        while (g_ftl_write_buf_id == GETREG(SATA_WBUF_PTR));	// bm_write_limit should not outpace SATA_WBUF_PTR
-        UINT32 zone_number = read_dram_32(WR_BUF_PTR(g_ftl_write_buf_id) + lba * BYTES_PER_SECTOR);
-        UINT32 zone_cnt = read_dram_32(WR_BUF_PTR(g_ftl_write_buf_id) + lba * BYTES_PER_SECTOR + sizeof(int));
-        g_ftl_write_buf_id = (g_ftl_write_buf_id + 1) % NUM_WR_BUFFERS;		// Circular buffer
-        flash_finish();
-        SETREG(BM_STACK_WRSET, g_ftl_write_buf_id);	// change bm_write_limit
-        SETREG(BM_STACK_RESET, 0x01);				// change bm_write_limit
-
-        zns_get_desc(zone_number, zone_cnt);
-        return;
-    }
-    if (lba == 1 && num_sectors == 31) {
-        //make DRAM addr for IZC (32KB DRAM)
-        while (g_ftl_write_buf_id == GETREG(SATA_WBUF_PTR));	// bm_write_limit should not outpace SATA_WBUF_PTR
-        UINT32 src_zone = read_dram_32(WR_BUF_PTR(g_ftl_write_buf_id) + lba * BYTES_PER_SECTOR);
-        UINT32 dst_zone = read_dram_32(WR_BUF_PTR(g_ftl_write_buf_id) + lba * BYTES_PER_SECTOR + sizeof(int));
-        UINT32 copy_len = read_dram_32(WR_BUF_PTR(g_ftl_write_buf_id) + lba * BYTES_PER_SECTOR + 2 * sizeof(int));
-        uart_printf("INTERNEL ZONE COMPACTION src zone is %d dst zone is %d copy len is %d\r\n", src_zone, dst_zone, copy_len);
-        mem_copy(IZC_ADDR,(WR_BUF_PTR(g_ftl_write_buf_id)+lba*BYTES_PER_SECTOR + 3*sizeof(int)), 1024*sizeof(int));
-        uart_printf("IZC_ADDR is %x", IZC_ADDR);
-        for (int i = 0; i < copy_len; i++) {
-            UINT32 data = read_dram_32(WR_BUF_PTR(g_ftl_write_buf_id) + lba * BYTES_PER_SECTOR + (3+i) * sizeof(int));
-            write_dram_32(IZC_ADDR + i * sizeof(int), data);
-        }
-		zns_izc(src_zone, dst_zone, copy_len, IZC_ADDR);
-        g_ftl_write_buf_id = (g_ftl_write_buf_id + 1) % NUM_WR_BUFFERS;		// Circular buffer
-        flash_finish();
-        SETREG(BM_STACK_WRSET, g_ftl_write_buf_id);	// change bm_write_limit
-        SETREG(BM_STACK_RESET, 0x01);
-        return;
-    }
-    if (lba == 3 && num_sectors == 29) {
-        //make DRAM addr for TL open (32KB DRAM)
-        while (g_ftl_write_buf_id == GETREG(SATA_WBUF_PTR));	// bm_write_limit should not outpace SATA_WBUF_PTR
-        UINT32 src_zone = read_dram_32(WR_BUF_PTR(g_ftl_write_buf_id) + lba * BYTES_PER_SECTOR);
-        //mem_copy(TL_ADDR,(WR_BUF_PTR(g_ftl_write_buf_id)+lba*BYTES_PER_SECTOR + 1*sizeof(int)), PAGES_PER_BLK*NUM_BANKS);
-		
-		for (int i = 0; i < DEG_ZONE * NPAGE; i++) {
-            UINT8 data = read_dram_8(WR_BUF_PTR(g_ftl_write_buf_id) + lba * BYTES_PER_SECTOR + sizeof(int) + i * sizeof(char));
-            write_dram_8(TL_ADDR + i * sizeof(char), data);
-        }
-		zns_tl_open(src_zone, TL_ADDR);
-		
-        g_ftl_write_buf_id = (g_ftl_write_buf_id + 1) % NUM_WR_BUFFERS;		// Circular buffer
-        flash_finish();
-        SETREG(BM_STACK_WRSET, g_ftl_write_buf_id);	// change bm_write_limit
-        SETREG(BM_STACK_RESET, 0x01);
-        return;
-    }
-    if (lba >= 6 * ZONE_SIZE) {
-        zns_write(lba, num_sectors, g_ftl_write_buf_id);
+    if (lba >= CONV_SECTORS) {
+        zns_write(lba, num_sectors);
     }
     else {
+        // the sectors past the conventional zones go to the first sequential write zone (see ftl_read())
+        if (lba + num_sectors > CONV_SECTORS)
+        {
+            remain_sects = CONV_SECTORS - lba;
+        }
         while (remain_sects != 0)
         {
             if ((sect_offset + remain_sects) < SECTORS_PER_PAGE)
@@ -1206,6 +2306,8 @@ void ftl_write(UINT32 const lba, UINT32 const num_sectors)
             {
                 num_sectors_to_write = SECTORS_PER_PAGE - sect_offset;
             }
+            ASSERT(lpn < CONV_LPAGES);
+
             // single page write individually
             write_page(lpn, sect_offset, num_sectors_to_write);
 
@@ -1213,6 +2315,10 @@ void ftl_write(UINT32 const lba, UINT32 const num_sectors)
             remain_sects -= num_sectors_to_write;
             lpn++;
         }
+        if (lba + num_sectors > CONV_SECTORS)
+        {
+            zns_write(CONV_SECTORS, lba + num_sectors - CONV_SECTORS);
+        }
     }
 }
 static void write_page(UINT32 const lpn, UINT32 const sect_offset, UINT32 const num_sectors)
@@ -1329,6 +2435,43 @@ static void write_page(UINT32 const lpn, UINT32 const sect_offset, UINT32 const
     set_vcount(bank, vblock, get_vcount(bank, vblock) + 1);
 }
 
+// Program a whole logical page from DRAM without waiting (a spilled partial page of an open zone, see spill_zone_buf()).
+// The page is staged in ZONE_PROG_BUF of its bank, so buf_addr can be reused at once.
+static void write_page_dram(UINT32 const lpn, UINT32 const buf_addr)
+{
+    UINT32 bank = get_num_bank(lpn);
+    UINT32 new_vpn, vblock, page_num;
+
+    CHECK_LPAGE(lpn);
+
+    // the old page stays mapped in a page map checkpoint taken by assign_new_write_vpn()
+    new_vpn  = assign_new_write_vpn(bank);
+    trim_page(lpn);
+    vblock   = new_vpn / PAGES_PER_BLK;
+    page_num = new_vpn % PAGES_PER_BLK;
+
+    g_ftl_statistics[bank].page_wcount++;
+
+    zns_page_program(bank, vblock, page_num, buf_addr);
+	g_ftl_statistics[bank].nand_write++;
+
+    set_lpn(bank, page_num, lpn);
+    set_vpn(lpn, new_vpn);
+    set_vcount(bank, vblock, get_vcount(bank, vblock) + 1);
+}
+// invalidate the page of a logical page, if it has one
+static void trim_page(UINT32 const lpn)
+{
+    UINT32 vpn = get_vpn(lpn);
+
+    if (vpn != NULL)
+    {
+        UINT32 bank = get_num_bank(lpn);
+
+        set_vcount(bank, vpn / PAGES_PER_BLK, get_vcount(bank, vpn / PAGES_PER_BLK) - 1);
+        write_dram_32(PAGE_MAP_ADDR + lpn * sizeof(UINT32), NULL);	// set_vpn() takes no NULL
+    }
+}
 // get vpn from PAGE_MAP
 static UINT32 get_vpn(UINT32 const lpn)
 {
@@ -1394,35 +2537,47 @@ static UINT32 assign_new_write_vpn(UINT32 const bank)
         nand_page_ptprogram(bank, vblock, PAGES_PER_BLK - 1, 0,
                             ((sizeof(UINT32) * PAGES_PER_BLK + BYTES_PER_SECTOR - 1 ) / BYTES_PER_SECTOR), FTL_BUF(bank));
 
-        mem_set_sram(g_misc_meta[bank].lpn_list_of_cur_vblock, 0x00000000, sizeof(UINT32) * PAGES_PER_BLK);
+        // write page -> next block
+        next_write_vblock(bank);
+
+        return get_cur_write_vpn(bank);
+    }
+    write_vpn++;
+    set_new_write_vpn(bank, write_vpn);
 
-        inc_full_blk_cnt(bank);
+    return write_vpn;
+}
+// The write vblock of the bank is full and its lpn list is programmed: the writes go on in the next free vblock,
+// or in the gc vblock after a garbage collection. The page map and the misc. metadata are checkpointed at every change
+// of write vblock (by garbage_collection() before it erases the victim), so the pages programmed after the last
+// checkpoint are all in the current write vblock, where roll_forward_write_vpn() finds them after a power loss.
+static void next_write_vblock(UINT32 const bank)
+{
+    UINT32 vblock = get_cur_write_vpn(bank) / PAGES_PER_BLK;
 
-        // do garbage collection if necessary
-        if (is_full_all_blks(bank))
-        {
-            garbage_collection(bank);
-            return get_cur_write_vpn(bank);
-        }
-        do
-        {
-            vblock++;
+    mem_set_sram(g_misc_meta[bank].lpn_list_of_cur_vblock, 0x00000000, sizeof(UINT32) * PAGES_PER_BLK);
 
-            ASSERT(vblock != VBLKS_PER_BANK);
-        }while (get_vcount(bank, vblock) == VC_MAX);
-    }
-    // write page -> next block
-    if (vblock != (write_vpn / PAGES_PER_BLK))
-    {
-        write_vpn = vblock * PAGES_PER_BLK;
-    }
-    else
+    inc_full_blk_cnt(bank);
+
+    // do garbage collection if necessary
+    if (is_full_all_blks(bank))
     {
-        write_vpn++;
+        ftl_stat_gc_begin(bank);
+        garbage_collection(bank);
+        ftl_stat_gc_end(bank);
+        return;
     }
-    set_new_write_vpn(bank, write_vpn);
+    do
+    {
+        vblock++;
 
-    return write_vpn;
+        ASSERT(vblock != VBLKS_PER_BANK);
+    }while (get_vcount(bank, vblock) == VC_MAX);
+
+    set_new_write_vpn(bank, vblock * PAGES_PER_BLK);
+
+    logging_pmap_table();
+    logging_misc_metadata();
 }
 static BOOL32 is_bad_block(UINT32 const bank, UINT32 const vblk_offset)
 {
@@ -1505,19 +2660,23 @@ static void garbage_collection(UINT32 const bank)
         ASSERT(free_vpn == (gc_vblock * PAGES_PER_BLK));
     }
 #endif
-    // 3. erase victim block
-    nand_block_erase(bank, vt_vblock);
     ASSERT((free_vpn % PAGES_PER_BLK) < (PAGES_PER_BLK - 2));
     ASSERT((free_vpn % PAGES_PER_BLK == vcount));
 
     uart_printf("gc page count : %d", vcount); 
 
-    // 4. update metadata
+    // 3. update metadata
     set_vcount(bank, vt_vblock, VC_MAX);
     set_vcount(bank, gc_vblock, vcount);
     set_new_write_vpn(bank, free_vpn); // set a free page for new write
     set_gc_vblock(bank, vt_vblock); // next free block (reserve for GC)
     dec_full_blk_cnt(bank); // decrease full block count
+
+    // 4. checkpoint the page map with the copies, then erase victim block
+    // (a victim left unerased by a power loss is erased by roll_forward_write_vpn())
+    logging_pmap_table();
+    logging_misc_metadata();
+    nand_block_erase(bank, vt_vblock);
     uart_print("garbage_collection end");
 }
 //-------------------------------------------------------------
@@ -1555,6 +2714,7 @@ static void format(void)
     uart_printf("VBLKS_PER_BANK: %d", VBLKS_PER_BANK);
     uart_printf("LBLKS_PER_BANK: %d", NUM_LPAGES / PAGES_PER_BLK / NUM_BANKS);
     uart_printf("META_BLKS_PER_BANK: %d", META_BLKS_PER_BANK);
+    uart_printf("DEG_ZONE: %d, NUM_FCG: %d", DEG_ZONE, NUM_FCG);
 
     //----------------------------------------
     // initialize DRAM metadata
@@ -1584,10 +2744,12 @@ static void format(void)
     // initialize SRAM metadata
     //----------------------------------------
     init_metadata_sram();
+    zns_format();
 
     // flush metadata to NAND
     logging_pmap_table();
     logging_misc_metadata();
+    logging_zone_metadata();
 
     write_format_mark();
 	led(1);
@@ -1598,13 +2760,18 @@ static void init_metadata_sram(void)
     UINT32 bank;
     UINT32 vblock;
     UINT32 mapblk_lbn;
+    UINT32 zonemeta_idx;
 
     //----------------------------------------
     // initialize misc. metadata
     //----------------------------------------
     for (bank = 0; bank < NUM_BANKS; bank++)
     {
-        g_misc_meta[bank].free_blk_cnt = 8;
+        g_misc_meta[bank].num_conv_zones = NUM_CONV_ZONES;
+        g_misc_meta[bank].deg_zone = DEG_ZONE;
+
+        // random write blocks + the free block for gc
+        g_misc_meta[bank].free_blk_cnt = RAND_WRITE_FBGS + 1;
         
         //g_misc_meta[bank].free_blk_cnt = rand_write_blks - META_BLKS_PER_BANK;
         //g_misc_meta[bank].free_blk_cnt -= get_bad_blk_cnt(bank);
@@ -1639,6 +2806,21 @@ static void init_metadata_sram(void)
             }
         }
         //----------------------------------------
+        // assign zone metadata blocks
+        //----------------------------------------
+        zonemeta_idx = 0;
+        while (zonemeta_idx < ZONEMETA_BLKS_PER_BANK)
+        {
+            vblock++;
+            ASSERT(vblock < VBLKS_PER_BANK);
+            if (is_bad_block(bank, vblock) == FALSE)
+            {
+                set_zonemeta_vbn(bank, zonemeta_idx, vblock);
+                write_dram_16(VCOUNT_ADDR + ((bank * VBLKS_PER_BANK) + vblock) * sizeof(UINT16), VC_MAX);
+                zonemeta_idx++;
+            }
+        }
+        //----------------------------------------
         // assign free block for gc
         //----------------------------------------
         do
@@ -1709,6 +2891,7 @@ static void logging_misc_metadata(void)
 }
 static void logging_pmap_table(void)
 {
+    UINT32 start_time = ftl_stat_time();
     UINT32 pmap_addr  = PAGE_MAP_ADDR;
     UINT32 pmap_bytes = BYTES_PER_PAGE; // per bank
     UINT32 mapblk_vpn;
@@ -1768,12 +2951,128 @@ static void logging_pmap_table(void)
         }
     }
     flash_finish();
+
+    ftl_stat_lat(LAT_PMAP_LOG, start_time);
+}
+// Checkpoint the zone metadata (ZONE_META_ADDR ~ ZONE_META_ADDR + ZONE_META_BYTES) into the zone metadata blocks.
+// Page i of the image is programmed to bank (i % NUM_BANKS), all banks at the same page offset.
+// The page with the header is programmed last, so a readable header means a complete checkpoint.
+// When the current block has no room for another checkpoint, the other block is erased and takes over.
+static void logging_zone_metadata(void)
+{
+    zone_meta_header hdr;
+    UINT32 page, bank;
+
+    flash_finish();
+
+    if (g_zonemeta_page + ZONEMETA_PAGES_PER_BANK > PAGES_PER_BLK)
+    {
+        g_zonemeta_blk = (g_zonemeta_blk + 1) % ZONEMETA_BLKS_PER_BANK;
+        g_zonemeta_page = 0;
+
+        for (bank = 0; bank < NUM_BANKS; bank++)
+        {
+            nand_block_erase(bank, get_zonemeta_vbn(bank, g_zonemeta_blk));
+        }
+    }
+    g_zonemeta_seq++;
+
+    flush_zone_cache();
+
+    hdr.signature       = ZONE_META_SIGNATURE;
+    hdr.version         = ZONE_META_VERSION;
+    hdr.seq             = g_zonemeta_seq;
+    mem_copy(hdr.fbq_rp, g_fbq_rp, sizeof(g_fbq_rp));
+    mem_copy(hdr.fbq_wp, g_fbq_wp, sizeof(g_fbq_wp));
+    hdr.erase_q_rp      = g_erase_q_rp;
+    hdr.erase_q_wp      = g_erase_q_wp;
+    hdr.open_id_rp      = rp_open;
+    hdr.open_id_wp      = wp_open;
+    hdr.num_open_zones  = OPEN_ZONE;
+    hdr.rand_write_blks = rand_write_blks;
+    mem_copy(hdr.tl, g_tl_zone, sizeof(g_tl_zone));
+
+    mem_set_dram(ZONE_META_HDR_ADDR, 0, ZONE_META_HDR_BYTES);
+    mem_copy(ZONE_META_HDR_ADDR, &hdr, sizeof(zone_meta_header));
+
+    // the flash reads the image straight from ZONE_META_ADDR, so wait for all pages before returning
+    for (page = ZONE_META_PAGES - 1; page != ((UINT32) -1); page--)
+    {
+        if (page == 0)
+        {
+            flash_finish();
+        }
+        bank = page % NUM_BANKS;
+
+        nand_page_ptprogram(bank,
+                            get_zonemeta_vbn(bank, g_zonemeta_blk),
+                            g_zonemeta_page + page / NUM_BANKS,
+                            0,
+                            MIN(SECTORS_PER_PAGE, (ZONE_META_BYTES - page * BYTES_PER_PAGE) / BYTES_PER_SECTOR),
+                            ZONE_META_ADDR + page * BYTES_PER_PAGE);
+    }
+    flash_finish();
+
+    g_zonemeta_page += ZONEMETA_PAGES_PER_BANK;
 }
 // load flushed FTL metadta
-static void load_metadata(void)
+static BOOL32 load_metadata(void)
 {
     load_misc_metadata();
+
+    // the page map and the metadata blocks are laid out for the conventional zones and the zone geometry
+    if (g_misc_meta[0].num_conv_zones != NUM_CONV_ZONES || g_misc_meta[0].deg_zone != DEG_ZONE)
+    {
+        return FALSE;
+    }
     load_pmap_table();
+
+    if (load_zone_metadata() == FALSE)
+    {
+        return FALSE;
+    }
+    roll_forward_write_vpn();
+
+    return TRUE;
+}
+// (called from load_metadata()) The pages programmed after the last page map checkpoint are in the current write vblock
+// of each bank, after cur_write_vpn (see next_write_vblock()). They stay unmapped, since their lpns are only known from
+// the lpn list at the end of a full vblock, but the write vpn is moved past them, so that no page is programmed twice.
+// A gc vblock that holds the copies of a garbage collection cut short, or the victim of a finished one, is erased.
+static void roll_forward_write_vpn(void)
+{
+    UINT32 bank, vblock, page_num;
+
+    flash_finish();
+
+	disable_irq();
+	flash_clear_irq();	// clear any flash interrupt flags that might have been set
+
+    for (bank = 0; bank < NUM_BANKS; bank++)
+    {
+        vblock = get_gc_vblock(bank);
+
+        if (is_page_erased(bank, vblock, 0) == FALSE || is_page_erased(bank, vblock, PAGES_PER_BLK - 1) == FALSE)
+        {
+            nand_block_erase(bank, vblock);
+        }
+        // the pages of a bank are programmed in order
+        vblock   = get_cur_write_vpn(bank) / PAGES_PER_BLK;
+        page_num = get_cur_write_vpn(bank) % PAGES_PER_BLK;
+
+        while (page_num < PAGES_PER_BLK - 2 && is_page_erased(bank, vblock, page_num + 1) == FALSE)
+        {
+            page_num++;
+        }
+        set_new_write_vpn(bank, vblock * PAGES_PER_BLK + page_num);
+
+        // the lpn list is programmed too, but the power was lost before the checkpoint of the next write vblock
+        if (page_num == PAGES_PER_BLK - 2 && is_page_erased(bank, vblock, PAGES_PER_BLK - 1) == FALSE)
+        {
+            next_write_vblock(bank);
+        }
+    }
+	enable_irq();
 }
 // misc + VCOUNT
 static void load_misc_metadata(void)
@@ -1844,7 +3143,7 @@ static void load_pmap_table(void)
     UINT32 pmap_addr = PAGE_MAP_ADDR;
     UINT32 temp_page_addr;
     UINT32 pmap_bytes = BYTES_PER_PAGE; // per bank
-    UINT32 pmap_boundary = PAGE_MAP_ADDR + (NUM_LPAGES * sizeof(UINT32));
+    UINT32 pmap_boundary = PAGE_MAP_ADDR + PAGE_MAP_BYTES;
     UINT32 mapblk_lbn, bank;
     BOOL32 finished = FALSE;
 
@@ -1904,6 +3203,237 @@ static void load_pmap_table(void)
         }
     }
 }
+// Load the latest zone metadata checkpoint and find the zone pages programmed after it.
+// Returns FALSE if there is no checkpoint.
+static BOOL32 load_zone_metadata(void)
+{
+    zone_meta_header hdr;
+    UINT32 blk, page, bank, lo, hi;
+    UINT32 zone, vblk, num_pages, wp;
+    BOOL32 found = FALSE;
+    BOOL32 rolled = FALSE;
+
+    for (blk = 0; blk < ZONEMETA_BLKS_PER_BANK; blk++)
+    {
+        if (get_zonemeta_vbn(0, blk) >= VBLKS_PER_BANK)
+        {
+            return FALSE;   // misc. metadata written by a firmware without zone metadata blocks
+        }
+    }
+    flash_finish();
+
+	disable_irq();
+	flash_clear_irq();	// clear any flash interrupt flags that might have been set
+
+    for (blk = 0; blk < ZONEMETA_BLKS_PER_BANK; blk++)
+    {
+        // Checkpoints are appended to a block, so a binary search on bank #0 finds the first unwritten one.
+        lo = 0;
+        hi = PAGES_PER_BLK / ZONEMETA_PAGES_PER_BANK;
+
+        while (lo < hi)
+        {
+            UINT32 mid = (lo + hi) / 2;
+
+            nand_page_ptread(0, get_zonemeta_vbn(0, blk), mid * ZONEMETA_PAGES_PER_BANK, 0, 1, FTL_BUF(0), RETURN_WHEN_DONE);
+
+            if (BSP_INTR(0) & FIRQ_ALL_FF)
+            {
+                hi = mid;
+            }
+            else
+            {
+                lo = mid + 1;
+            }
+            CLR_BSP_INTR(0, 0xFF);
+        }
+        // the latest readable header before it (a torn checkpoint has no readable header)
+        while (lo != 0)
+        {
+            lo--;
+            page = lo * ZONEMETA_PAGES_PER_BANK;
+
+            nand_page_ptread(0, get_zonemeta_vbn(0, blk), page, 0, 1, FTL_BUF(0), RETURN_WHEN_DONE);
+
+            if (BSP_INTR(0) & (FIRQ_ALL_FF | FIRQ_DATA_CORRUPT))
+            {
+                CLR_BSP_INTR(0, 0xFF);
+                continue;
+            }
+            CLR_BSP_INTR(0, 0xFF);
+
+            mem_copy(&hdr, FTL_BUF(0), sizeof(zone_meta_header));
+
+            if (hdr.signature == ZONE_META_SIGNATURE && hdr.version == ZONE_META_VERSION)
+            {
+                if (found == FALSE || hdr.seq > g_zonemeta_seq)
+                {
+                    found = TRUE;
+                    g_zonemeta_seq = hdr.seq;
+                    g_zonemeta_blk = blk;
+                    g_zonemeta_page = page;
+                }
+                break;
+            }
+        }
+    }
+    if (found == FALSE)
+    {
+        enable_irq();
+        return FALSE;
+    }
+    // read the image of the latest checkpoint
+    for (page = 0; page < ZONE_META_PAGES; page++)
+    {
+        bank = page % NUM_BANKS;
+
+        nand_page_ptread(bank,
+                         get_zonemeta_vbn(bank, g_zonemeta_blk),
+                         g_zonemeta_page + page / NUM_BANKS,
+                         0,
+                         MIN(SECTORS_PER_PAGE, (ZONE_META_BYTES - page * BYTES_PER_PAGE) / BYTES_PER_SECTOR),
+                         ZONE_META_ADDR + page * BYTES_PER_PAGE,
+                         RETURN_ON_ISSUE);
+    }
+    flash_finish();
+    init_zone_cache();
+
+    g_zonemeta_page += ZONEMETA_PAGES_PER_BANK;
+
+    mem_copy(&hdr, ZONE_META_HDR_ADDR, sizeof(zone_meta_header));
+    mem_copy(g_fbq_rp, hdr.fbq_rp, sizeof(g_fbq_rp));
+    mem_copy(g_fbq_wp, hdr.fbq_wp, sizeof(g_fbq_wp));
+    g_erase_q_rp    = hdr.erase_q_rp;
+    g_erase_q_wp    = hdr.erase_q_wp;
+    rp_open         = hdr.open_id_rp;
+    wp_open         = hdr.open_id_wp;
+    OPEN_ZONE       = hdr.num_open_zones;
+    rand_write_blks = hdr.rand_write_blks;
+    mem_copy(g_tl_zone, hdr.tl, sizeof(g_tl_zone));
+	wp_tlopen = 0; rp_tlopen = 0;
+	map_tl_slots();
+	map_open_zones();
+
+    // Move the write pointers of the open and closed zones to the pages programmed when the power was lost.
+    // The sectors of a partial page are kept if they had been spilled before the last page map checkpoint
+    // (FLUSH CACHE, see ftl_flush(), or a change of write vblock, see next_write_vblock()), and are lost otherwise.
+    for (zone = 0; zone < NZONE; zone++)
+    {
+        if (get_zone_state(zone) == ZONE_OPEN || get_zone_state(zone) == ZONE_CLOSED)
+        {
+            vblk = get_zone_to_FBG(zone);
+            num_pages = find_zone_page_wp(ZONE_FCG(zone), vblk, (get_zone_wp(zone) - get_zone_slba(zone)) / NSECT);
+            wp = get_zone_slba(zone) + num_pages * NSECT;
+
+            if (num_pages < NPAGE * DEG_ZONE)
+            {
+                wp += load_zone_tail(zone, vblk, num_pages);
+            }
+            if (wp != get_zone_wp(zone))
+            {
+                set_zone_wp(zone, wp);
+                rolled = TRUE;
+            }
+            if (num_pages == NPAGE * DEG_ZONE && get_zone_state(zone) == ZONE_CLOSED)
+            {
+                set_zone_state(zone, ZONE_FULL);    // filled after the checkpoint, with an open zone id it no longer has
+            }
+            else if (num_pages == NPAGE * DEG_ZONE)
+            {
+                set_zone_full(zone);
+            }
+        }
+        else if (get_zone_state(zone) == ZONE_TL_OPEN)
+        {
+            vblk = get_TL_src_to_dest_zone(zone);
+            num_pages = find_zone_page_wp(ZONE_FCG(zone), vblk, get_TL_wp(zone) / NSECT);
+            wp = num_pages * NSECT;
+
+            if (num_pages < NPAGE * DEG_ZONE)
+            {
+                wp += load_zone_tail(zone, vblk, num_pages);
+            }
+            if (wp != get_TL_wp(zone))
+            {
+                set_TL_wp(zone, wp);
+                rolled = TRUE;
+            }
+            if (num_pages == NPAGE * DEG_ZONE)
+            {
+                complete_tl(zone);
+            }
+        }
+    }
+	enable_irq();
+
+    // The next search must not start below a page skipped over by find_zone_page_wp().
+    if (rolled)
+    {
+        logging_zone_metadata();
+    }
+    return TRUE;
+}
+// zone page 'page_idx' of free block group 'vblk' of 'fcg' (in zone order: bank = fcg * DEG_ZONE + page_idx % DEG_ZONE)
+// has not been programmed
+static BOOL32 is_zone_page_erased(UINT32 const fcg, UINT32 const vblk, UINT32 const page_idx)
+{
+    UINT32 bank = fcg * DEG_ZONE + page_idx % DEG_ZONE;
+    BOOL32 erased;
+
+    nand_page_ptread(bank, vblk, page_idx / DEG_ZONE, 0, 1, FTL_BUF(bank), RETURN_WHEN_DONE);
+
+    // a page torn by a power loss reads as corrupted, and must not be programmed again either
+    erased = (BSP_INTR(bank) & FIRQ_ALL_FF) ? TRUE : FALSE;
+    CLR_BSP_INTR(bank, 0xFF);
+
+    return erased;
+}
+// page 'page_num' of 'vblk' of 'bank' has not been programmed
+// Unlike a zone page, a page mapped page may have been programmed with only some of its sectors (see write_page()).
+static BOOL32 is_page_erased(UINT32 const bank, UINT32 const vblk, UINT32 const page_num)
+{
+    BOOL32 erased;
+
+    nand_page_ptread(bank, vblk, page_num, 0, SECTORS_PER_PAGE, FTL_BUF(bank), RETURN_WHEN_DONE);
+
+    erased = (BSP_INTR(bank) & FIRQ_ALL_FF) ? TRUE : FALSE;
+    CLR_BSP_INTR(bank, 0xFF);
+
+    return erased;
+}
+// Number of zone pages of free block group 'vblk' of 'fcg' up to the last programmed one; pages before 'page_idx' are known to be programmed.
+// Zone pages are issued in order, but the programs in flight on different banks may have completed in any order
+// when the power was lost, so the DEG_ZONE pages after the first erased one are also checked.
+static UINT32 find_zone_page_wp(UINT32 const fcg, UINT32 const vblk, UINT32 const page_idx)
+{
+    UINT32 lo = page_idx;
+    UINT32 hi = NPAGE * DEG_ZONE;
+    UINT32 num_pages, i;
+
+    while (lo < hi)
+    {
+        UINT32 mid = (lo + hi) / 2;
+
+        if (is_zone_page_erased(fcg, vblk, mid))
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+    num_pages = lo;
+
+    for (i = lo + 1; i <= lo + DEG_ZONE && i < NPAGE * DEG_ZONE; i++)
+    {
+        if (is_zone_page_erased(fcg, vblk, i) == FALSE)
+        {
+            num_pages = i + 1;
+        }
+    }
+    return num_pages;
+}
 static void write_format_mark(void)
 {
 	// This function writes a format mark to a page at (bank #0, block #0).
@@ -2037,72 +3567,47 @@ void ftl_isr(void)
 
 UINT8 get_zone_state(UINT32 zone_number)
 {
-	ASSERT(zone_number < NBLK);
+	ASSERT(zone_number < NZONE);
 	UINT32 zone_state;
-	zone_state = read_dram_8(ZONE_STATE_ADDR + zone_number*sizeof(UINT8));
+	zone_state = get_zone_desc_cache(zone_number)->state;
 	
-	ASSERT(zone_state >=0 && zone_state <= 3);
+	ASSERT(zone_state <= ZONE_TL_OPEN || zone_state == ZONE_CLOSED);
 	
 	return zone_state;
 }
 void set_zone_state(UINT32 zone_number, UINT8 state)
 {
-	ASSERT(zone_number < NBLK);
-	ASSERT(state >=0 && state <= 3);
+	ASSERT(zone_number < NZONE);
+	ASSERT(state <= ZONE_TL_OPEN || state == ZONE_CLOSED);
+	get_zone_desc_cache(zone_number)->state = state;
 	write_dram_8(ZONE_STATE_ADDR + zone_number*sizeof(UINT8), state);
 }
 UINT32 get_zone_wp(UINT32 zone_number)
 {
-	ASSERT(zone_number < NBLK);
-	UINT32 zone_wp;
-	zone_wp = read_dram_32(ZONE_WP_ADDR + zone_number*sizeof(UINT32));
-	
-	return zone_wp;
+	ASSERT(zone_number < NZONE);
+	return get_zone_desc_cache(zone_number)->wp;
 }
 void set_zone_wp(UINT32 zone_number, UINT32 wp)
 {
-	ASSERT(zone_number < NBLK);
-	UINT32 zone_slba = read_dram_32(ZONE_SLBA_ADDR + zone_number*sizeof(UINT32));
-	
-	write_dram_32(ZONE_WP_ADDR + zone_number*sizeof(UINT32), wp);
+	ASSERT(zone_number < NZONE);
+	zone_desc_cache* desc = get_zone_desc_cache(zone_number);
+
+	desc->wp = wp;
+	desc->wp_dirty = TRUE;
 }
+// zones are laid out back to back from LBA 0
 UINT32 get_zone_slba(UINT32 zone_number)
 {
-	ASSERT(zone_number < NBLK);
-	UINT32 zone_slba;
-	zone_slba = read_dram_32(ZONE_SLBA_ADDR + zone_number*sizeof(UINT32));
-	
-	return zone_slba;
-}
-void set_zone_slba(UINT32 zone_number, UINT32 slba)
-{
-	ASSERT(zone_number < NBLK);
-	write_dram_32(ZONE_SLBA_ADDR + zone_number*sizeof(UINT32), slba);
-}
-
-UINT32 get_buffer_sector(UINT32 zone_number, UINT32 sector_offset)
-{
-	ASSERT(zone_number < NBLK);
-	ASSERT(sector_offset < SECTORS_PER_PAGE);
-	
-	UINT32 buf_data;
-	buf_data = read_dram_32(ZONE_BUFFER_ADDR + (zone_number * SECTORS_PER_PAGE + sector_offset) * sizeof(UINT32));
-	
-	return buf_data;
+	ASSERT(zone_number < NZONE);
+	return zone_number * ZONE_SIZE;
 }
-void set_buffer_sector(UINT32 zone_number, UINT32 sector_offset, UINT32 data)
-{
-	ASSERT(zone_number < NBLK);
-	ASSERT(sector_offset < SECTORS_PER_PAGE);
-	write_dram_32(ZONE_BUFFER_ADDR + (zone_number * SECTORS_PER_PAGE + sector_offset) * sizeof(UINT32), data);
 
-}
 
 UINT32 get_zone_to_FBG(UINT32 zone_number)
 {
-	ASSERT(zone_number < NBLK);
+	ASSERT(zone_number < NZONE);
 	UINT32 zone_FBG;
-	zone_FBG = read_dram_32(ZONE_TO_FBG_ADDR + zone_number*sizeof(UINT32));
+	zone_FBG = get_zone_desc_cache(zone_number)->fbg;
 	
 	ASSERT(zone_FBG < NBLK);
 	
@@ -2110,29 +3615,135 @@ UINT32 get_zone_to_FBG(UINT32 zone_number)
 }
 void set_zone_to_FBG(UINT32 zone_number, int FBG)
 {
-	ASSERT(zone_number < NBLK);
+	ASSERT(zone_number < NZONE);
 	ASSERT(FBG < NBLK);
+	get_zone_desc_cache(zone_number)->fbg = FBG;
 	write_dram_32(ZONE_TO_FBG_ADDR + zone_number*sizeof(UINT32), FBG);
 }
 
-void enqueue_FBG(UINT32 block_num)
+// The descriptor of 'zone' in the SRAM zone cache. A miss writes the write pointer of the zone
+// that held the entry back to DRAM and loads the descriptor of 'zone' from the DRAM arrays.
+static zone_desc_cache* get_zone_desc_cache(UINT32 const zone)
 {
-	ASSERT(block_num < NBLK);
-	wp = wp % NBLK;
-	write_dram_32(FBQ_ADDR + wp * sizeof(UINT32), block_num);
-	wp++;
+	zone_desc_cache* desc = &g_zone_cache[zone % ZONE_CACHE_SIZE];
+
+	if (desc->zone != zone)
+	{
+		if (desc->zone != INVALID32 && desc->wp_dirty)
+		{
+			write_dram_32(ZONE_WP_ADDR + desc->zone * sizeof(UINT32), desc->wp);
+		}
+		desc->zone     = zone;
+		desc->wp       = read_dram_32(ZONE_WP_ADDR + zone * sizeof(UINT32));
+		desc->fbg      = read_dram_32(ZONE_TO_FBG_ADDR + zone * sizeof(UINT32));
+		desc->state    = read_dram_8(ZONE_STATE_ADDR + zone * sizeof(UINT8));
+		desc->open_id  = read_dram_8(ZONE_TO_ID_ADDR + zone * sizeof(UINT8));
+		desc->wp_dirty = FALSE;
+	}
+	return desc;
+}
+// empty the zone cache without writing anything back (at boot, and after the DRAM arrays are loaded from a checkpoint)
+static void init_zone_cache(void)
+{
+	UINT32 i;
+
+	for (i = 0; i < ZONE_CACHE_SIZE; i++)
+	{
+		g_zone_cache[i].zone = INVALID32;
+		g_zone_cache[i].wp_dirty = FALSE;
+	}
+}
+// write the cached write pointers back to ZONE_WP_ADDR (before the zone metadata is checkpointed)
+static void flush_zone_cache(void)
+{
+	UINT32 i;
+
+	for (i = 0; i < ZONE_CACHE_SIZE; i++)
+	{
+		if (g_zone_cache[i].zone != INVALID32 && g_zone_cache[i].wp_dirty)
+		{
+			write_dram_32(ZONE_WP_ADDR + g_zone_cache[i].zone * sizeof(UINT32), g_zone_cache[i].wp);
+			g_zone_cache[i].wp_dirty = FALSE;
+		}
+	}
 }
-UINT32 dequeue_FBG(void)
+
+void enqueue_FBG(UINT32 const fcg, UINT32 block_num)
+{
+	ASSERT(fcg < NUM_FCG && block_num < NBLK);
+	g_fbq_wp[fcg] = g_fbq_wp[fcg] % NBLK;
+	write_dram_32(FBQ(fcg) + g_fbq_wp[fcg] * sizeof(UINT32), block_num);
+	g_fbq_wp[fcg]++;
+}
+UINT32 dequeue_FBG(UINT32 const fcg)
 {
-	rp = rp % NBLK;
-	UINT32 block_num = read_dram_32(FBQ_ADDR + rp * sizeof(UINT32));
-	rp++;
+	// no erased block group left in the FCG: erase the block groups of reset zones now, oldest first,
+	// until one of them is in the FCG
+	while (g_fbq_rp[fcg] % NBLK == g_fbq_wp[fcg] % NBLK)
+	{
+		BOOL32 erased = erase_pending_FBG(TRUE);
+
+		ASSERT(erased);
+	}
+	g_fbq_rp[fcg] = g_fbq_rp[fcg] % NBLK;
+	UINT32 block_num = read_dram_32(FBQ(fcg) + g_fbq_rp[fcg] * sizeof(UINT32));
+	g_fbq_rp[fcg]++;
 	ASSERT(block_num < NBLK);
 	return block_num;
 }
 
+// The block group of a reset zone is not erased at once: zns_reset() only updates the zone metadata.
+// An entry of the erase queue is fcg * NBLK + block_num.
+void enqueue_erase(UINT32 const fcg, UINT32 block_num)
+{
+	ASSERT(fcg < NUM_FCG && block_num < NBLK);
+	write_dram_32(ERASE_Q_ADDR + g_erase_q_wp * sizeof(UINT32), fcg * NBLK + block_num);
+	g_erase_q_wp = (g_erase_q_wp + 1) % NZONE;
+}
+// Erase the oldest block group of the erase queue on the banks of its FCG in parallel, and move it to the free
+// block group queue of the FCG. The programs of its next owner are queued behind the erase on each bank.
+// Without 'wait', nothing is issued unless the banks of the FCG are idle, so that idle time operations never wait for the flash.
+// returns FALSE if nothing was erased
+BOOL32 erase_pending_FBG(BOOL32 const wait)
+{
+	UINT32 entry, fcg, block_num, bank;
+
+	if (g_erase_q_rp == g_erase_q_wp)
+	{
+		return FALSE;
+	}
+	entry = read_dram_32(ERASE_Q_ADDR + g_erase_q_rp * sizeof(UINT32));
+	fcg = entry / NBLK;
+	block_num = entry % NBLK;
+
+	if (wait == FALSE)
+	{
+		if ((GETREG(WR_STAT) & 0x00000001) != 0)
+		{
+			return FALSE;
+		}
+		for (bank = fcg * DEG_ZONE; bank < (fcg + 1) * DEG_ZONE; bank++)
+		{
+			if (BSP_FSM(bank) != BANK_IDLE)
+			{
+				return FALSE;
+			}
+		}
+	}
+	g_erase_q_rp = (g_erase_q_rp + 1) % NZONE;
+
+	for (bank = fcg * DEG_ZONE; bank < (fcg + 1) * DEG_ZONE; bank++)
+	{
+		nand_block_erase(bank, block_num);
+	}
+	enqueue_FBG(fcg, block_num);
+
+	return TRUE;
+}
+
 void enqueue_open_id(UINT8 open_zone_id)
 {
+	g_open_zone_of[open_zone_id] = INVALID16;
 	wp_open = wp_open % MAX_OPEN_ZONE;
 	write_dram_8(OPEN_ZONE_Q_ADDR + wp_open * sizeof(UINT8), open_zone_id);
 	wp_open++;
@@ -2148,48 +3759,73 @@ UINT8 dequeue_open_id(void)
 
 UINT8 get_zone_to_ID(UINT32 zone_number)
 {
-	return read_dram_8(ZONE_TO_ID_ADDR + zone_number * sizeof(UINT8));
+	return get_zone_desc_cache(zone_number)->open_id;
 }
 void set_zone_to_ID(UINT32 zone_number, UINT8 id)
 {
+	g_open_zone_of[id] = zone_number;
+	get_zone_desc_cache(zone_number)->open_id = id;
 	write_dram_8(ZONE_TO_ID_ADDR + zone_number * sizeof(UINT8), id);
 }
 // ZNS+
 
-UINT8 get_TL_bitmap(UINT32 open_id, UINT32 page_offset)
+// TL slot of a TL_OPEN zone
+static UINT32 get_tl_slot(UINT32 const zone)
+{
+	UINT32 slot = g_tl_slot_of[get_zone_to_ID(zone)];
+
+	ASSERT(slot < NUM_TL_ZONES && g_tl_zone[slot].zone == zone);
+	return slot;
+}
+// g_tl_slot_of from g_tl_zone (after a format or a checkpoint load)
+static void map_tl_slots(void)
 {
-	ASSERT(open_id < MAX_OPEN_ZONE);
-	ASSERT(page_offset < NPAGE * DEG_ZONE);
-	UINT8 data = read_dram_8(TL_BITMAP_ADDR + (open_id * (NPAGE * DEG_ZONE) + page_offset)*sizeof(UINT8));
-	ASSERT(data == 1 || data == 0);
-	return data;
+	UINT32 i;
+
+	for (i = 0; i < MAX_OPEN_ZONE; i++)
+	{
+		g_tl_slot_of[i] = NO_TL_SLOT;
+	}
+	for (i = 0; i < NUM_TL_ZONES; i++)
+	{
+		if (g_tl_zone[i].zone != INVALID32)
+		{
+			g_tl_slot_of[get_zone_to_ID(g_tl_zone[i].zone)] = i;
+		}
+	}
 }
-void set_TL_bitmap(UINT32 open_id, UINT32 page_offset,  UINT8 data)
+// The first page from page_offset on whose TL bitmap bit is val, NPAGE * DEG_ZONE if there is none.
+// The memory utility engine searches from a word boundary, so the pages before it are looked at one by one.
+static UINT32 find_TL_page(UINT32 const zone, UINT32 page_offset, UINT32 const val)
 {
-	ASSERT(open_id < MAX_OPEN_ZONE);
-	ASSERT(page_offset < NPAGE * DEG_ZONE);
-	ASSERT(data == 1 || data == 0);
-	write_dram_8(TL_BITMAP_ADDR + open_id * (NPAGE * DEG_ZONE) + page_offset, data);
+	UINT32 bitmap = TL_BITMAP(get_tl_slot(zone));
+
+	for (; page_offset % 32 != 0 && page_offset < NPAGE * DEG_ZONE; page_offset++)
+	{
+		if (((read_dram_8(bitmap + page_offset / 8) >> (page_offset % 8)) & 1) == val)
+		{
+			return page_offset;
+		}
+	}
+	if (page_offset >= NPAGE * DEG_ZONE)
+	{
+		return NPAGE * DEG_ZONE;
+	}
+	return page_offset + mem_bmp_find_dram(bitmap + page_offset / 8, (NPAGE * DEG_ZONE - page_offset) / 8, val);
 }
+
 UINT32 get_TL_wp(UINT32 zone_number)
 {
-	ASSERT(zone_number < NBLK);
-	UINT32 wp = read_dram_32(TL_WP_ADDR + zone_number*sizeof(UINT32));
-	return wp;
+	ASSERT(zone_number < NZONE);
+	return g_tl_zone[get_tl_slot(zone_number)].wp;
 }
 void set_TL_wp(UINT32 zone_number, UINT32 wp)
 {
-	ASSERT(zone_number < NBLK);
-	write_dram_32(TL_WP_ADDR + zone_number*sizeof(UINT32), wp);
+	ASSERT(zone_number < NZONE);
+	g_tl_zone[get_tl_slot(zone_number)].wp = wp;
 }
 UINT32 get_TL_src_to_dest_zone(UINT32 zone_number)
 {
-	ASSERT(zone_number < NBLK);
-	UINT32 data = read_dram_32(TL_NUM_ADDR + zone_number * sizeof(UINT32));
-	return data;
-}
-void set_TL_src_to_dest_zone(UINT32 zone_number, UINT32 num)
-{
-	ASSERT(zone_number < NBLK);
-	write_dram_32(TL_NUM_ADDR + zone_number * sizeof(UINT32), num);
+	ASSERT(zone_number < NZONE);
+	return g_tl_zone[get_tl_slot(zone_number)].dest_vblk;
 }
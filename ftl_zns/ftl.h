@@ -28,7 +28,13 @@
 // ZONE 
 /////////////////
 
+// A zone is striped over DEG_ZONE banks, one flash channel group (FCG) of the NUM_FCG ones: zone n is in FCG n % NUM_FCG,
+// on banks (n % NUM_FCG) * DEG_ZONE ~ + DEG_ZONE - 1, so that consecutive zones are written in parallel on disjoint banks.
+// DEG_ZONE is set with -DDEG_ZONE=n (make FTL=zns ZONE_BANKS=n in build_host). A drive formatted with another
+// zone geometry is formatted again (see load_metadata() in ftl.c).
+#ifndef DEG_ZONE
 #define DEG_ZONE  NUM_BANKS
+#endif
 #define NUM_FCG  (NUM_BANKS / DEG_ZONE)
 #define ZONE_SIZE (PAGES_PER_VBLK*DEG_ZONE*SECTORS_PER_PAGE)
 #define NPAGE PAGES_PER_VBLK
@@ -36,7 +42,34 @@
 #define NBLK  VBLKS_PER_BANK
 #define NZONE (NUM_FCG*NBLK)
 
-#define MAX_OPEN_ZONE 100
+#define MAX_OPEN_ZONE 255		// open zone ids are UINT8
+
+// get_zone_state() of a sequential write zone, reported as is by ZONE REPORT COMPACT (ZR_STATE_* in sata.h)
+#define ZONE_EMPTY		ZR_STATE_EMPTY
+#define ZONE_OPEN		ZR_STATE_OPEN
+#define ZONE_FULL		ZR_STATE_FULL
+#define ZONE_TL_OPEN	ZR_STATE_TL_OPEN
+#define ZONE_CLOSED		ZR_STATE_CLOSED
+
+// The zones from LBA 0 up to CONV_SECTORS are conventional: written at random and page mapped, the rest are sequential write zones.
+// The page map covers only them and one spilled partial page per sequential write zone. A drive formatted with another
+// number of conventional zones is formatted again (see load_metadata() in ftl.c).
+#ifndef NUM_CONV_ZONES
+#define NUM_CONV_ZONES	6
+#endif
+#define CONV_SECTORS	(NUM_CONV_ZONES * ZONE_SIZE)
+#define CONV_LPAGES		(CONV_SECTORS / SECTORS_PER_PAGE)
+
+#define FTL_ZONE_APPEND		// ftl_write() takes Zone Append commands (ZONE_CMD_APPEND, see zns_append() in ftl.c)
+#define FTL_ZONE_MGMT		// ZONE MANAGEMENT IN/OUT and the ZNS+ commands (ftl_zone_mgmt(), ZONE_CMD_* in ftl_read() and ftl_write())
+
+#if NUM_BANKS % DEG_ZONE != 0
+#error "the banks are divided into flash channel groups of DEG_ZONE banks"
+#endif
+
+#if NUM_LSECTORS > 0x10000000
+#error "LBAs overlap ZONE_CMD_MASK (include/sata.h)"
+#endif
 
 /////////////////
 // DRAM buffers
@@ -49,8 +82,11 @@
 #define NUM_FTL_BUFFERS		NUM_BANKS
 #define NUM_HIL_BUFFERS		1
 #define NUM_TEMP_BUFFERS	1
+#define NUM_ZONE_PROG_BUFFERS	NUM_BANKS
+#define NUM_ZONE_BUFFERS	32				// the partial pages of the open zones (see get_zone_buf() in ftl.c)
+#define NUM_TL_ZONES		16				// TL_OPEN zones at a time (see zns_tl_open() in ftl.c)
 
-#define DRAM_BYTES_OTHER	((NUM_COPY_BUFFERS + NUM_FTL_BUFFERS + NUM_HIL_BUFFERS + NUM_TEMP_BUFFERS) * BYTES_PER_PAGE + BAD_BLK_BMP_BYTES + PAGE_MAP_BYTES + VCOUNT_BYTES + ZONE_STATE_BYTES + ZONE_WP_BYTES + ZONE_SLBA_BYTES +ZONE_BUFFER_BYTES +ZONE_TO_FBG_BYTES + FBQ_BYTES + OPEN_ZONE_Q_BYTES + ZONE_TO_ID_BYTES + IZC_BYTES + TL_INTERNAL_BUFFER_BYTES + TL_BYTES + TL_BITMAP_BYTES +TL_WP_BYTES + TL_NUM_BYTES)
+#define DRAM_BYTES_OTHER	((NUM_COPY_BUFFERS + NUM_FTL_BUFFERS + NUM_HIL_BUFFERS + NUM_TEMP_BUFFERS + NUM_ZONE_PROG_BUFFERS) * BYTES_PER_PAGE + BAD_BLK_BMP_BYTES + PAGE_MAP_BYTES + VCOUNT_BYTES + ZONE_META_HDR_BYTES + ZONE_STATE_BYTES + ZONE_WP_BYTES +ZONE_BUFFER_BYTES +ZONE_TO_FBG_BYTES + FBQ_BYTES + OPEN_ZONE_Q_BYTES + ZONE_TO_ID_BYTES + IZC_BYTES + TL_BYTES + TL_BITMAP_BYTES + ERASE_Q_BYTES + FLASH_TRACE_BYTES + ZONE_APPEND_BYTES + SIMPLE_COPY_BYTES + DRAM_ECC_UNIT)
 
 
 #define WR_BUF_PTR(BUF_ID)	(WR_BUF_ADDR + ((UINT32)(BUF_ID)) * BYTES_PER_PAGE)
@@ -61,6 +97,8 @@
 #define _COPY_BUF(RBANK)	(COPY_BUF_ADDR + (RBANK) * BYTES_PER_PAGE)
 #define COPY_BUF(BANK)		_COPY_BUF(REAL_BANK(BANK))
 #define FTL_BUF(BANK)       (FTL_BUF_ADDR + ((BANK) * BYTES_PER_PAGE))
+#define ZONE_PROG_BUF(BANK)	(ZONE_PROG_BUF_ADDR + ((BANK) * BYTES_PER_PAGE))
+#define ZONE_BUF(IDX)		(ZONE_BUFFER_ADDR + ((IDX) * BYTES_PER_PAGE))
 
 ///////////////////////////////
 // DRAM segmentation
@@ -84,61 +122,81 @@
 #define TEMP_BUF_ADDR		(HIL_BUF_ADDR + HIL_BUF_BYTES)					// general purpose buffer
 #define TEMP_BUF_BYTES		(NUM_TEMP_BUFFERS * BYTES_PER_PAGE)
 
-#define BAD_BLK_BMP_ADDR	(TEMP_BUF_ADDR + TEMP_BUF_BYTES)				// bitmap of initial bad blocks
+#define ZONE_PROG_BUF_ADDR	(TEMP_BUF_ADDR + TEMP_BUF_BYTES)				// zone pages being programmed, one per bank
+#define ZONE_PROG_BUF_BYTES	(NUM_ZONE_PROG_BUFFERS * BYTES_PER_PAGE)
+
+#define BAD_BLK_BMP_ADDR	(ZONE_PROG_BUF_ADDR + ZONE_PROG_BUF_BYTES)		// bitmap of initial bad blocks
 #define BAD_BLK_BMP_BYTES	(((NUM_VBLKS / 8) + DRAM_ECC_UNIT - 1) / DRAM_ECC_UNIT * DRAM_ECC_UNIT)
 
-#define PAGE_MAP_ADDR		(BAD_BLK_BMP_ADDR + BAD_BLK_BMP_BYTES)			// page mapping table
-#define PAGE_MAP_BYTES		((NUM_LPAGES * sizeof(UINT32) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
+#define PAGE_MAP_ADDR		(BAD_BLK_BMP_ADDR + BAD_BLK_BMP_BYTES)			// page mapping table of the conventional zones
+#define PAGE_MAP_ENTRIES	(CONV_LPAGES + NZONE - NUM_CONV_ZONES)			// and of the spilled partial pages (ZONE_SPILL_LPN() in ftl.c)
+#define PAGE_MAP_BYTES		((PAGE_MAP_ENTRIES * sizeof(UINT32) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
 
 #define VCOUNT_ADDR			(PAGE_MAP_ADDR + PAGE_MAP_BYTES)
 #define VCOUNT_BYTES		((NUM_BANKS * VBLKS_PER_BANK * sizeof(UINT16) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
 
-#define ZONE_STATE_ADDR		(VCOUNT_ADDR + VCOUNT_BYTES)
-#define ZONE_STATE_BYTES	((NBLK * sizeof(UINT8) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
+// zone metadata, checkpointed to the zone metadata blocks as one image (see logging_zone_metadata())
+#define ZONE_META_ADDR		(VCOUNT_ADDR + VCOUNT_BYTES)
+
+#define ZONE_META_HDR_ADDR	ZONE_META_ADDR									// checkpoint header: sequence number and the SRAM zone variables
+#define ZONE_META_HDR_BYTES	BYTES_PER_SECTOR
+
+#define ZONE_STATE_ADDR		(ZONE_META_HDR_ADDR + ZONE_META_HDR_BYTES)
+#define ZONE_STATE_BYTES	((NZONE * sizeof(UINT8) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
 #define ZONE_WP_ADDR		(ZONE_STATE_ADDR + ZONE_STATE_BYTES)
-#define ZONE_WP_BYTES		((NBLK * sizeof(UINT32) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
-#define ZONE_SLBA_ADDR		(ZONE_WP_ADDR + ZONE_WP_BYTES)
-#define ZONE_SLBA_BYTES		((NBLK * sizeof(UINT32) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
+#define ZONE_WP_BYTES		((NZONE * sizeof(UINT32) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
 
-#define ZONE_BUFFER_ADDR	(ZONE_SLBA_ADDR + ZONE_SLBA_BYTES)
-#define ZONE_BUFFER_BYTES	((MAX_OPEN_ZONE * BYTES_PER_PAGE + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
+#define ZONE_TO_FBG_ADDR	(ZONE_WP_ADDR + ZONE_WP_BYTES)
+#define ZONE_TO_FBG_BYTES	((NZONE * sizeof(UINT32) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
 
-#define ZONE_TO_FBG_ADDR	(ZONE_BUFFER_ADDR + ZONE_BUFFER_BYTES)
-#define ZONE_TO_FBG_BYTES	((NBLK * sizeof(UINT32) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
+#define FBQ_ADDR			(ZONE_TO_FBG_ADDR + ZONE_TO_FBG_BYTES)				// free block groups, a ring of NBLK entries per FCG
+#define FBQ_BYTES			((NZONE * sizeof(UINT32) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
 
-#define FBQ_ADDR			(ZONE_TO_FBG_ADDR + ZONE_TO_FBG_BYTES)
-#define FBQ_BYTES			((NBLK * sizeof(UINT32) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
+#define OPEN_ZONE_Q_ADDR 	(FBQ_ADDR + FBQ_BYTES)
+#define OPEN_ZONE_Q_BYTES	((MAX_OPEN_ZONE * sizeof(UINT8) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
 
-#define OPEN_ZONE_Q_ADDR 	FBQ_ADDR + FBQ_BYTES
-#define OPEN_ZONE_Q_BYTES	MAX_OPEN_ZONE * sizeof(UINT8)
+#define ZONE_TO_ID_ADDR		(OPEN_ZONE_Q_ADDR + OPEN_ZONE_Q_BYTES)			// indexed by zone number
+#define ZONE_TO_ID_BYTES	((NZONE * sizeof(UINT8) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
 
-#define ZONE_TO_ID_ADDR		OPEN_ZONE_Q_ADDR + OPEN_ZONE_Q_BYTES
-#define ZONE_TO_ID_BYTES	MAX_OPEN_ZONE * sizeof(UINT8)
+// ZNS+
 
+#define TL_BITMAP_ADDR		(ZONE_TO_ID_ADDR + ZONE_TO_ID_BYTES)			// valid pages of the TL_OPEN zones, one bit per zone page
+#define TL_BITMAP_UNIT		(NPAGE * DEG_ZONE / 8)
+#define TL_BITMAP(SLOT)		(TL_BITMAP_ADDR + (SLOT) * TL_BITMAP_UNIT)		// indexed by TL slot (see zns_tl_open() in ftl.c)
+#define TL_BITMAP_BYTES		((NUM_TL_ZONES * TL_BITMAP_UNIT + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
 
-	
+#if TL_BITMAP_UNIT % 4 != 0
+#error "the memory utility engine searches a TL bitmap in 32-bit words"
+#endif
 
-#define IZC_ADDR			(ZONE_TO_ID_ADDR + ZONE_TO_ID_BYTES)
-#define IZC_BYTES			(DEG_ZONE * NPAGE * sizeof(int))
+#if NUM_TL_ZONES >= MAX_OPEN_ZONE
+#error "an open zone must be left to close when a zone is opened (see open_zone() in ftl.c)"
+#endif
 
-#define TL_INTERNAL_BUFFER_ADDR			(IZC_ADDR + IZC_BYTES)
-#define TL_INTERNAL_BUFFER_BYTES		(BYTES_PER_PAGE)
+#define ERASE_Q_ADDR		(TL_BITMAP_ADDR + TL_BITMAP_BYTES)					// block groups of reset zones, erased in idle time
+#define ERASE_Q_BYTES		((NZONE * sizeof(UINT32) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
 
-// ZNS+
+#define ZONE_META_BYTES		(ERASE_Q_ADDR + ERASE_Q_BYTES - ZONE_META_ADDR)
+#define ZONE_META_PAGES		((ZONE_META_BYTES + BYTES_PER_PAGE - 1) / BYTES_PER_PAGE)
+
+// not checkpointed
+
+#define ZONE_BUFFER_ADDR	(ZONE_META_ADDR + ZONE_META_BYTES)				// pool of open zone buffers
+#define ZONE_BUFFER_BYTES	(NUM_ZONE_BUFFERS * BYTES_PER_PAGE)
+
+#define IZC_ADDR			(ZONE_BUFFER_ADDR + ZONE_BUFFER_BYTES)				// source of each page of a compaction or Simple Copy (see copy_zone_pages())
+#define IZC_BYTES			(DEG_ZONE * NPAGE * sizeof(int))
 
-#define TL_ADDR				TL_INTERNAL_BUFFER_ADDR + TL_INTERNAL_BUFFER_BYTES
+#define TL_ADDR				(IZC_ADDR + IZC_BYTES)
 #define TL_BYTES			(DEG_ZONE * NPAGE)
 
-#define TL_BITMAP_ADDR		TL_ADDR + TL_BYTES
-#define TL_BITMAP_BYTES		((NBLK * (NPAGE*DEG_ZONE) * sizeof(UINT8) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
+#define FLASH_TRACE_ADDR	((TL_ADDR + TL_BYTES + DRAM_ECC_UNIT - 1) / DRAM_ECC_UNIT * DRAM_ECC_UNIT)	// ring of issued flash commands (see ftl_stat.h)
 
-#define TL_WP_ADDR			(TL_BITMAP_ADDR + TL_BITMAP_BYTES)
-#define TL_WP_BYTES			((NBLK * sizeof(UINT32) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
+#define ZONE_APPEND_ADDR	(FLASH_TRACE_ADDR + FLASH_TRACE_BYTES)			// LBAs assigned to the Zone Append commands (see ftl_stat.h)
 
-#define TL_NUM_ADDR			(TL_WP_ADDR + TL_WP_BYTES)
-#define TL_NUM_BYTES		((NBLK * sizeof(UINT32) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR * BYTES_PER_SECTOR)
+#define SIMPLE_COPY_ADDR	(ZONE_APPEND_ADDR + ZONE_APPEND_BYTES)			// results of the Simple Copy commands (see ftl_stat.h)
 
-#define DRAM_TOP			TL_NUM_ADDR + TL_NUM_BYTES 
+#define DRAM_TOP			(SIMPLE_COPY_ADDR + SIMPLE_COPY_BYTES)
 
 
 
@@ -152,5 +210,7 @@ void ftl_write(UINT32 const lba, UINT32 const num_sectors);
 void ftl_test_write(UINT32 const lba, UINT32 const num_sectors);
 void ftl_flush(void);
 void ftl_isr(void);
+BOOL32 ftl_idle(void);
+BOOL32 ftl_zone_mgmt(UINT32 const action, UINT32 const zslba, BOOL32 const all);
 
 #endif //FTL_H
@@ -157,7 +157,6 @@ extern UINT8 c_bank_rmap[NUM_BANKS_MAX];
 
 #define _FCP_ROW_L(RBANK)			(FCP_ROW0_L + (RBANK) * 8)
 #define _FCP_ROW_H(RBANK)			(FCP_ROW0_H + (RBANK) * 8)
-#define _BSP_INTR(RBANK)			(*(volatile UINT8*)(BSP_INTR_BASE + (RBANK)))
 #define _BSP_CMD(RBANK)				(BSP_BASE + 0x00 + SIZE_OF_BSP * (RBANK))
 #define _BSP_OPTION(RBANK)			(BSP_BASE + 0x04 + SIZE_OF_BSP * (RBANK))
 #define _BSP_DMA_ADDR(RBANK)		(BSP_BASE + 0x08 + SIZE_OF_BSP * (RBANK))
@@ -170,8 +169,15 @@ extern UINT8 c_bank_rmap[NUM_BANKS_MAX];
 #define _BSP_DST_ROW_L(RBANK)		(BSP_BASE + 0x24 + SIZE_OF_BSP * (RBANK))
 #define _BSP_CMD_ID(RBANK)			(BSP_BASE + 0x28 + SIZE_OF_BSP * (RBANK))
 #define _BSP_ECCNUM(RBANK)			(BSP_BASE + 0x2C + SIZE_OF_BSP * (RBANK))
+#ifdef PROGRAM_HOST_SIM
+#define _BSP_INTR(RBANK)			((UINT8) GETREG(BSP_INTR_BASE + (RBANK)))
+#define _BSP_FSM(RBANK)				((UINT8) GETREG(BSP_FSM_BASE + (RBANK)))
+#define _CLR_BSP_INTR(RBANK, FLAG)	SETREG(BSP_INTR_BASE + (RBANK)/4*4, (FLAG) << (((RBANK)%4)*8))
+#else
+#define _BSP_INTR(RBANK)			(*(volatile UINT8*)(BSP_INTR_BASE + (RBANK)))
 #define _BSP_FSM(RBANK)				(*(volatile UINT8*)(BSP_FSM_BASE + (RBANK)))
 #define _CLR_BSP_INTR(RBANK, FLAG)	*(volatile UINT32*)(BSP_INTR_BASE + (RBANK)/4*4) = (FLAG) << (((RBANK)%4)*8)
+#endif
 
 #define REAL_BANK(BANK)				((UINT32)(c_bank_map[BANK]))
 #define FCP_ROW_L(BANK)				_FCP_ROW_L(REAL_BANK(BANK))
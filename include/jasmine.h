@@ -30,7 +30,12 @@
 #define OPTION_UART_DEBUG		1   // 1 = enable UART message output, 0 = disable
 #define OPTION_SLOW_SATA		0	// 1 = SATA 1.5Gbps, 0 = 3Gbps
 #define OPTION_SUPPORT_NCQ		0	// 1 = support SATA NCQ (=FPDMA) for AHCI hosts, 0 = support only DMA mode
+#ifndef OPTION_REDUCED_CAPACITY
 #define OPTION_REDUCED_CAPACITY	0	// reduce the number of blocks per bank for testing purpose
+#endif
+#ifndef OPTION_FLASH_TRACE
+#define OPTION_FLASH_TRACE		0	// 1 = record issued flash commands in a DRAM ring (see ftl_stat.h), 0 = disable
+#endif
 
 #define CHN_WIDTH			2 	// 2 = 16bit IO
 #define NUM_CHNLS_MAX		4
@@ -182,6 +187,7 @@ typedef struct
 
 #include "ftl.h"
 #include "misc.h"
+#include "ftl_stat.h"
 
 #ifndef PROGRAM_INSTALLER
 #include "uart.h"
@@ -63,6 +63,98 @@ typedef struct
 	UINT32	cmd_type;
 } CMD_T;
 
+// CMD_T.lba of a zoned command that goes through the event queue (see handle_got_cfis()) is
+// the zone start LBA, the zone locator of REPORT ZONES or the start zone and filter of ZONE REPORT COMPACT, | ZONE_CMD_*.
+// The field is above MAX_LBA and within the 30 bits of LBA that an event queue entry holds.
+#define ZONE_CMD_MASK		(BIT29 | BIT28)
+#define ZONE_CMD_APPEND		BIT29				// write: ATA_ZONE_APPEND
+#define ZONE_CMD_COMPACT	BIT28				// write: ATA_ZONE_COMPACT
+#define ZONE_CMD_TL_OPEN	(BIT29 | BIT28)		// write: ATA_ZONE_TL_OPEN
+#define ZONE_CMD_REPORT		BIT29				// read: ATA_ZONE_MGMT_IN
+#define ZONE_CMD_REPORT_COMPACT	BIT28			// read: ATA_ZONE_REPORT_COMPACT
+
+// ZONE MANAGEMENT IN/OUT actions (FEATURES 7:0, ZAC)
+#define ZM_REPORT_ZONES		0x00
+#define ZM_CLOSE_ZONE		0x01
+#define ZM_FINISH_ZONE		0x02
+#define ZM_OPEN_ZONE		0x03
+#define ZM_RESET_WP			0x04
+#define ZM_ALL				BIT0				// FEATURES 15:8 of ZONE MANAGEMENT OUT: the action applies to every zone
+
+// REPORT ZONES data: zac_report_hdr_t followed by one zac_zone_desc_t per zone, from the zone that contains the zone locator on
+#define ZAC_ZONE_TYPE_CONV		0x1
+#define ZAC_ZONE_TYPE_SEQ_REQ	0x2
+
+#define ZAC_ZC_NOT_WP			0x0				// zone condition (zac_zone_desc_t.zone_condition bits 7:4)
+#define ZAC_ZC_EMPTY			0x1
+#define ZAC_ZC_IMP_OPEN			0x2
+#define ZAC_ZC_EXP_OPEN			0x3
+#define ZAC_ZC_CLOSED			0x4
+#define ZAC_ZC_FULL				0xE
+
+typedef struct
+{
+	UINT32	zone_list_length;	// bytes of the descriptors of all the zones from the zone locator on
+	UINT8	same;
+	UINT8	reserved0[3];
+	UINT64	max_lba;
+	UINT8	reserved1[48];
+} zac_report_hdr_t;
+
+typedef struct
+{
+	UINT8	zone_type;			// ZAC_ZONE_TYPE_*
+	UINT8	zone_condition;		// ZAC_ZC_* << 4
+	UINT8	reserved0[6];
+	UINT64	zone_length;
+	UINT64	zone_start_lba;
+	UINT64	write_pointer;		// all ones for a conventional zone
+	UINT8	reserved1[32];
+} zac_zone_desc_t;
+
+// ZONE REPORT COMPACT data: zone_report_hdr_t followed by one zone_report_desc_t per zone that passes the filter,
+// from the start zone on. The LBA of the command is the start zone number (bits 15:0) and the filter (bits 23:16),
+// a mask of (1 << ZR_STATE_*) with 0 for every zone.
+#define ZR_START_ZONE(LBA)		((LBA) & 0xFFFF)
+#define ZR_FILTER(LBA)			(((LBA) >> 16) & 0xFF)
+
+#define ZR_STATE_EMPTY			0				// zone_report_desc_t.zone_state
+#define ZR_STATE_OPEN			1
+#define ZR_STATE_FULL			2
+#define ZR_STATE_TL_OPEN		3
+#define ZR_STATE_CONV			4
+#define ZR_STATE_CLOSED			5
+
+typedef struct
+{
+	UINT32	num_zones;			// zones from the start zone on that pass the filter
+	UINT32	max_lba;
+	UINT32	zone_size;			// sectors
+	UINT32	num_conv_zones;		// zones 0 ~ num_conv_zones - 1 are conventional
+} zone_report_hdr_t;
+
+typedef struct
+{
+	UINT32	zone_start_lba;
+	UINT32	write_pointer;		// INVALID32 for a conventional zone, the TL write pointer for a TL_OPEN zone
+	UINT32	zone_capacity;		// sectors
+	UINT8	zone_state;			// ZR_STATE_*
+	UINT8	fcg;				// flash channel group: zones of different groups are on disjoint banks
+	UINT16	tl_valid_pages;		// TL_OPEN: valid pages that the FTL has yet to copy into the zone
+} zone_report_desc_t;
+
+// Simple Copy is an ATA_ZONE_COMPACT command on the destination zone whose payload begins with ZC_SIMPLE_COPY | number of ranges
+// (the payload of Internal Zone Compaction begins with a start LBA, which is below BIT28), followed by the source ranges.
+#define ZC_SIMPLE_COPY			BIT31
+#define ZC_NUM_RANGES(WORD)		((WORD) & 0xFFFF)
+
+typedef struct
+{
+	UINT32	zone_start_lba;		// source zone
+	UINT32	page_offset;		// first zone page of the range
+	UINT32	num_pages;
+} simple_copy_range_t;
+
 // slow_cmd_t status
 #define SLOW_CMD_STATUS_NONE		0
 #define SLOW_CMD_STATUS_PENDING		1
@@ -150,11 +242,17 @@ enum
 	ATA_WRITE_LOG_EXT				= 0x3F,	/* Write Log Ext			 */
 	ATA_READ_VERIFY_SECTORS			= 0x40, /* Read Verify Sectors		 */
 	ATA_READ_VERIFY_SECTORS_EXT		= 0x42, /* Read Verify Sectors Ext	 */
+	ATA_ZONE_MGMT_IN				= 0x4A,	/* Zone Management In (REPORT ZONES EXT) */
 	ATA_READ_FPDMA_QUEUED			= 0x60,	/* Read FPDMA Queued		 */
 	ATA_WRITE_FPDMA_QUEUED			= 0x61,	/* Write FPDMA Queued		 */
+	ATA_ZONE_APPEND					= 0x80,	/* Zone Append (vendor specific) */
+	ATA_ZONE_COMPACT				= 0x81,	/* Internal Zone Compaction and Simple Copy (vendor specific) */
+	ATA_ZONE_TL_OPEN				= 0x82,	/* TL Open (vendor specific) */
+	ATA_ZONE_REPORT_COMPACT			= 0x83,	/* Zone Report Compact (vendor specific) */
 	ATA_EXEDIAG						= 0x90,	/* Execute Drive Diagnostics */
 	ATA_INITIALIZE_DEV_PARA			= 0x91,	/* Initialize Device Parameters */
 	ATA_DOWNLOAD_MICROCODE			= 0x92,	/* Download Microcode		 */
+	ATA_ZONE_MGMT_OUT				= 0x9F,	/* Zone Management Out		 */
 	ATA_SMART						= 0xB0,	/* Smart					 */
 	ATA_DEVICE_CONFIGURATION		= 0xB1,	/* Device Configuration		 */
 	ATA_READ_MULTIPLE				= 0xC4,	/* Read Multiple			 */
@@ -20,7 +20,7 @@
 #ifndef SATA_CMD_H
 #define SATA_CMD_H
 
-#define	ATA_CMD_NUM			59
+#define	ATA_CMD_NUM			60
 #define	CMD_TABLE_SIZE		60
 
 
@@ -62,6 +62,8 @@ void ata_read_verify_sectors(UINT32 lba, UINT32 sector_count);
 void ata_set_multiple_mode(UINT32 lba, UINT32 sector_count);
 void ata_read_buffer(UINT32 lba, UINT32 sector_count);
 void ata_write_buffer(UINT32 lba, UINT32 sector_count);
+void ata_read_log_ext(UINT32 lba, UINT32 sector_count);
+void ata_zone_management_out(UINT32 lba, UINT32 sector_count);
 void ata_seek(UINT32 lba, UINT32 sector_count);
 void ata_standby(UINT32 lba, UINT32 sector_count);
 void ata_recalibrate(UINT32 lba, UINT32 sector_count);
@@ -127,6 +127,93 @@ void ata_write_buffer(UINT32 lba, UINT32 sector_count)
 	pio_sector_transfer(HIL_BUF_ADDR, PIO_H2D);
 }
 
+// READ LOG EXT: LBA[7:0] = log address, LBA[47:40] and LBA[15:8] = page number
+// Only one page can be read per command, because pio_sector_transfer() ends the command after one sector.
+void ata_read_log_ext(UINT32 lba, UINT32 sector_count)
+{
+	UINT32 log_addr = lba & 0xFF;
+	UINT32 page = ((lba >> 8) & 0xFF) | ((GETREG(SATA_FIS_H2D_2) >> 8) & 0xFF00);
+
+	if (sector_count != 1)
+	{
+		send_status_to_host(B_ABRT);
+		return;
+	}
+
+	mem_set_dram(HIL_BUF_ADDR, 0, BYTES_PER_SECTOR);
+
+	if (log_addr == 0x00 && page == 0)
+	{
+		// General Purpose Log Directory: word 0 = version, word N = number of pages of log address N
+		write_dram_16(HIL_BUF_ADDR, 0x0001);
+		write_dram_16(HIL_BUF_ADDR + FTL_STAT_LOG_ADDR * sizeof(UINT16), FTL_STAT_LOG_PAGES);
+		write_dram_16(HIL_BUF_ADDR + FTL_LAT_LOG_ADDR * sizeof(UINT16), FTL_LAT_LOG_PAGES);
+		write_dram_16(HIL_BUF_ADDR + FLASH_TRACE_LOG_ADDR * sizeof(UINT16), FLASH_TRACE_LOG_PAGES);
+		#ifdef FTL_ZONE_APPEND
+		write_dram_16(HIL_BUF_ADDR + ZONE_APPEND_LOG_ADDR * sizeof(UINT16), ZONE_APPEND_LOG_PAGES);
+		#endif
+		#ifdef FTL_ZONE_MGMT
+		write_dram_16(HIL_BUF_ADDR + SIMPLE_COPY_LOG_ADDR * sizeof(UINT16), SIMPLE_COPY_LOG_PAGES);
+		#endif
+	}
+	else if (log_addr == FTL_STAT_LOG_ADDR && page < FTL_STAT_LOG_PAGES)
+	{
+		UINT32 offset = page * BYTES_PER_SECTOR;
+
+		mem_copy(HIL_BUF_ADDR, (UINT8*) &g_ftl_stat + offset, MIN(sizeof(ftl_stat_t) - offset, BYTES_PER_SECTOR));
+	}
+	else if (log_addr == FTL_LAT_LOG_ADDR && page < FTL_LAT_LOG_PAGES)
+	{
+		UINT32 offset = page * BYTES_PER_SECTOR;
+
+		mem_copy(HIL_BUF_ADDR, (UINT8*) &g_ftl_lat + offset, MIN(sizeof(ftl_lat_t) - offset, BYTES_PER_SECTOR));
+	}
+	else if (log_addr == FLASH_TRACE_LOG_ADDR && page == 0)
+	{
+		flash_trace_hdr_t hdr;
+
+		ftl_stat_trace_header(&hdr);
+		mem_copy(HIL_BUF_ADDR, &hdr, sizeof(hdr));
+	}
+	#if OPTION_FLASH_TRACE
+	else if (log_addr == FLASH_TRACE_LOG_ADDR && page < FLASH_TRACE_LOG_PAGES)
+	{
+		mem_copy(HIL_BUF_ADDR, FLASH_TRACE_ADDR + (page - 1) * BYTES_PER_SECTOR, BYTES_PER_SECTOR);
+	}
+	#endif
+	#ifdef FTL_ZONE_APPEND
+	else if (log_addr == ZONE_APPEND_LOG_ADDR && page < ZONE_APPEND_LOG_PAGES)
+	{
+		mem_copy(HIL_BUF_ADDR, ZONE_APPEND_ADDR + page * BYTES_PER_SECTOR, BYTES_PER_SECTOR);
+	}
+	#endif
+	#ifdef FTL_ZONE_MGMT
+	else if (log_addr == SIMPLE_COPY_LOG_ADDR && page < SIMPLE_COPY_LOG_PAGES)
+	{
+		mem_copy(HIL_BUF_ADDR, SIMPLE_COPY_ADDR + page * BYTES_PER_SECTOR, BYTES_PER_SECTOR);
+	}
+	#endif
+	else
+	{
+		send_status_to_host(B_ABRT);
+		return;
+	}
+
+	pio_sector_transfer(HIL_BUF_ADDR, PIO_D2H);
+}
+
+#ifdef FTL_ZONE_MGMT
+// ZONE MANAGEMENT OUT (ZAC): FEATURES[7:0] = action (ZM_*), FEATURES[15:8] = ZM_ALL or 0, LBA = zone start LBA
+// The event queue is empty when a slow command runs, so the writes submitted before it have reached the FTL.
+void ata_zone_management_out(UINT32 lba, UINT32 sector_count)
+{
+	UINT32 action = GETREG(SATA_FIS_H2D_0) >> 24;
+	BOOL32 all = (GETREG(SATA_FIS_H2D_2) >> 24) & ZM_ALL;
+
+	send_status_to_host(ftl_zone_mgmt(action, lba, all) ? 0 : B_ABRT);
+}
+#endif
+
 void ata_standby(UINT32 lba, UINT32 sector_count)
 {
 	ftl_flush();
@@ -176,7 +176,7 @@ __align(4) UINT16 ht_identify_data[256] =
 						//		2	:CFA feature set supported
 						//		1	:READ/WRITE DMA QUEUED supported
 						//		0	:DOWNLOAD MICROCODE command supported
-	0x4000,				//	84:	Command set/feature supported extension. If words
+	0x4020,				//	84:	Command set/feature supported extension. If words
 						//		82, 83, and 84 = 0000h or FFFFh command set notification extension is not supported.
 						//		15	:Shall be cleared to zero
 						//		14	:Shall be set to one
@@ -221,7 +221,7 @@ __align(4) UINT16 ht_identify_data[256] =
 						//		2	:CFA feature set enabled
 						//		1	:READ/WRITE DMA QUEUED command enabled
 						//		0	:DOWNLOAD MICROCODE command enabled
-	0x4000,				//	87:	Command set/feature default. If words 85, 86, and 87
+	0x4020,				//	87:	Command set/feature default. If words 85, 86, and 87
 						//		= 0000h or FFFFh command set default notification is
 						//		not supported.
 						//		15	:Shall be cleared to zero
@@ -372,6 +372,16 @@ void ata_identify_device(UINT32 lba, UINT32 sector_count)
 	addr[106] = 0x4000;
 	addr[217] = 0x0001;
 
+	#ifdef FTL_ZONE_MGMT
+	// vendor specific: the zone layout (ftl_zns)
+	addr[129] = NUM_CONV_ZONES;			// conventional zones from LBA 0, then sequential write zones
+	addr[130] = (UINT16) (ZONE_SIZE & 0xFFFF);	// zone size in sectors
+	addr[131] = (UINT16) (ZONE_SIZE >> 16);
+	addr[132] = MAX_OPEN_ZONE;
+	addr[133] = DEG_ZONE;				// banks per zone
+	addr[134] = NUM_FCG;				// flash channel groups: zone n is on the banks of group n % NUM_FCG
+	#endif
+
 	addr[255] = get_integrity_word();
 
 	mem_copy(HIL_BUF_ADDR, addr, BYTES_PER_SECTOR);
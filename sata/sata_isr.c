@@ -94,6 +94,20 @@ static __inline void handle_srst(void)
 	}
 }
 
+// the ZONE_CMD_* tag that the FTL finds in CMD_T.lba of a zoned command, 0 for the other commands
+static __inline UINT32 zone_cmd(UINT32 const cmd_code)
+{
+	switch (cmd_code)
+	{
+		case ATA_ZONE_APPEND:			return ZONE_CMD_APPEND;
+		case ATA_ZONE_COMPACT:			return ZONE_CMD_COMPACT;
+		case ATA_ZONE_TL_OPEN:			return ZONE_CMD_TL_OPEN;
+		case ATA_ZONE_MGMT_IN:			return ZONE_CMD_REPORT;
+		case ATA_ZONE_REPORT_COMPACT:	return ZONE_CMD_REPORT_COMPACT;
+		default:						return 0;
+	}
+}
+
 static __inline void handle_got_cfis(void)
 {
 	UINT32 lba, sector_count, cmd_code, cmd_type, fis_d1, fis_d3;
@@ -145,18 +159,27 @@ static __inline void handle_got_cfis(void)
 	{
 		send_status_to_host(B_IDNF);
 	}
+	else if ((cmd_code == ATA_ZONE_MGMT_IN && ((GETREG(SATA_FIS_H2D_0) >> 24) != ZM_REPORT_ZONES || sector_count == 0 || lba > MAX_LBA))
+		|| (cmd_code == ATA_ZONE_REPORT_COMPACT && (sector_count == 0 || lba > MAX_LBA)))
+	{
+		// the sector count of a zone report is the size of the report, not a range of LBAs,
+		// and an LBA above MAX_LBA would set the ZONE_CMD_* field that the FTL takes the command from
+		send_status_to_host(B_ABRT);
+	}
 	else if (cmd_type & (CCL_FTL_H2D | CCL_FTL_D2H))
 	{
 		UINT32 action_flags;
 
-		SETREG(SATA_LBA, lba);
+		// The LBA of a zoned command is the start of a zone, and its data (the payload of the vendor commands) is not written there.
+		// SATA_SECT_OFFSET below is the zone start LBA as well, so the data begins at sector 0 of a buffer.
+		SETREG(SATA_LBA, lba | zone_cmd(cmd_code));
 		SETREG(SATA_SECT_CNT, sector_count);
 
 		if (cmd_type & CCL_FTL_H2D)
 		{
 			SETREG(SATA_INSERT_EQ_W, 1);	// The contents of SATA_LBA and SATA_SECT_CNT are inserted into the event queue as a write command.
 
-			if (cmd_code == ATA_WRITE_DMA || cmd_code == ATA_WRITE_DMA_EXT)
+			if (cmd_code == ATA_WRITE_DMA || cmd_code == ATA_WRITE_DMA_EXT || zone_cmd(cmd_code) != 0)
 			{
 				action_flags = DMA_WRITE | COMPLETE;
 			}
@@ -182,7 +205,7 @@ static __inline void handle_got_cfis(void)
 		{
 			SETREG(SATA_INSERT_EQ_R, 1);	// The contents of SATA_LBA and SATA_SECT_CNT are inserted into the event queue as a read command.
 
-			if (cmd_code == ATA_READ_DMA || cmd_code == ATA_READ_DMA_EXT)
+			if (cmd_code == ATA_READ_DMA || cmd_code == ATA_READ_DMA_EXT || zone_cmd(cmd_code) != 0)
 			{
 				action_flags = DMA_READ | COMPLETE;
 			}
@@ -87,13 +87,19 @@ void Main(void)
 
 			eventq_get(&cmd);
 
+			UINT32 start_time = ftl_stat_time();
+
 			if (cmd.cmd_type == READ)
 			{
+				g_ftl_stat.host_read_sects += cmd.sector_count;
 				ftl_read(cmd.lba, cmd.sector_count);
+				ftl_stat_lat(LAT_FTL_READ, start_time);
 			}
 			else
 			{
+				g_ftl_stat.host_write_sects += cmd.sector_count;
 				ftl_write(cmd.lba, cmd.sector_count);
+				ftl_stat_lat(LAT_FTL_WRITE, start_time);
 			}
 		}
 		else if (g_sata_context.slow_cmd.status == SLOW_CMD_STATUS_PENDING)
@@ -111,6 +117,7 @@ void Main(void)
 		else
 		{
 			// idle time operations
+			ftl_idle();
 		}
 	}
 }
@@ -97,7 +97,11 @@ ATR_NO_SECT|ATR_LBA_EXT	| 	CCL_OTHER,			// 0x37	Set Max Address Ext
 							CCL_UNDEFINED,		// 0x47
 							CCL_UNDEFINED,		// 0x48
 							CCL_UNDEFINED,		// 0x49
+#ifdef FTL_ZONE_MGMT
+ATR_NO_SECT|ATR_LBA_EXT	|	CCL_FTL_D2H,		// 0x4A	Zone Management In (REPORT ZONES EXT, see handle_got_cfis())
+#else
 							CCL_UNDEFINED,		// 0x4A
+#endif
 							CCL_UNDEFINED,		// 0x4B
 							CCL_UNDEFINED,		// 0x4C
 							CCL_UNDEFINED,		// 0x4D
@@ -151,10 +155,20 @@ ATR_NO_SECT|ATR_LBA_EXT	| 	CCL_OTHER,			// 0x37	Set Max Address Ext
 							CCL_UNDEFINED,		// 0x7D
 							CCL_UNDEFINED,		// 0x7E
 							CCL_UNDEFINED,		// 0x7F
+#ifdef FTL_ZONE_APPEND
+			ATR_LBA_EXT	|	CCL_FTL_H2D,		// 0x80 Zone Append (vendor specific)
+#else
 							CCL_UNDEFINED,		// 0x80
+#endif
+#ifdef FTL_ZONE_MGMT
+			ATR_LBA_EXT	|	CCL_FTL_H2D,		// 0x81 Internal Zone Compaction and Simple Copy (vendor specific)
+			ATR_LBA_EXT	|	CCL_FTL_H2D,		// 0x82 TL Open (vendor specific)
+ATR_NO_SECT|ATR_LBA_EXT	|	CCL_FTL_D2H,		// 0x83 Zone Report Compact (vendor specific)
+#else
 							CCL_UNDEFINED,		// 0x81
 							CCL_UNDEFINED,		// 0x82
 							CCL_UNDEFINED,		// 0x83
+#endif
 							CCL_UNDEFINED,		// 0x84
 							CCL_UNDEFINED,		// 0x85
 							CCL_UNDEFINED,		// 0x86
@@ -182,7 +196,11 @@ ATR_NO_SECT|ATR_LBA_EXT	| 	CCL_OTHER,			// 0x37	Set Max Address Ext
 							CCL_UNDEFINED,		// 0x9C
 							CCL_UNDEFINED,		// 0x9D
 							CCL_UNDEFINED,		// 0x9E
+#ifdef FTL_ZONE_MGMT
+ATR_NO_SECT|ATR_LBA_EXT	|	CCL_OTHER,			// 0x9F	Zone Management Out
+#else
 							CCL_UNDEFINED,		// 0x9F
+#endif
 							CCL_UNDEFINED,		// 0xA0
 							CCL_UNDEFINED,		// 0xA1
 							CCL_UNDEFINED,		// 0xA2
@@ -312,38 +330,38 @@ const UINT8 ata_command_code_table[] =
     0x97,	// 25 IDLE
     0x98,	// 26 CHECK POWER MODE
     0x99,	// 27 SLEEP
-    0xB0,   // 28 SMART
-    0xB1,   // 29 DEVICE CONFIGURATION
-    0xC8,   // 30 READ DMA
-    0xCA,   // 31 WRITE DMA
-    0xC4,   // 32 READ MULTIPLE
-    0xC5,   // 33 WRITE MULTIPLE
-    0xC6,   // 34 SET MULTIPLE MODE
-    0xD0,   // 35 SANITARY ERASE
-    0xE0,   // 36 STANDBY IMMEDIATE
-    0xE1,   // 37 IDLE IMMEDIATE
-    0xE2,   // 38 STANDBY
-    0xE3,   // 39 IDLE
-    0xE4,   // 40 READ BUFFER
-    0xE5,   // 41 CHECK POWER MODE
-    0xE6,   // 42 SLEEP
-    0xE7,   // 43 FLUSH CACHE
-    0xE8,   // 44 WRITE BUFFER
-    0xEA,   // 45 FLUSH CACHE EXT
-    0xEC,   // 46 IDENTIFY DEVICE
-    0xEF,   // 47 SET FEATURES
-    0xF1,   // 48 SECURITY SET PASSWORD
-    0xF2,   // 49 SECURITY UNLOCK
-    0xF3,   // 50 SECURITY ERASE PREPARE
-    0xF4,   // 51 SECURITY ERASE UNIT
-    0xF5,   // 52 SECURITY FREEZE LOCK
-    0xF6,   // 53 SECURITY DISABLE PASSWORD
-    0xF8,   // 54 READ NATIVE MAX ADDRESS
-    0xF9,   // 55 SET MAX ADDRESS
-    0xFC,  // 56 DELETE
-    0xFD,  // 57 DELETE EXT
-    0xFF,   // 58 SRST
-    0xFF,   // 59 Dummy for 4 byte alignment
+    0x9F,   // 28 ZONE MANAGEMENT OUT
+    0xB0,   // 29 SMART
+    0xB1,   // 30 DEVICE CONFIGURATION
+    0xC8,   // 31 READ DMA
+    0xCA,   // 32 WRITE DMA
+    0xC4,   // 33 READ MULTIPLE
+    0xC5,   // 34 WRITE MULTIPLE
+    0xC6,   // 35 SET MULTIPLE MODE
+    0xD0,   // 36 SANITARY ERASE
+    0xE0,   // 37 STANDBY IMMEDIATE
+    0xE1,   // 38 IDLE IMMEDIATE
+    0xE2,   // 39 STANDBY
+    0xE3,   // 40 IDLE
+    0xE4,   // 41 READ BUFFER
+    0xE5,   // 42 CHECK POWER MODE
+    0xE6,   // 43 SLEEP
+    0xE7,   // 44 FLUSH CACHE
+    0xE8,   // 45 WRITE BUFFER
+    0xEA,   // 46 FLUSH CACHE EXT
+    0xEC,   // 47 IDENTIFY DEVICE
+    0xEF,   // 48 SET FEATURES
+    0xF1,   // 49 SECURITY SET PASSWORD
+    0xF2,   // 50 SECURITY UNLOCK
+    0xF3,   // 51 SECURITY ERASE PREPARE
+    0xF4,   // 52 SECURITY ERASE UNIT
+    0xF5,   // 53 SECURITY FREEZE LOCK
+    0xF6,   // 54 SECURITY DISABLE PASSWORD
+    0xF8,   // 55 READ NATIVE MAX ADDRESS
+    0xF9,   // 56 SET MAX ADDRESS
+    0xFC,  // 57 DELETE
+    0xFD,  // 58 DELETE EXT
+    0xFF,   // 59 SRST
 };
 
 const ATA_FUNCTION_T ata_function_table[] =
@@ -357,7 +375,7 @@ const ATA_FUNCTION_T ata_function_table[] =
 	(ATA_FUNCTION_T) INVALID32,			// READ MULTIPLE EXT
 	(ATA_FUNCTION_T) INVALID32,			// READ SECTOR(S)
 	ata_read_native_max_address,		// READ NATIVE MAX ADDRESS EXT
-	(ATA_FUNCTION_T) INVALID32,			// READ LOG EXT
+	ata_read_log_ext,					// READ LOG EXT
 	(ATA_FUNCTION_T) INVALID32,			// WRITE DMA EXT
 	(ATA_FUNCTION_T) INVALID32,			// WRITE SECTOR(S) EXT
 	(ATA_FUNCTION_T) INVALID32,			// WRITE MULTIPLE EXT
@@ -376,6 +394,11 @@ const ATA_FUNCTION_T ata_function_table[] =
 	ata_idle,							// IDLE
 	ata_check_power_mode,				// CHECK POWER MODE
 	ata_sleep,							// SLEEP
+#ifdef FTL_ZONE_MGMT
+	ata_zone_management_out,			// ZONE MANAGEMENT OUT
+#else
+	(ATA_FUNCTION_T) INVALID32,			// ZONE MANAGEMENT OUT
+#endif
 	(ATA_FUNCTION_T) INVALID32,			// SMART
 	(ATA_FUNCTION_T) INVALID32,			// DEVICE CONFIGURATION
 	(ATA_FUNCTION_T) INVALID32,			// READ DMA
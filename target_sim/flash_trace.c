@@ -0,0 +1,460 @@
+// Copyright 2011 INDILINX Co., Ltd.
+//
+// This file is part of Jasmine.
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Jasmine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Jasmine. See the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//
+// Decoder of the flash command trace (READ LOG EXT log 0xA2, see target_spw/ftl_stat.h)
+//
+// The input is a binary dump of the log: page 0 (header) followed by the ring pages, as written by
+// jasmine_sim -D or read from the drive one page at a time. The firmware records only the time each
+// command was issued, so the busy interval of each bank and each channel is estimated with the NAND
+// timing (the same model as target_sim/sim_nand.c): a command starts when it is issued or when the bank
+// finishes its previous command, whichever is later, and data transfers are serialized per channel.
+//
+// Output: command counts, bank and channel utilization, and a text Gantt chart with one row per bank
+// (R = read, W = program, C = copyback, E = erase, X = transfer only, . = idle; lower case if the bank is busy
+// less than half of the column) and one row per channel. -c writes every estimated interval as csv for external plotting.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// must match target_spw/ftl_stat.h and include/flash.h
+#define FLASH_TRACE_SIGNATURE	0x52544A46
+#define BYTES_PER_SECTOR		512
+#define NUM_BANKS_MAX			32
+#define NUM_CHNLS_MAX			4
+
+#define FC_COL_ROW_IN_PROG		0x01
+#define FC_COL_ROW_IN			0x02
+#define FC_IN					0x03
+#define FC_IN_PROG				0x04
+#define FC_PROG					0x09
+#define FC_COL_ROW_READ_OUT		0x0a
+#define FC_COL_ROW_READ			0x0b
+#define FC_OUT					0x0c
+#define FC_COL_OUT				0x0f
+#define FC_COPYBACK				0x12
+#define FC_ERASE				0x14
+#define FC_MODIFY_COPYBACK		0x17
+
+typedef struct
+{
+	uint32_t	time;
+	uint32_t	row;
+	uint32_t	dma_addr;
+	uint8_t		dma_sects;
+	uint8_t		cmd;
+	uint8_t		bank;
+	uint8_t		flags;
+}
+flash_trace_t;
+
+typedef struct
+{
+	uint32_t	signature;
+	uint16_t	version;
+	uint16_t	entry_bytes;
+	uint32_t	num_entries;
+	uint32_t	count;
+	uint32_t	timer_hz;
+	uint16_t	num_banks;
+	uint16_t	num_chnls;
+	uint16_t	sectors_per_page;
+	uint16_t	reserved;
+	uint8_t		rbank[NUM_BANKS_MAX];
+}
+flash_trace_hdr_t;
+
+#define OP_READ		0
+#define OP_PROG		1
+#define OP_COPY		2
+#define OP_ERASE	3
+#define OP_XFER		4		// data transfer only (FC_IN, FC_OUT, ...)
+#define NUM_OPS		5
+
+static const char c_op_char[NUM_OPS] = { 'R', 'W', 'C', 'E', 'X' };
+static const char* const c_op_name[NUM_OPS] = { "read", "program", "copyback", "erase", "transfer" };
+
+// estimated interval of one command
+typedef struct
+{
+	uint64_t	issue;
+	uint64_t	start;
+	uint64_t	end;
+	uint32_t	bank;
+	uint32_t	op;
+}
+interval_t;
+
+// one data or command transfer on a channel
+typedef struct
+{
+	uint64_t	start;
+	uint64_t	end;
+	uint32_t	chnl;
+}
+xfer_t;
+
+// nanoseconds, defaults of target_sim/sim_nand.c (MLC)
+static uint64_t g_t_r = 60000, g_t_prog = 1300000, g_t_bers = 3500000, g_t_dbsy = 500;
+static uint64_t g_t_cmd = 140;
+static uint64_t g_ps_per_byte = 10000;		// 16-bit channel, 20ns cycle
+
+static flash_trace_hdr_t g_hdr;
+static uint64_t g_bank_free[NUM_BANKS_MAX];
+static uint64_t g_chnl_free[NUM_CHNLS_MAX];
+static uint64_t g_bank_busy[NUM_BANKS_MAX];
+static uint64_t g_chnl_busy[NUM_CHNLS_MAX];
+static uint64_t g_op_cnt[NUM_OPS];
+static xfer_t* g_xfer;
+static uint64_t g_num_xfers, g_max_xfers;
+
+static void usage(const char* prog)
+{
+	fprintf(stderr, "usage: %s [-t tR:tPROG:tBERS in microseconds] [-w columns] [-c csv file] dump\n", prog);
+	exit(1);
+}
+
+static uint64_t transfer(uint32_t const chnl, uint64_t const t, uint32_t const num_bytes)
+{
+	uint64_t start = (t > g_chnl_free[chnl]) ? t : g_chnl_free[chnl];
+	uint64_t ns = (num_bytes == 0) ? g_t_cmd : (uint64_t) num_bytes * g_ps_per_byte / 1000;
+
+	g_chnl_free[chnl] = start + ns;
+	g_chnl_busy[chnl] += ns;
+
+	if (g_num_xfers == g_max_xfers)
+	{
+		g_max_xfers = (g_max_xfers == 0) ? 65536 : g_max_xfers * 2;
+		g_xfer = realloc(g_xfer, (size_t) g_max_xfers * sizeof(xfer_t));
+
+		if (g_xfer == NULL)
+		{
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+
+	g_xfer[g_num_xfers].start = start;
+	g_xfer[g_num_xfers].end = start + ns;
+	g_xfer[g_num_xfers].chnl = chnl;
+	g_num_xfers++;
+
+	return start + ns;
+}
+
+static interval_t schedule(flash_trace_t const* e, uint64_t const issue)
+{
+	interval_t iv;
+	uint32_t chnl = g_hdr.rbank[e->bank] % g_hdr.num_chnls;
+	uint32_t dma_bytes = e->dma_sects * BYTES_PER_SECTOR;
+	uint32_t page_bytes = g_hdr.sectors_per_page * BYTES_PER_SECTOR;
+	uint64_t dbsy = (e->flags & 4) ? g_t_dbsy : 0;
+	uint64_t t;
+
+	iv.issue = issue;
+	iv.start = (issue > g_bank_free[e->bank]) ? issue : g_bank_free[e->bank];
+	iv.bank = e->bank;
+
+	t = transfer(chnl, iv.start, 0);
+
+	switch (e->cmd)
+	{
+		case FC_COL_ROW_IN_PROG:
+		case FC_IN_PROG:
+			t = transfer(chnl, t, dma_bytes) + g_t_prog + dbsy;
+			iv.op = OP_PROG;
+			break;
+		case FC_PROG:
+			t += g_t_prog + dbsy;
+			iv.op = OP_PROG;
+			break;
+		case FC_COL_ROW_READ_OUT:
+			t = transfer(chnl, t + g_t_r + dbsy, dma_bytes);
+			iv.op = OP_READ;
+			break;
+		case FC_COL_ROW_READ:
+			t += g_t_r + dbsy;
+			iv.op = OP_READ;
+			break;
+		case FC_COPYBACK:
+		case FC_MODIFY_COPYBACK:
+			t = transfer(chnl, t + g_t_r + dbsy, page_bytes);
+			if (e->cmd == FC_MODIFY_COPYBACK)
+				t = transfer(chnl, t, dma_bytes);
+			t += g_t_prog + dbsy;
+			iv.op = OP_COPY;
+			break;
+		case FC_ERASE:
+			t += g_t_bers + dbsy;
+			iv.op = OP_ERASE;
+			break;
+		default:
+			t = transfer(chnl, t, dma_bytes);
+			iv.op = OP_XFER;
+			break;
+	}
+
+	iv.end = t;
+	g_bank_free[e->bank] = t;
+	g_bank_busy[e->bank] += t - iv.start;
+	g_op_cnt[iv.op]++;
+
+	return iv;
+}
+
+// one row of the Gantt chart: the operation that occupies most of each column
+static void print_bank_row(interval_t const* iv, uint64_t const num, uint32_t const bank, uint64_t const span, uint32_t const cols)
+{
+	uint64_t* occupancy = calloc((size_t) cols * NUM_OPS, sizeof(uint64_t));
+	uint64_t col_ns = (span + cols - 1) / cols;
+	uint64_t i;
+	uint32_t c, op;
+
+	for (i = 0; i < num; i++)
+	{
+		uint64_t t;
+
+		if (iv[i].bank != bank)
+			continue;
+
+		for (t = iv[i].start; t < iv[i].end; )
+		{
+			uint64_t col = t / col_ns;
+			uint64_t col_end = (col + 1) * col_ns;
+			uint64_t until = (iv[i].end < col_end) ? iv[i].end : col_end;
+
+			if (col >= cols)
+				break;
+
+			occupancy[col * NUM_OPS + iv[i].op] += until - t;
+			t = until;
+		}
+	}
+
+	printf("bank %2u |", bank);
+
+	for (c = 0; c < cols; c++)
+	{
+		uint64_t best = 0, total = 0;
+		char ch = '.';
+
+		for (op = 0; op < NUM_OPS; op++)
+		{
+			total += occupancy[c * NUM_OPS + op];
+
+			if (occupancy[c * NUM_OPS + op] > best)
+			{
+				best = occupancy[c * NUM_OPS + op];
+				ch = c_op_char[op];
+			}
+		}
+
+		putchar(total * 2 >= col_ns ? ch : (total != 0 ? (char) (ch - 'A' + 'a') : '.'));
+	}
+
+	printf("|\n");
+	free(occupancy);
+}
+
+// one row of the Gantt chart per channel: # = busy more than half of the column, + = busy, . = idle
+static void print_chnl_row(uint32_t const chnl, uint64_t const span, uint32_t const cols)
+{
+	uint64_t* busy = calloc(cols, sizeof(uint64_t));
+	uint64_t col_ns = (span + cols - 1) / cols;
+	uint64_t i;
+	uint32_t c;
+
+	for (i = 0; i < g_num_xfers; i++)
+	{
+		uint64_t t;
+
+		if (g_xfer[i].chnl != chnl)
+			continue;
+
+		for (t = g_xfer[i].start; t < g_xfer[i].end; )
+		{
+			uint64_t col = t / col_ns;
+			uint64_t col_end = (col + 1) * col_ns;
+			uint64_t until = (g_xfer[i].end < col_end) ? g_xfer[i].end : col_end;
+
+			if (col >= cols)
+				break;
+
+			busy[col] += until - t;
+			t = until;
+		}
+	}
+
+	printf("chnl %2u |", chnl);
+
+	for (c = 0; c < cols; c++)
+		putchar(busy[c] * 2 >= col_ns ? '#' : (busy[c] != 0 ? '+' : '.'));
+
+	printf("|\n");
+	free(busy);
+}
+
+int main(int argc, char** argv)
+{
+	const char* csv_path = NULL;
+	uint32_t cols = 100;
+	flash_trace_t* ring;
+	interval_t* iv;
+	uint64_t num, first, i, now = 0, span = 0;
+	uint32_t prev_time = 0, bank, chnl, op;
+	unsigned t_r, t_prog, t_bers;
+	FILE* file;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:w:c:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 't':
+				if (sscanf(optarg, "%u:%u:%u", &t_r, &t_prog, &t_bers) != 3)
+					usage(argv[0]);
+				g_t_r = t_r * 1000ULL;
+				g_t_prog = t_prog * 1000ULL;
+				g_t_bers = t_bers * 1000ULL;
+				break;
+			case 'w': cols = strtoul(optarg, NULL, 0);	break;
+			case 'c': csv_path = optarg;				break;
+			default: usage(argv[0]);
+		}
+	}
+
+	if (optind != argc - 1 || cols == 0)
+		usage(argv[0]);
+
+	file = fopen(argv[optind], "rb");
+
+	if (file == NULL || fread(&g_hdr, sizeof(g_hdr), 1, file) != 1)
+	{
+		fprintf(stderr, "cannot read %s\n", argv[optind]);
+		return 1;
+	}
+
+	if (g_hdr.signature != FLASH_TRACE_SIGNATURE || g_hdr.entry_bytes != sizeof(flash_trace_t) ||
+		g_hdr.num_banks > NUM_BANKS_MAX || g_hdr.num_chnls == 0 || g_hdr.num_chnls > NUM_CHNLS_MAX)
+	{
+		fprintf(stderr, "%s is not a flash command trace\n", argv[optind]);
+		return 1;
+	}
+
+	ring = malloc((size_t) g_hdr.num_entries * sizeof(flash_trace_t) + 1);
+	fseek(file, BYTES_PER_SECTOR, SEEK_SET);
+
+	if (ring == NULL || fread(ring, sizeof(flash_trace_t), g_hdr.num_entries, file) != g_hdr.num_entries)
+	{
+		fprintf(stderr, "%s: the ring is incomplete\n", argv[optind]);
+		return 1;
+	}
+
+	fclose(file);
+
+	num = (g_hdr.count < g_hdr.num_entries) ? g_hdr.count : g_hdr.num_entries;
+	first = g_hdr.count - num;
+	iv = malloc((size_t) (num + 1) * sizeof(interval_t));
+
+	for (i = 0; i < num; i++)
+	{
+		flash_trace_t* e = &ring[(first + i) % g_hdr.num_entries];
+
+		// the timer counts down and wraps around
+		if (i != 0)
+			now += (uint64_t) (uint32_t) (prev_time - e->time) * 1000000000ULL / g_hdr.timer_hz;
+
+		prev_time = e->time;
+
+		if (e->bank >= g_hdr.num_banks)
+		{
+			fprintf(stderr, "entry %llu: invalid bank %u\n", (unsigned long long) (first + i), e->bank);
+			return 1;
+		}
+
+		iv[i] = schedule(e, now);
+
+		if (iv[i].end > span)
+			span = iv[i].end;
+	}
+
+	printf("%llu commands (%llu recorded since boot, ring of %u), %.3f ms\n", (unsigned long long) num,
+		   (unsigned long long) g_hdr.count, g_hdr.num_entries, span / 1e6);
+
+	for (op = 0; op < NUM_OPS; op++)
+	{
+		if (g_op_cnt[op] != 0)
+			printf("  %-9s %10llu\n", c_op_name[op], (unsigned long long) g_op_cnt[op]);
+	}
+
+	if (num == 0)
+		return 0;
+
+	printf("bank utilization:");
+
+	for (bank = 0; bank < g_hdr.num_banks; bank++)
+		printf(" %u:%.0f%%", bank, 100.0 * g_bank_busy[bank] / span);
+
+	printf("\nchannel utilization:");
+
+	for (chnl = 0; chnl < g_hdr.num_chnls; chnl++)
+	{
+		if (g_chnl_busy[chnl] != 0)
+			printf(" %u:%.1f%%", chnl, 100.0 * g_chnl_busy[chnl] / span);
+	}
+
+	printf("\n\n%.3f ms per column; upper case = busy more than half of the column\n", span / 1e6 / cols);
+
+	for (bank = 0; bank < g_hdr.num_banks; bank++)
+		print_bank_row(iv, num, bank, span, cols);
+
+	for (chnl = 0; chnl < g_hdr.num_chnls; chnl++)
+	{
+		if (g_chnl_busy[chnl] != 0)
+			print_chnl_row(chnl, span, cols);
+	}
+
+	if (csv_path != NULL)
+	{
+		file = fopen(csv_path, "w");
+
+		if (file == NULL)
+		{
+			fprintf(stderr, "cannot create %s\n", csv_path);
+			return 1;
+		}
+
+		fprintf(file, "bank,chnl,op,issue_us,start_us,end_us\n");
+
+		for (i = 0; i < num; i++)
+		{
+			fprintf(file, "%u,%u,%s,%.3f,%.3f,%.3f\n", iv[i].bank, g_hdr.rbank[iv[i].bank] % g_hdr.num_chnls,
+					c_op_name[iv[i].op], iv[i].issue / 1e3, iv[i].start / 1e3, iv[i].end / 1e3);
+		}
+
+		fclose(file);
+	}
+
+	free(g_xfer);
+	free(iv);
+	free(ring);
+
+	return 0;
+}
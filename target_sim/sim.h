@@ -0,0 +1,136 @@
+// Copyright 2011 INDILINX Co., Ltd.
+//
+// This file is part of Jasmine.
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Jasmine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Jasmine. See the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//
+// Host-native simulation of the Jasmine platform
+//
+// The firmware sources (ftl_*, mem_util.c, flash.c, flash_wrapper.c, ...) are compiled
+// for the host with PROGRAM_HOST_SIM defined. GETREG()/SETREG() are routed to
+// sim_getreg()/sim_setreg(), which model the flash controller, the memory utility engine,
+// the SATA buffer manager, the timers and the UART in software.
+// DRAM is a plain memory mapping at DRAM_BASE that follows the ECC-gapped layout of the
+// real SDRAM controller, so read_dram_*() work unmodified.
+// The firmware runs on a stack below DRAM_BASE, so that every address the firmware sees fits in 32 bits.
+
+#ifndef SIM_H
+#define SIM_H
+
+////////////////////////////////
+// register access (firmware)
+////////////////////////////////
+
+UINT32	sim_getreg(UINT32 const addr);
+void	sim_setreg(UINT32 const addr, UINT32 const val);
+void	sim_assert_fail(const char* file, int line) __attribute__((noreturn));	// like the while (1) of the firmware ASSERT()
+
+////////////////////////////////
+// host side interface
+////////////////////////////////
+
+#define SIM_STACK_BASE		0x30000000		// firmware stack, below DRAM_BASE
+#define SIM_STACK_BYTES		(16 * 1024 * 1024)
+
+// physical address of a DRAM byte (4 byte ECC parity after every DRAM_ECC_UNIT bytes)
+#define SIM_DRAM_PHYS(ADDR)	(DRAM_BASE + ((ADDR) - DRAM_BASE) / DRAM_ECC_UNIT * (DRAM_ECC_UNIT + 4) + ((ADDR) - DRAM_BASE) % DRAM_ECC_UNIT)
+#define SIM_DRAM_PHYS_BYTES	(DRAM_SIZE / DRAM_ECC_UNIT * (DRAM_ECC_UNIT + 4) + DRAM_ECC_UNIT + 4)
+
+// NAND and controller timing in nanoseconds (see sim_nand.c)
+typedef struct
+{
+	UINT32	t_r;				// page read, array -> page register
+	UINT32	t_prog;				// page program, page register -> array
+	UINT32	t_bers;				// block erase
+	UINT32	t_dbsy;				// dummy busy between the planes of a 2-plane operation
+	UINT32	t_cmd;				// command and address cycles on the channel
+	UINT32	ps_per_cycle;		// channel cycle, CHN_WIDTH bytes per cycle
+	UINT32	t_reg;				// CPU cost of a register access
+	UINT32	mu_bytes_per_us;	// memory utility engine bandwidth
+}
+sim_timing_t;
+
+extern sim_timing_t g_sim_timing;
+
+typedef struct
+{
+	UINT64	page_read;			// FC_*_READ* commands
+	UINT64	page_program;		// FC_*_PROG commands
+	UINT64	copyback;			// FC_COPYBACK, FC_MODIFY_COPYBACK
+	UINT64	erase;				// FC_ERASE
+	UINT64	sect_read;			// sectors transferred flash -> memory
+	UINT64	sect_program;		// sectors transferred memory -> flash
+	UINT64	busy_ns;			// time the bank spent executing commands
+}
+sim_bank_stat_t;
+
+typedef struct
+{
+	UINT64	host_read_cmds;
+	UINT64	host_write_cmds;
+	UINT64	host_read_sects;
+	UINT64	host_write_sects;
+	sim_bank_stat_t	bank[NUM_BANKS_MAX];	// indexed by virtual bank number
+	UINT64	chnl_busy_ns[NUM_CHNLS_MAX];	// data transfer time of each channel
+}
+sim_stat_t;
+
+extern sim_stat_t g_sim_stat;
+
+// sim_hal.c
+void	sim_mem_init(void);
+void	sim_mem_read(UINT32 const addr, void* const dst, UINT32 const num_bytes);
+void	sim_mem_write(UINT32 const addr, const void* const src, UINT32 const num_bytes);
+void	sim_mem_fill(UINT32 const addr, UINT32 const val, UINT32 const num_bytes);
+UINT64	sim_clock_ns(void);
+void	sim_clock_advance(UINT64 const ns);
+UINT32	sim_last_reg(void);
+void	sim_sata_read_done(UINT32 const dma_addr, UINT64 const done_at);
+UINT64	sim_sata_read_idle_time(void);
+void	sim_sata_write_done(UINT32 const dma_addr, UINT64 const done_at);
+void	sim_sata_reset(void);
+void	sim_sata_write_arrive(UINT32 const lba, UINT32 const num_sectors);
+void	sim_sata_append_arrive(UINT32 const zslba, UINT32 const lba, UINT32 const num_sectors);
+
+// sim_main.c
+void	sim_host_read(UINT32 const lba, UINT32 const num_sectors);
+void	sim_host_write(UINT32 const lba, UINT32 const num_sectors);
+void	sim_host_append(UINT32 const zslba, UINT32 const lba, UINT32 const num_sectors);
+void	sim_power_loss(void);
+
+// sim_zone_check.c
+UINT32	sim_zone_check(void);
+
+// sim_trace.c
+typedef struct
+{
+	UINT64	time_ns;			// relative to the first command of the trace
+	UINT64	sector;				// 512-byte units
+	UINT32	num_sectors;
+	BOOL32	is_write;
+}
+sim_trace_io_t;
+
+const char*	sim_trace_open(const char* const path);
+BOOL32	sim_trace_next(sim_trace_io_t* const io);
+UINT64	sim_trace_skipped(void);
+
+// sim_nand.c
+void	sim_nand_init(void);
+UINT64	sim_flash_idle_time(void);
+UINT32	sim_flash_getreg(UINT32 const addr);
+void	sim_flash_setreg(UINT32 const addr, UINT32 const val);
+
+#endif // SIM_H
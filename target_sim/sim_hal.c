@@ -0,0 +1,614 @@
+// Copyright 2011 INDILINX Co., Ltd.
+//
+// This file is part of Jasmine.
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Jasmine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Jasmine. See the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//
+// Register model of the Jasmine platform for the host-native simulation
+// (memory utility engine, SATA buffer manager, timers, UART, interrupt control)
+
+#include "jasmine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <execinfo.h>
+#include <sys/mman.h>
+
+extern UINT32 g_ftl_read_buf_id;
+
+sim_stat_t g_sim_stat;
+
+#define HOST_PTR(ADDR)	((void*)(uintptr_t)(ADDR))
+
+////////////////////////////////
+// plain registers
+////////////////////////////////
+
+// Registers without side effects (GPIO, PMU, SDRAM controller, ...) simply hold the last value written.
+
+#define REG_FILE_SIZE	1024
+
+static UINT32 g_reg_addr[REG_FILE_SIZE];
+static UINT32 g_reg_val[REG_FILE_SIZE];
+
+static UINT32* reg_file(UINT32 const addr)
+{
+	UINT32 i = (addr >> 2) % REG_FILE_SIZE;
+
+	while (g_reg_addr[i] != addr && g_reg_addr[i] != 0)
+	{
+		i = (i + 1) % REG_FILE_SIZE;
+	}
+
+	g_reg_addr[i] = addr;
+
+	return &g_reg_val[i];
+}
+
+////////////////////////////////
+// memory
+////////////////////////////////
+
+void sim_mem_init(void)
+{
+	void* dram = mmap(HOST_PTR(DRAM_BASE), SIM_DRAM_PHYS_BYTES, PROT_READ | PROT_WRITE,
+					  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+	if (dram != HOST_PTR(DRAM_BASE))
+	{
+		fprintf(stderr, "sim: cannot map DRAM at 0x%08X\n", DRAM_BASE);
+		exit(1);
+	}
+}
+
+void sim_mem_read(UINT32 addr, void* const dst, UINT32 const num_bytes)
+{
+	UINT8* d = (UINT8*) dst;
+	UINT32 remain = num_bytes;
+
+	if (addr < DRAM_BASE)
+	{
+		memcpy(dst, HOST_PTR(addr), num_bytes);
+		return;
+	}
+
+	ASSERT(addr + num_bytes <= DRAM_BASE + DRAM_SIZE);
+
+	while (remain != 0)
+	{
+		UINT32 size = MIN(remain, DRAM_ECC_UNIT - (addr - DRAM_BASE) % DRAM_ECC_UNIT);
+
+		memcpy(d, HOST_PTR(SIM_DRAM_PHYS(addr)), size);
+
+		addr += size;
+		d += size;
+		remain -= size;
+	}
+}
+
+void sim_mem_write(UINT32 addr, const void* const src, UINT32 const num_bytes)
+{
+	const UINT8* s = (const UINT8*) src;
+	UINT32 remain = num_bytes;
+
+	if (addr < DRAM_BASE)
+	{
+		memcpy(HOST_PTR(addr), src, num_bytes);
+		return;
+	}
+
+	ASSERT(addr + num_bytes <= DRAM_BASE + DRAM_SIZE);
+
+	while (remain != 0)
+	{
+		UINT32 size = MIN(remain, DRAM_ECC_UNIT - (addr - DRAM_BASE) % DRAM_ECC_UNIT);
+
+		memcpy(HOST_PTR(SIM_DRAM_PHYS(addr)), s, size);
+
+		addr += size;
+		s += size;
+		remain -= size;
+	}
+}
+
+void sim_mem_fill(UINT32 addr, UINT32 const val, UINT32 const num_bytes)
+{
+	UINT32 buf[DRAM_ECC_UNIT / sizeof(UINT32)];
+	UINT32 remain = num_bytes;
+	UINT32 i;
+
+	ASSERT(num_bytes % sizeof(UINT32) == 0);
+
+	for (i = 0; i < DRAM_ECC_UNIT / sizeof(UINT32); i++)
+	{
+		buf[i] = val;
+	}
+
+	while (remain != 0)
+	{
+		UINT32 size = MIN(remain, sizeof(buf));
+
+		sim_mem_write(addr, buf, size);
+
+		addr += size;
+		remain -= size;
+	}
+}
+
+////////////////////////////////
+// memory utility engine
+////////////////////////////////
+
+static UINT32 g_mu_src, g_mu_dst, g_mu_value, g_mu_size, g_mu_unitstep, g_mu_result;
+static UINT8 g_mu_buf[MU_MAX_BYTES];
+
+static void mu_busy(UINT32 const num_bytes)
+{
+	sim_clock_advance((UINT64) num_bytes * 1000 / g_sim_timing.mu_bytes_per_us);
+}
+
+static UINT32 mu_search(UINT32 const cmd)
+{
+	UINT32 unit = 1 << ((g_mu_unitstep >> 8) & 0x03);
+	UINT32 step = g_mu_unitstep & 0xFF;
+	UINT32 mask = (unit == sizeof(UINT32)) ? 0xFFFFFFFF : (1 << (unit * 8)) - 1;
+	UINT32 i, found = 0, best = 0;
+
+	ASSERT(g_mu_size != 0 && step * g_mu_size <= MU_MAX_BYTES);
+
+	sim_mem_read(g_mu_src, g_mu_buf, step * g_mu_size);
+	mu_busy(step * g_mu_size);
+
+	for (i = 0; i < g_mu_size; i++)
+	{
+		UINT32 item = 0;
+
+		memcpy(&item, g_mu_buf + i * step, unit);
+
+		if ((cmd & 0x180) == 0)		// MU_CMD_SEARCH_EQU_*
+		{
+			if (item == (g_mu_value & mask))
+				return i;
+		}
+		else if (i == 0 || ((cmd & 0x100) ? item > best : item < best))
+		{
+			best = item;
+			found = i;
+		}
+	}
+
+	return ((cmd & 0x180) == 0) ? g_mu_size : found;
+}
+
+static UINT32 mu_bmp_find(void)
+{
+	UINT32 i;
+
+	sim_mem_read(g_mu_src, g_mu_buf, g_mu_size);
+	mu_busy(g_mu_size);
+
+	for (i = 0; i < g_mu_size * 8; i++)
+	{
+		if (((g_mu_buf[i / 8] >> (i % 8)) & 1) == g_mu_value)
+			return i;
+	}
+
+	return g_mu_size * 8;
+}
+
+static void mu_command(UINT32 const cmd)
+{
+	UINT32 i;
+
+	switch (cmd)
+	{
+		case MU_CMD_COPY:
+			ASSERT(g_mu_size <= MU_MAX_BYTES);
+			sim_mem_read(g_mu_src, g_mu_buf, g_mu_size);
+			sim_mem_write(g_mu_dst, g_mu_buf, g_mu_size);
+			mu_busy(g_mu_size);
+			g_mu_result = 0;
+			break;
+
+		case MU_CMD_SET_REPT_SRAM:
+		case MU_CMD_SET_REPT_DRAM:
+			sim_mem_fill(g_mu_dst, g_mu_value, g_mu_size);
+			mu_busy(g_mu_size);
+			g_mu_result = 0;
+			break;
+
+		case MU_CMD_SET_INCR_32_SRAM:
+		case MU_CMD_SET_INCR_32_DRAM:
+			for (i = 0; i < g_mu_size / sizeof(UINT32); i++)
+			{
+				UINT32 val = g_mu_value + i;
+				sim_mem_write(g_mu_dst + i * sizeof(UINT32), &val, sizeof(UINT32));
+			}
+			mu_busy(g_mu_size);
+			g_mu_result = 0;
+			break;
+
+		case MU_CMD_FIND_SRAM:
+		case MU_CMD_FIND_DRAM:
+			g_mu_result = mu_bmp_find();
+			break;
+
+		case MU_CMD_SEARCH_MAX_SRAM:
+		case MU_CMD_SEARCH_MIN_SRAM:
+		case MU_CMD_SEARCH_EQU_SRAM:
+		case MU_CMD_SEARCH_MAX_DRAM:
+		case MU_CMD_SEARCH_MIN_DRAM:
+		case MU_CMD_SEARCH_EQU_DRAM:
+			g_mu_result = mu_search(cmd);
+			break;
+
+		default:
+			ASSERT(0);
+	}
+}
+
+////////////////////////////////
+// SATA buffer manager
+////////////////////////////////
+
+// The simulated host is infinitely fast:
+// it consumes every read buffer as soon as its data is in DRAM and the buffer manager releases it,
+// and the data of a write command has arrived before the command is handed to the FTL.
+// The data of a read buffer is in DRAM at g_rd_done_at[buf_id] of the simulated clock.
+// A write buffer programmed with FO_B_SATA_W is released (bm_write_limit moves past it)
+// at g_wr_done_at[buf_id], when the flash has read it.
+// As on the hardware, the SATA side fills the write buffers from its own pointer (SATA_WBUF_PTR),
+// whatever g_ftl_write_buf_id is, and only the buffers that the FTL has released:
+// a command that leaves buffers behind shifts the data of the next ones.
+
+static UINT32 g_sata_rbuf_ptr, g_sata_wbuf_ptr;
+static UINT32 g_bm_read_limit, g_bm_write_limit;
+static UINT32 g_bm_stack_rdset, g_bm_stack_wrset;
+static UINT64 g_rd_done_at[NUM_RD_BUFFERS];
+static UINT64 g_rd_idle_at;
+static UINT32 g_wr_flash_ptr;		// the write buffer after the last one programmed with FO_B_SATA_W
+static UINT64 g_wr_done_at[NUM_WR_BUFFERS];
+
+static void release_read_bufs(UINT32 const limit, UINT64 const done_at)
+{
+	UINT32 buf_id;
+
+	for (buf_id = g_bm_read_limit; buf_id != limit; buf_id = (buf_id + 1) % NUM_RD_BUFFERS)
+	{
+		g_rd_done_at[buf_id] = done_at;
+	}
+
+	g_bm_read_limit = limit;
+	g_rd_idle_at = MAX(g_rd_idle_at, done_at);
+}
+
+// called by the flash model for [flash -> DRAM] with FO_B_SATA_R
+void sim_sata_read_done(UINT32 const dma_addr, UINT64 const done_at)
+{
+	if (dma_addr >= RD_BUF_ADDR && dma_addr < RD_BUF_ADDR + RD_BUF_BYTES)
+	{
+		release_read_bufs((RD_BUF_ID(dma_addr) + 1) % NUM_RD_BUFFERS, done_at);
+	}
+}
+
+// time when the host has received all the read data released so far
+UINT64 sim_sata_read_idle_time(void)
+{
+	return g_rd_idle_at;
+}
+
+static UINT32 sata_rbuf_ptr(void)
+{
+	// the host consumes the buffers in order
+	while (g_sata_rbuf_ptr != g_bm_read_limit && g_rd_done_at[g_sata_rbuf_ptr] <= sim_clock_ns())
+	{
+		g_sata_rbuf_ptr = (g_sata_rbuf_ptr + 1) % NUM_RD_BUFFERS;
+	}
+
+	// busy-wait loop on a buffer that is still being read from flash
+	if (g_sata_rbuf_ptr != g_bm_read_limit && sim_last_reg() == SATA_RBUF_PTR)
+	{
+		sim_clock_advance(g_rd_done_at[g_sata_rbuf_ptr] - sim_clock_ns());
+		g_sata_rbuf_ptr = (g_sata_rbuf_ptr + 1) % NUM_RD_BUFFERS;
+	}
+
+	return g_sata_rbuf_ptr;
+}
+
+// called by the flash model for [DRAM -> flash] with FO_B_SATA_W
+void sim_sata_write_done(UINT32 const dma_addr, UINT64 const done_at)
+{
+	if (dma_addr >= WR_BUF_ADDR && dma_addr < WR_BUF_ADDR + WR_BUF_BYTES)
+	{
+		UINT32 buf_id = WR_BUF_ID(dma_addr);
+
+		g_wr_done_at[buf_id] = done_at;
+		g_wr_flash_ptr = (buf_id + 1) % NUM_WR_BUFFERS;
+	}
+}
+
+static UINT32 bm_write_limit(void)
+{
+	// the buffer manager releases the buffers in order
+	while (g_bm_write_limit != g_wr_flash_ptr && g_wr_done_at[g_bm_write_limit] <= sim_clock_ns())
+	{
+		g_bm_write_limit = (g_bm_write_limit + 1) % NUM_WR_BUFFERS;
+	}
+
+	// busy-wait loop on a buffer that the flash has not read yet
+	if (g_bm_write_limit != g_wr_flash_ptr && sim_last_reg() == BM_WRITE_LIMIT)
+	{
+		sim_clock_advance(g_wr_done_at[g_bm_write_limit] - sim_clock_ns());
+		g_bm_write_limit = (g_bm_write_limit + 1) % NUM_WR_BUFFERS;
+	}
+
+	return g_bm_write_limit;
+}
+
+// the host data of a write command, starting at sect_offset of the next write buffer
+static void sata_write_arrive(UINT32 sect_offset, UINT32 const lba, UINT32 const num_sectors)
+{
+	UINT32 num_bufs = (sect_offset + num_sectors + SECTORS_PER_PAGE - 1) / SECTORS_PER_PAGE;
+	UINT32 buf_id = g_sata_wbuf_ptr;
+	UINT32 i;
+
+	ASSERT(num_bufs < NUM_WR_BUFFERS);
+
+	// The host waits for the buffers that the flash is still reading.
+	// Those that the FTL holds are never released without it: the data would overrun bm_write_limit.
+	while ((g_sata_wbuf_ptr + NUM_WR_BUFFERS - bm_write_limit()) % NUM_WR_BUFFERS + num_bufs >= NUM_WR_BUFFERS)
+	{
+		ASSERT(g_bm_write_limit != g_wr_flash_ptr);
+
+		sim_clock_advance(g_wr_done_at[g_bm_write_limit] - MIN(g_wr_done_at[g_bm_write_limit], sim_clock_ns()));
+	}
+
+	// Every sector carries its own LBA, in the same way as tc_synth.c does.
+	for (i = 0; i < num_sectors; i++)
+	{
+		sim_mem_fill(WR_BUF_PTR(buf_id) + sect_offset * BYTES_PER_SECTOR, lba + i, BYTES_PER_SECTOR);
+
+		if (++sect_offset == SECTORS_PER_PAGE)
+		{
+			sect_offset = 0;
+			buf_id = (buf_id + 1) % NUM_WR_BUFFERS;
+		}
+	}
+
+	g_sata_wbuf_ptr = (g_sata_wbuf_ptr + num_bufs) % NUM_WR_BUFFERS;
+}
+
+// power on: the SATA side and the buffer manager start at buffer 0 (flash_reset() sets the limits to 0 as well)
+void sim_sata_reset(void)
+{
+	g_sata_rbuf_ptr = g_sata_wbuf_ptr = 0;
+	g_bm_read_limit = g_bm_write_limit = 0;
+	g_wr_flash_ptr = 0;
+	g_rd_idle_at = 0;
+	memset(g_rd_done_at, 0, sizeof(g_rd_done_at));
+	memset(g_wr_done_at, 0, sizeof(g_wr_done_at));
+}
+
+void sim_sata_write_arrive(UINT32 const lba, UINT32 const num_sectors)
+{
+	sata_write_arrive(lba % SECTORS_PER_PAGE, lba, num_sectors);
+}
+
+// The data of a Zone Append command is placed by the zone start LBA (see handle_got_cfis()).
+// It carries the LBA that the host expects the FTL to assign to it.
+void sim_sata_append_arrive(UINT32 const zslba, UINT32 const lba, UINT32 const num_sectors)
+{
+	sata_write_arrive(zslba % SECTORS_PER_PAGE, lba, num_sectors);
+}
+
+////////////////////////////////
+// clock and timers
+////////////////////////////////
+
+// Simulated time advances with register accesses, memory utility operations
+// and busy-wait loops on the flash controller status (see sim_nand.c).
+// Computation of the firmware between register accesses takes no time.
+
+static UINT64 g_sim_now;
+static UINT32 g_last_reg;
+
+static UINT32 g_tm_load[4], g_tm_control[4];
+static UINT64 g_tm_start[4];
+
+UINT64 sim_clock_ns(void)
+{
+	return g_sim_now;
+}
+
+void sim_clock_advance(UINT64 const ns)
+{
+	g_sim_now += ns;
+}
+
+// address of the register most recently accessed by the firmware
+UINT32 sim_last_reg(void)
+{
+	return g_last_reg;
+}
+
+static UINT32 timer_value(UINT32 const ch)
+{
+	UINT32 prescale = (g_tm_control[ch] >> 2) & 0x03;
+	UINT32 div = PRESCALE_TO_DIV(prescale);
+	UINT64 ticks;
+
+	if ((g_tm_control[ch] & TM_ENABLE) == 0)
+		return g_tm_load[ch];
+
+	ticks = (sim_clock_ns() - g_tm_start[ch]) * (CLOCK_SPEED / 2 / 1000000) / 1000 / div;
+
+	return g_tm_load[ch] - (UINT32) ticks;
+}
+
+////////////////////////////////
+// register access
+////////////////////////////////
+
+static UINT32 getreg(UINT32 const addr)
+{
+	if (addr >= FREG_BASE && addr < FREG_BASE + 0x1000)
+	{
+		return sim_flash_getreg(addr);
+	}
+
+	switch (addr)
+	{
+		case MU_RESULT:			return g_mu_result;
+		case BM_READ_LIMIT:		return g_bm_read_limit;
+		case BM_WRITE_LIMIT:	return bm_write_limit();
+		case SATA_RBUF_PTR:		return sata_rbuf_ptr();
+		case SATA_WBUF_PTR:		return g_sata_wbuf_ptr;
+		case UART_FIFOCNT:		return UART_TXFIFO_EMPTY << 6;
+		case TM_1_VALUE:		return timer_value(0);
+		case TM_2_VALUE:		return timer_value(1);
+		case TM_3_VALUE:		return timer_value(2);
+		case TM_4_VALUE:		return timer_value(3);
+		default:				return *reg_file(addr);
+	}
+}
+
+UINT32 sim_getreg(UINT32 const addr)
+{
+	UINT32 val;
+
+	g_sim_now += g_sim_timing.t_reg;
+
+	val = getreg(addr);
+	g_last_reg = addr;
+
+	return val;
+}
+
+void sim_setreg(UINT32 const addr, UINT32 const val)
+{
+	g_sim_now += g_sim_timing.t_reg;
+	g_last_reg = addr;
+
+	if (addr >= FREG_BASE && addr < FREG_BASE + 0x1000)
+	{
+		sim_flash_setreg(addr, val);
+		return;
+	}
+
+	if (addr >= TM_1_LOAD && addr < TM_4_LOAD + 0x20)
+	{
+		UINT32 ch = (addr - TM_1_LOAD) / 0x20;
+
+		if (addr == TM_1_LOAD + ch * 0x20)
+		{
+			g_tm_load[ch] = val;
+		}
+		else if (addr == TM_1_CONTROL + ch * 0x20)
+		{
+			g_tm_control[ch] = val;
+			g_tm_start[ch] = sim_clock_ns();
+		}
+		return;
+	}
+
+	switch (addr)
+	{
+		case MU_SRC_ADDR:	g_mu_src = val;			break;
+		case MU_DST_ADDR:	g_mu_dst = val;			break;
+		case MU_VALUE:		g_mu_value = val;		break;
+		case MU_SIZE:		g_mu_size = val;		break;
+		case MU_UNITSTEP:	g_mu_unitstep = val;	break;
+		case MU_CMD:		mu_command(val);		break;
+
+		case BM_STACK_RDSET:	g_bm_stack_rdset = val;	break;
+		case BM_STACK_WRSET:	g_bm_stack_wrset = val;	break;
+		case BM_STACK_RESET:
+			if (val & 0x02)
+			{
+				release_read_bufs(g_bm_stack_rdset, sim_clock_ns());
+			}
+			if (val & 0x01)
+			{
+				g_bm_write_limit = g_bm_stack_wrset;
+				g_wr_flash_ptr = g_bm_stack_wrset;
+			}
+			break;
+
+		case UART_FIFODATA:
+			if (val != '\r')
+				putchar((int) val);
+			break;
+
+		default:
+			*reg_file(addr) = val;
+	}
+}
+
+////////////////////////////////
+// CPU
+////////////////////////////////
+
+static UINT32 g_irq_disabled, g_fiq_disabled;
+
+UINT32 disable_irq(void)
+{
+	UINT32 was_disabled = g_irq_disabled;
+	g_irq_disabled = TRUE;
+	return was_disabled;
+}
+
+void enable_irq(void)
+{
+	g_irq_disabled = FALSE;
+}
+
+UINT32 disable_fiq(void)
+{
+	UINT32 was_disabled = g_fiq_disabled;
+	g_fiq_disabled = TRUE;
+	return was_disabled;
+}
+
+void enable_fiq(void)
+{
+	g_fiq_disabled = FALSE;
+}
+
+void enable_interrupt(void)
+{
+	enable_irq();
+	enable_fiq();
+}
+
+void disable_interrupt(void)
+{
+	disable_irq();
+	disable_fiq();
+}
+
+void delay(UINT32 const count)
+{
+}
+
+void sim_assert_fail(const char* file, int line)
+{
+	void* frames[32];
+
+	fflush(stdout);
+	fprintf(stderr, "assertion fail: %s, line# %d\n", file, line);
+	backtrace_symbols_fd(frames, backtrace(frames, 32), 2);
+	abort();
+}
@@ -0,0 +1,775 @@
+// Copyright 2011 INDILINX Co., Ltd.
+//
+// This file is part of Jasmine.
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Jasmine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Jasmine. See the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//
+// Driver of the host-native simulation
+//
+// Boots the FTL on the simulated platform, feeds it a synthetic workload through ftl_read()/ftl_write()
+// in the same way as Main() does with the SATA event queue, and reports throughput, latency and write amplification.
+//
+// Instead of a synthetic workload, a block trace can be replayed (see sim_trace.c),
+// or the data of the zone commands can be checked (-C, see sim_zone_check.c).
+//
+// The host issues one command at a time (queue depth 1). The latency of a command is measured on the simulated
+// clock from the submission to the return of ftl_write(), or to the arrival of the last read data for ftl_read().
+// A trace is replayed as fast as possible, or at the pace of its timestamps (-R), in which case the latency
+// includes the time the command waited for the previous one.
+
+#include "jasmine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+#ifndef SIM_FTL_NAME
+#define SIM_FTL_NAME	"unknown"
+#endif
+
+#define WL_SEQ_WRITE	0
+#define WL_RAND_WRITE	1
+#define WL_SEQ_READ		2
+#define WL_RAND_READ	3
+#define WL_MIXED		4
+#define WL_HOT_COLD		5		// 80% of the commands go to the first 20% of the range
+#define WL_ZONE_SEQ		6		// sequential writes into SIM_OPEN_ZONES zones at a time
+#define WL_ZONE_APPEND	7		// Zone Append commands into SIM_OPEN_ZONES zones at a time (FTL_ZONE_APPEND only)
+
+static const char* const c_workload_name[] = { "seqwrite", "randwrite", "seqread", "randread", "mixed", "hotcold", "zoneseq",
+											   "zoneappend" };
+
+#ifdef ZONE_SIZE
+#define SIM_ZONE_SECTORS	ZONE_SIZE
+#else
+#define SIM_ZONE_SECTORS	65536		// same as ftl_zns
+#endif
+#define SIM_OPEN_ZONES		4
+
+#define MAX_SECTORS_PER_CMD	256		// larger trace commands are split, as the block layer would do
+
+typedef struct
+{
+	UINT32	workload;
+	UINT32	num_cmds;
+	UINT32	sectors_per_cmd;
+	UINT32	start_lba;
+	UINT32	range;			// number of sectors touched by the workload
+	UINT32	read_pct;		// WL_MIXED only
+	UINT32	seed;
+	char*	trace;			// trace file to replay instead of the workload
+	BOOL32	timed;			// replay the trace at the pace of its timestamps
+	BOOL32	precondition;	// fill the range sequentially before the measurement
+	BOOL32	summary;		// print one line for the benchmark table (see build_host/bench.sh)
+	char*	trace_dump;		// file to write the flash command trace log to (see target_sim/flash_trace.c)
+	BOOL32	power_cycle;	// cut the power after the workload (no ftl_flush) and boot again from the NAND
+	BOOL32	zone_check;		// run the data checks of sim_zone_check.c instead of a workload
+}
+sim_config_t;
+
+static sim_config_t g_cfg =
+{
+	WL_RAND_WRITE,
+	100000,
+	8,
+	0,
+	131072,
+	70,
+	1,
+	NULL,
+	FALSE,
+	FALSE,
+	FALSE,
+	NULL,
+	FALSE,
+	FALSE
+};
+
+static const char* g_trace_format;
+
+static ucontext_t g_host_ctx, g_fw_ctx;
+
+typedef struct
+{
+	UINT64*	ns;
+	UINT32	count;
+	UINT32	capacity;
+}
+sim_lat_t;
+
+static sim_lat_t g_read_lat, g_write_lat, g_all_lat;
+
+static UINT32 g_append_misplaced;	// Zone Append commands that failed or got another LBA than the host expected
+static UINT32 g_check_failed;		// sectors and zones that sim_zone_check() found wrong
+
+static void usage(const char* prog)
+{
+	fprintf(stderr,
+		"usage: %s [-w seqwrite|randwrite|seqread|randread|mixed|hotcold|zoneseq|zoneappend] [-n commands] [-s sectors per command]\n"
+		"       [-l start lba] [-r lba range] [-p read percentage for mixed] [-S seed]\n"
+		"       [-t tR:tPROG:tBERS in microseconds]\n"
+		"       [-T trace file (blkparse, fio iolog, SNIA csv)] [-R replay at trace timestamps]\n"
+		"       [-P fill the lba range before the measurement] [-b print a one-line summary]\n"
+		"       [-D file to dump the flash command trace to]\n"
+		"       [-M power cycle after the workload and report the mount time]\n"
+		"       [-C check the data of the zone commands instead of a workload (FTL_ZONE_MGMT only)]\n", prog);
+	exit(1);
+}
+
+static void parse_timing(const char* prog, const char* arg)
+{
+	unsigned t_r, t_prog, t_bers;
+
+	if (sscanf(arg, "%u:%u:%u", &t_r, &t_prog, &t_bers) != 3)
+		usage(prog);
+
+	g_sim_timing.t_r = t_r * 1000;
+	g_sim_timing.t_prog = t_prog * 1000;
+	g_sim_timing.t_bers = t_bers * 1000;
+}
+
+static void parse_args(int argc, char** argv)
+{
+	BOOL32 range_set = FALSE;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "w:n:s:l:r:p:S:t:T:RPbD:MCh")) != -1)
+	{
+		switch (opt)
+		{
+			case 'w':
+				for (i = 0; i < (int)(sizeof(c_workload_name) / sizeof(c_workload_name[0])); i++)
+				{
+					if (strcmp(optarg, c_workload_name[i]) == 0)
+						break;
+				}
+				if (i == (int)(sizeof(c_workload_name) / sizeof(c_workload_name[0])))
+					usage(argv[0]);
+				#ifndef FTL_ZONE_APPEND
+				if (i == WL_ZONE_APPEND)
+				{
+					fprintf(stderr, "sim: ftl %s does not support Zone Append\n", SIM_FTL_NAME);
+					exit(1);
+				}
+				#endif
+				g_cfg.workload = i;
+				break;
+			case 'n': g_cfg.num_cmds = strtoul(optarg, NULL, 0);			break;
+			case 's': g_cfg.sectors_per_cmd = strtoul(optarg, NULL, 0);	break;
+			case 'l': g_cfg.start_lba = strtoul(optarg, NULL, 0);			break;
+			case 'r': g_cfg.range = strtoul(optarg, NULL, 0);	range_set = TRUE;	break;
+			case 'p': g_cfg.read_pct = strtoul(optarg, NULL, 0);			break;
+			case 'S': g_cfg.seed = strtoul(optarg, NULL, 0);				break;
+			case 't': parse_timing(argv[0], optarg);						break;
+			case 'T': g_cfg.trace = optarg;									break;
+			case 'R': g_cfg.timed = TRUE;									break;
+			case 'P': g_cfg.precondition = TRUE;							break;
+			case 'b': g_cfg.summary = TRUE;									break;
+			case 'D': g_cfg.trace_dump = optarg;							break;
+			case 'M': g_cfg.power_cycle = TRUE;								break;
+			case 'C': g_cfg.zone_check = TRUE;								break;
+			default: usage(argv[0]);
+		}
+	}
+
+	// trace LBAs are folded into [start lba, start lba + range), the whole drive by default
+	if (g_cfg.trace != NULL && !range_set && g_cfg.start_lba < NUM_LSECTORS)
+	{
+		g_cfg.range = NUM_LSECTORS - g_cfg.start_lba;
+	}
+
+	if (g_cfg.sectors_per_cmd == 0 || g_cfg.sectors_per_cmd > g_cfg.range ||
+		g_cfg.start_lba + g_cfg.range > NUM_LSECTORS)
+	{
+		usage(argv[0]);
+	}
+}
+
+// power on with the NAND contents of the previous boot
+static void mount(void)
+{
+	flash_reset();
+
+	SETREG(FCONF_PAUSE, 0);
+	SETREG(INTR_MASK, 0);
+
+	ftl_open();
+	ftl_stat_init();
+}
+
+static void boot(void)
+{
+	sim_nand_init();
+	mount();
+}
+
+// Power loss: the NAND keeps what has been programmed, DRAM and the controller registers are lost.
+void sim_power_loss(void)
+{
+	sim_mem_fill(DRAM_BASE, 0, DRAM_SIZE);
+	sim_sata_reset();
+
+	mount();
+}
+
+static void power_cycle(void)
+{
+	UINT64 start = sim_clock_ns();
+
+	sim_power_loss();
+
+	printf("power cycle: mounted in %.3f ms\n", (sim_clock_ns() - start) / 1e6);
+}
+
+static void lat_add(sim_lat_t* const lat, UINT64 const ns)
+{
+	if (lat->count == lat->capacity)
+	{
+		lat->capacity = (lat->capacity == 0) ? 65536 : lat->capacity * 2;
+		lat->ns = (UINT64*) realloc(lat->ns, sizeof(UINT64) * lat->capacity);
+		ASSERT(lat->ns != NULL);
+	}
+
+	lat->ns[lat->count++] = ns;
+}
+
+void sim_host_read(UINT32 const lba, UINT32 const num_sectors)
+{
+	g_sim_stat.host_read_sects += num_sectors;
+	UINT32 start_time = ftl_stat_time();
+
+	g_ftl_stat.host_read_sects += num_sectors;
+
+	ftl_read(lba, num_sectors);
+	ftl_stat_lat(LAT_FTL_READ, start_time);
+}
+
+void sim_host_write(UINT32 const lba, UINT32 const num_sectors)
+{
+	g_sim_stat.host_write_sects += num_sectors;
+	UINT32 start_time = ftl_stat_time();
+
+	g_ftl_stat.host_write_sects += num_sectors;
+
+	sim_sata_write_arrive(lba, num_sectors);
+	ftl_write(lba, num_sectors);
+	ftl_stat_lat(LAT_FTL_WRITE, start_time);
+}
+
+// A Zone Append command to the zone that starts at zslba, whose data the host expects at lba.
+// The host learns the LBA from the zone append log; the newest entry is that of this command.
+void sim_host_append(UINT32 const zslba, UINT32 const lba, UINT32 const num_sectors)
+{
+	#ifdef FTL_ZONE_APPEND
+	zone_append_hdr_t hdr;
+	zone_append_t entry;
+
+	g_sim_stat.host_write_sects += num_sectors;
+	UINT32 start_time = ftl_stat_time();
+
+	g_ftl_stat.host_write_sects += num_sectors;
+
+	sim_sata_append_arrive(zslba, lba, num_sectors);
+	ftl_write(zslba | ZONE_CMD_APPEND, num_sectors);
+	ftl_stat_lat(LAT_FTL_WRITE, start_time);
+
+	sim_mem_read(ZONE_APPEND_ADDR, &hdr, sizeof(hdr));
+	sim_mem_read(ZONE_APPEND_ADDR + BYTES_PER_SECTOR + (hdr.count - 1) % hdr.num_entries * sizeof(entry), &entry, sizeof(entry));
+
+	if (entry.status != ZONE_APPEND_OK || entry.lba != lba)
+	{
+		g_append_misplaced++;
+	}
+	#endif
+}
+
+// one host command, submitted at the given time of the simulated clock
+static void host_command(BOOL32 const is_write, UINT32 lba, UINT32 num_sectors, UINT64 const submit_ns)
+{
+	while (num_sectors != 0)
+	{
+		UINT32 n = MIN(num_sectors, MAX_SECTORS_PER_CMD);
+
+		if (is_write && g_cfg.workload == WL_ZONE_APPEND && g_cfg.trace == NULL)
+			sim_host_append(lba - (lba - g_cfg.start_lba) % SIM_ZONE_SECTORS, lba, n);
+		else if (is_write)
+			sim_host_write(lba, n);
+		else
+			sim_host_read(lba, n);
+
+		lba += n;
+		num_sectors -= n;
+	}
+
+	if (is_write)
+	{
+		g_sim_stat.host_write_cmds++;
+		lat_add(&g_write_lat, sim_clock_ns() - submit_ns);
+		lat_add(&g_all_lat, sim_clock_ns() - submit_ns);
+	}
+	else
+	{
+		g_sim_stat.host_read_cmds++;
+		lat_add(&g_read_lat, MAX(sim_clock_ns(), sim_sata_read_idle_time()) - submit_ns);
+		lat_add(&g_all_lat, MAX(sim_clock_ns(), sim_sata_read_idle_time()) - submit_ns);
+	}
+}
+
+// sequential fill of the lba range, not included in the results
+static void precondition(void)
+{
+	UINT32 lba, n;
+
+	for (lba = g_cfg.start_lba; lba < g_cfg.start_lba + g_cfg.range; lba += n)
+	{
+		n = MIN(MAX_SECTORS_PER_CMD, g_cfg.start_lba + g_cfg.range - lba);
+		sim_host_write(lba, n);
+	}
+
+	flash_finish();
+}
+
+static void run_workload(void)
+{
+	UINT32 num_slots = g_cfg.range / g_cfg.sectors_per_cmd;
+	UINT32 num_hot_slots = MAX(num_slots / 5, 1);
+	UINT32 num_zones = MAX(g_cfg.range / SIM_ZONE_SECTORS, 1);
+	UINT32 zone[SIM_OPEN_ZONES], zone_offset[SIM_OPEN_ZONES];
+	UINT32 i, lba, stream;
+	BOOL32 is_read;
+
+	srand(g_cfg.seed);
+
+	for (stream = 0; stream < SIM_OPEN_ZONES; stream++)
+	{
+		zone[stream] = stream % num_zones;
+		zone_offset[stream] = 0;
+	}
+
+	for (i = 0; i < g_cfg.num_cmds; i++)
+	{
+		switch (g_cfg.workload)
+		{
+			case WL_SEQ_WRITE:
+			case WL_SEQ_READ:
+				lba = g_cfg.start_lba + (i % num_slots) * g_cfg.sectors_per_cmd;
+				break;
+			case WL_HOT_COLD:
+				if ((UINT32) rand() % 100 < 80 || num_hot_slots == num_slots)
+					lba = (UINT32) rand() % num_hot_slots;
+				else
+					lba = num_hot_slots + (UINT32) rand() % (num_slots - num_hot_slots);
+
+				lba = g_cfg.start_lba + lba * g_cfg.sectors_per_cmd;
+				break;
+			case WL_ZONE_SEQ:
+			case WL_ZONE_APPEND:
+				// each stream fills its zone and moves on to the next zone not used by the other streams
+				stream = i % SIM_OPEN_ZONES;
+				lba = g_cfg.start_lba + zone[stream] * SIM_ZONE_SECTORS + zone_offset[stream];
+				zone_offset[stream] += g_cfg.sectors_per_cmd;
+
+				if (zone_offset[stream] + g_cfg.sectors_per_cmd > MIN(SIM_ZONE_SECTORS, g_cfg.range))
+				{
+					zone[stream] = (zone[stream] + SIM_OPEN_ZONES) % num_zones;
+					zone_offset[stream] = 0;
+				}
+				break;
+			default:
+				lba = g_cfg.start_lba + ((UINT32) rand() % num_slots) * g_cfg.sectors_per_cmd;
+				break;
+		}
+
+		if (g_cfg.workload == WL_MIXED)
+			is_read = ((UINT32) rand() % 100) < g_cfg.read_pct;
+		else
+			is_read = (g_cfg.workload == WL_SEQ_READ || g_cfg.workload == WL_RAND_READ);
+
+		host_command(!is_read, lba, g_cfg.sectors_per_cmd, sim_clock_ns());
+	}
+
+	flash_finish();
+}
+
+static void run_trace(void)
+{
+	sim_trace_io_t io;
+	UINT64 start = sim_clock_ns();
+	UINT64 submit_ns;
+	UINT32 lba, num_sectors;
+
+	while (sim_trace_next(&io))
+	{
+		num_sectors = (UINT32) MIN(io.num_sectors, g_cfg.range);
+		lba = g_cfg.start_lba + (UINT32)(io.sector % g_cfg.range);
+
+		if (lba + num_sectors > g_cfg.start_lba + g_cfg.range)
+		{
+			lba = g_cfg.start_lba + g_cfg.range - num_sectors;
+		}
+
+		if (g_cfg.timed)
+		{
+			submit_ns = start + io.time_ns;
+
+			// the drive is idle until the command arrives, and Main() calls ftl_idle() in the meantime
+			while (submit_ns > sim_clock_ns() && ftl_idle());
+
+			if (submit_ns > sim_clock_ns())
+				sim_clock_advance(submit_ns - sim_clock_ns());
+		}
+		else
+		{
+			submit_ns = sim_clock_ns();
+		}
+
+		host_command(io.is_write, lba, num_sectors, submit_ns);
+	}
+
+	flash_finish();
+}
+
+static int compare_u64(const void* a, const void* b)
+{
+	UINT64 x = *(const UINT64*) a, y = *(const UINT64*) b;
+
+	return (x > y) - (x < y);
+}
+
+// in microseconds, lat->ns[] must be sorted
+static double percentile(sim_lat_t const* lat, UINT32 const permille)
+{
+	UINT64 rank = ((UINT64) lat->count * permille + 999) / 1000;
+
+	if (lat->count == 0)
+		return 0.0;
+
+	return lat->ns[rank == 0 ? 0 : rank - 1] / 1e3;
+}
+
+static void report_latency(const char* name, sim_lat_t* const lat)
+{
+	UINT64 sum = 0;
+	UINT32 i;
+
+	if (lat->count == 0)
+		return;
+
+	qsort(lat->ns, lat->count, sizeof(UINT64), compare_u64);
+
+	for (i = 0; i < lat->count; i++)
+	{
+		sum += lat->ns[i];
+	}
+
+	printf("%s latency (us): avg %.1f, p50 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n", name, sum / 1e3 / lat->count,
+		   percentile(lat, 500), percentile(lat, 990), percentile(lat, 999), lat->ns[lat->count - 1] / 1e3);
+}
+
+// garbage collection part of g_ftl_stat, as the host would read it with READ LOG EXT (see ftl_stat.h)
+static void report_ftl_stat(void)
+{
+	UINT32 bank;
+
+	printf("%4s %8s %10s %10s %9s\n", "bank", "gc", "gc write", "gc ms", "min free");
+
+	for (bank = 0; bank < NUM_BANKS; bank++)
+	{
+		ftl_bank_stat_t* s = &g_ftl_stat.bank[bank];
+
+		if (s->free_blk_min == INVALID32)
+			printf("%4u %8u %10u %10.1f %9s\n", bank, s->gc_cnt, s->gc_write, s->gc_time_us / 1e3, "-");
+		else
+			printf("%4u %8u %10u %10.1f %9u\n", bank, s->gc_cnt, s->gc_write, s->gc_time_us / 1e3, s->free_blk_min);
+	}
+}
+
+// upper bound of the log2 bucket that holds the given permille of the samples (at most the maximum), in microseconds
+static double hist_percentile(const ftl_lat_hist_t* const h, UINT64 const count, UINT32 const permille)
+{
+	UINT64 rank = (count * permille + 999) / 1000;
+	UINT64 sum = 0;
+	UINT32 i;
+
+	for (i = 0; i < NUM_LAT_BUCKETS - 1; i++)
+	{
+		sum += h->bucket[i];
+
+		if (sum >= rank)
+			break;
+	}
+
+	return MIN((1ULL << i), (UINT64) h->max) * 1e6 / g_ftl_lat.timer_hz;
+}
+
+// firmware-side latency histograms, as the host would read them with READ LOG EXT (see ftl_stat.h)
+static void report_ftl_lat(void)
+{
+	static const char* const name[NUM_LAT_HISTS] = { "ftl_read", "ftl_write", "gc", "pmap log", "flash wait" };
+	UINT32 i, b;
+
+	printf("%-10s %10s %10s %10s %10s %10s\n", "firmware", "count", "avg us", "p99 <us", "p99.9 <us", "max us");
+
+	for (i = 0; i < NUM_LAT_HISTS; i++)
+	{
+		const ftl_lat_hist_t* h = &g_ftl_lat.hist[i];
+		UINT64 count = 0;
+
+		for (b = 0; b < NUM_LAT_BUCKETS; b++)
+		{
+			count += h->bucket[b];
+		}
+
+		if (count == 0)
+			continue;
+
+		printf("%-10s %10llu %10.1f %10.1f %10.1f %10.1f\n", name[i], count, h->total * 1e6 / g_ftl_lat.timer_hz / count,
+			   hist_percentile(h, count, 990), hist_percentile(h, count, 999), h->max * 1e6 / g_ftl_lat.timer_hz);
+	}
+}
+
+static void report(UINT64 const sim_ns, UINT64 const wall_ns)
+{
+	sim_bank_stat_t total;
+	UINT32 bank, chnl;
+	double sec = sim_ns / 1e9;
+	double mb = (g_sim_stat.host_read_sects + g_sim_stat.host_write_sects) * BYTES_PER_SECTOR / 1048576.0;
+	UINT64 cmds = g_sim_stat.host_read_cmds + g_sim_stat.host_write_cmds;
+
+	memset(&total, 0, sizeof(total));
+
+	if (g_cfg.trace != NULL)
+	{
+		printf("\nftl %s, trace %s (%s, %s), lba %u + %u, %llu lines skipped\n", SIM_FTL_NAME, g_cfg.trace, g_trace_format,
+			   g_cfg.timed ? "timed" : "as fast as possible", g_cfg.start_lba, g_cfg.range, sim_trace_skipped());
+	}
+	else
+	{
+		printf("\nftl %s, workload %s, %u commands x %u sectors, lba %u + %u\n", SIM_FTL_NAME,
+			   c_workload_name[g_cfg.workload], g_cfg.num_cmds, g_cfg.sectors_per_cmd, g_cfg.start_lba, g_cfg.range);
+	}
+
+	printf("tR %u us, tPROG %u us, tBERS %u us\n", g_sim_timing.t_r / 1000, g_sim_timing.t_prog / 1000, g_sim_timing.t_bers / 1000);
+	printf("%4s %10s %10s %10s %8s %6s\n", "bank", "read", "program", "copyback", "erase", "busy");
+
+	for (bank = 0; bank < NUM_BANKS; bank++)
+	{
+		sim_bank_stat_t* s = &g_sim_stat.bank[bank];
+
+		printf("%4u %10llu %10llu %10llu %8llu %5.1f%%\n", bank, s->page_read, s->page_program, s->copyback, s->erase,
+			   sim_ns > 0 ? 100.0 * s->busy_ns / sim_ns : 0.0);
+
+		total.page_read += s->page_read;
+		total.page_program += s->page_program;
+		total.copyback += s->copyback;
+		total.erase += s->erase;
+	}
+
+	printf("%4s %10llu %10llu %10llu %8llu\n", "all", total.page_read, total.page_program, total.copyback, total.erase);
+
+	printf("channel busy:");
+
+	for (chnl = 0; chnl < NUM_CHNLS_MAX; chnl++)
+	{
+		if (g_sim_stat.chnl_busy_ns[chnl] != 0)
+			printf(" %u %.1f%%", chnl, sim_ns > 0 ? 100.0 * g_sim_stat.chnl_busy_ns[chnl] / sim_ns : 0.0);
+	}
+
+	printf("\n");
+	printf("host read %llu commands %llu sectors, host write %llu commands %llu sectors\n", g_sim_stat.host_read_cmds,
+		   g_sim_stat.host_read_sects, g_sim_stat.host_write_cmds, g_sim_stat.host_write_sects);
+	printf("simulated %.3f s, throughput %.2f MB/s, %.0f IOPS (host time %.3f s)\n",
+		   sec, sec > 0 ? mb / sec : 0.0, sec > 0 ? cmds / sec : 0.0, wall_ns / 1e9);
+
+	report_latency("read", &g_read_lat);
+	report_latency("write", &g_write_lat);
+
+	if (g_cfg.workload == WL_ZONE_APPEND && g_cfg.trace == NULL)
+		printf("zone append: %u commands failed or were placed at another LBA than expected\n", g_append_misplaced);
+
+	if (g_sim_stat.host_write_sects != 0)
+	{
+		double host_pages = (double) g_sim_stat.host_write_sects / SECTORS_PER_PAGE;
+
+		// Garbage collection is internal to each FTL; the simulator sees it as copybacks, erases and extra programs.
+		printf("WAF %.3f (NAND page writes per host page), %.2f erases and %.2f copybacks per 1000 host pages\n",
+			   (total.page_program + total.copyback) / host_pages, total.erase * 1000 / host_pages, total.copyback * 1000 / host_pages);
+	}
+
+	report_ftl_stat();
+	report_ftl_lat();
+}
+
+// one tab separated line for build_host/bench.sh
+static void report_summary(UINT64 const sim_ns)
+{
+	UINT64 programs = 0, erases = 0;
+	UINT32 bank;
+	double sec = sim_ns / 1e9;
+	double mb = (g_sim_stat.host_read_sects + g_sim_stat.host_write_sects) * BYTES_PER_SECTOR / 1048576.0;
+	UINT64 cmds = g_sim_stat.host_read_cmds + g_sim_stat.host_write_cmds;
+
+	for (bank = 0; bank < NUM_BANKS; bank++)
+	{
+		programs += g_sim_stat.bank[bank].page_program + g_sim_stat.bank[bank].copyback;
+		erases += g_sim_stat.bank[bank].erase;
+	}
+
+	qsort(g_all_lat.ns, g_all_lat.count, sizeof(UINT64), compare_u64);
+
+	printf("bench\t%s\t%s\t%.2f\t%.0f\t%.3f\t%llu\t%.1f\t%.1f\n", SIM_FTL_NAME, c_workload_name[g_cfg.workload],
+		   sec > 0 ? mb / sec : 0.0, sec > 0 ? cmds / sec : 0.0,
+		   g_sim_stat.host_write_sects != 0 ? (double) programs * SECTORS_PER_PAGE / g_sim_stat.host_write_sects : 0.0,
+		   erases, percentile(&g_all_lat, 990), percentile(&g_all_lat, 999));
+}
+
+// Some FTLs stop in an endless loop when they run out of free blocks (e.g. ftl_tutorial has no garbage collection).
+// The simulated clock stands still in such a loop, because the firmware does not access any register.
+static void watchdog(int sig)
+{
+	static UINT64 last_ns = ~0ULL;
+
+	if (sim_clock_ns() == last_ns)
+	{
+		fprintf(stderr, "sim: the firmware stopped (no register access for 10 seconds)\n");
+		_exit(3);
+	}
+
+	last_ns = sim_clock_ns();
+	alarm(10);
+}
+
+// the flash command trace log, as the host would read it with READ LOG EXT (page 0 = header, then the ring)
+static void dump_flash_trace(const char* const path)
+{
+	UINT8 hdr_page[BYTES_PER_SECTOR];
+	FILE* file = fopen(path, "wb");
+
+	if (file == NULL)
+	{
+		fprintf(stderr, "sim: cannot create %s\n", path);
+		return;
+	}
+
+	memset(hdr_page, 0, sizeof(hdr_page));
+	ftl_stat_trace_header((flash_trace_hdr_t*) hdr_page);
+	fwrite(hdr_page, 1, sizeof(hdr_page), file);
+
+	#if OPTION_FLASH_TRACE
+	{
+		UINT8* ring = (UINT8*) malloc(FLASH_TRACE_BYTES);
+
+		ASSERT(ring != NULL);
+		sim_mem_read(FLASH_TRACE_ADDR, ring, FLASH_TRACE_BYTES);
+		fwrite(ring, 1, FLASH_TRACE_BYTES, file);
+		free(ring);
+	}
+	#endif
+
+	fclose(file);
+}
+
+static UINT64 wall_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (UINT64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void firmware_main(void)
+{
+	UINT64 start, wall_start, end;
+
+	boot();
+
+	if (g_cfg.zone_check)
+	{
+		g_check_failed = sim_zone_check();
+		return;
+	}
+
+	if (g_cfg.precondition)
+		precondition();
+
+	memset(&g_sim_stat, 0, sizeof(g_sim_stat));
+	ftl_stat_init();
+
+	start = sim_clock_ns();
+	wall_start = wall_clock_ns();
+
+	if (g_cfg.trace != NULL)
+		run_trace();
+	else
+		run_workload();
+
+	end = MAX(sim_clock_ns(), sim_sata_read_idle_time());
+
+	if (g_cfg.summary)
+		report_summary(end - start);
+	else
+		report(end - start, wall_clock_ns() - wall_start);
+
+	if (g_cfg.trace_dump != NULL)
+		dump_flash_trace(g_cfg.trace_dump);
+
+	if (g_cfg.power_cycle)
+		power_cycle();
+}
+
+int main(int argc, char** argv)
+{
+	void* stack;
+
+	parse_args(argc, argv);
+
+	if (g_cfg.trace != NULL)
+	{
+		g_trace_format = sim_trace_open(g_cfg.trace);
+	}
+
+	sim_mem_init();
+
+	// The firmware casts addresses of local variables to UINT32, so it must not run on the host stack.
+	stack = mmap((void*)(uintptr_t) SIM_STACK_BASE, SIM_STACK_BYTES, PROT_READ | PROT_WRITE,
+				 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+	if (stack != (void*)(uintptr_t) SIM_STACK_BASE)
+	{
+		fprintf(stderr, "sim: cannot map the firmware stack at 0x%08X\n", SIM_STACK_BASE);
+		return 1;
+	}
+
+	getcontext(&g_fw_ctx);
+	g_fw_ctx.uc_stack.ss_sp = stack;
+	g_fw_ctx.uc_stack.ss_size = SIM_STACK_BYTES;
+	g_fw_ctx.uc_link = &g_host_ctx;
+	makecontext(&g_fw_ctx, firmware_main, 0);
+
+	signal(SIGALRM, watchdog);
+	alarm(10);
+
+	swapcontext(&g_host_ctx, &g_fw_ctx);
+
+	fflush(stdout);
+
+	return (g_check_failed != 0) ? 2 : 0;
+}
@@ -0,0 +1,574 @@
+// Copyright 2011 INDILINX Co., Ltd.
+//
+// This file is part of Jasmine.
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Jasmine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Jasmine. See the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//
+// Flash controller and NAND array model for the host-native simulation
+//
+// FCP registers are latched as the firmware writes them. A write to FCP_ISSUE takes a snapshot
+// of the FCP registers (Waiting Room) and executes the command against the NAND array of the
+// target bank. The bank status port (BSP) reflects the last command of each bank.
+//
+// Data moves when the command is issued, but the timing is modelled separately: every bank and every
+// channel has the time when it becomes free. A command is accepted by its bank when the bank is free,
+// occupies the channel during command/address cycles and data transfers, and the bank for tR/tPROG/tBERS.
+// The status registers (WR_STAT, BSP_FSM, MON_CHABANKIDLE) report busy until the simulated clock reaches
+// the completion time. When the firmware polls the same status register twice in a row, the clock skips
+// ahead to the completion time instead of spinning through millions of register accesses.
+//
+// The NAND array is sparse: a page that has never been programmed since the last erase has no storage
+// and reads as all-0xFF. A programmed sector whose contents is a repeated 32-bit word (e.g. the host data
+// pattern of the simulation driver) is stored as that word, so that long simulations stay small.
+// A page is programmed once between two erases of its block: programming it again is an assertion failure.
+
+#include "jasmine.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ROWS_PER_SIM_BANK	(VBLKS_PER_BANK * PAGES_PER_VBLK)
+#define CHANNEL(RBANK)		((RBANK) % NUM_CHNLS_MAX)
+
+#if NAND_SPEC_CELL == NAND_SPEC_CELL_SLC
+#define DEFAULT_T_R			25000
+#define DEFAULT_T_PROG		250000
+#define DEFAULT_T_BERS		2000000
+#else
+#define DEFAULT_T_R			60000
+#define DEFAULT_T_PROG		1300000
+#define DEFAULT_T_BERS		3500000
+#endif
+
+sim_timing_t g_sim_timing =
+{
+	DEFAULT_T_R,
+	DEFAULT_T_PROG,
+	DEFAULT_T_BERS,
+	500,						// t_dbsy
+	7 * PS_PER_FLASH_CYCLE / 1000,	// t_cmd: 1 command + 5 address + 1 command cycles
+	PS_PER_FLASH_CYCLE,
+	20,							// t_reg
+	500							// mu_bytes_per_us
+};
+
+typedef struct
+{
+	UINT32	fill[SECTORS_PER_PAGE];		// repeated word, valid if data[] is NULL
+	UINT8*	data[SECTORS_PER_PAGE];
+}
+sim_page_t;
+
+typedef struct
+{
+	UINT32	cmd;
+	UINT32	option;
+	UINT32	dma_addr;
+	UINT32	dma_cnt;
+	UINT32	col;
+	UINT32	row_l;
+	UINT32	row_h;
+	UINT32	dst_col;
+	UINT32	dst_row_l;
+	UINT32	dst_row_h;
+	UINT32	cmd_id;
+}
+sim_cmd_t;
+
+static sim_page_t**	g_nand[NUM_BANKS_MAX];						// [rbank][row]
+static UINT8		g_page_reg[NUM_BANKS_MAX][BYTES_PER_PAGE];	// page register of each bank
+static UINT32		g_page_reg_row[NUM_BANKS_MAX];
+
+static UINT32		g_fcp_reg[(FCP_ISSUE - FCP_BASE) / sizeof(UINT32) + 1];
+static sim_cmd_t	g_bsp[NUM_BANKS_MAX];
+static UINT8		g_bsp_intr[NUM_BANKS_MAX];
+
+static UINT64		g_bank_free_at[NUM_BANKS_MAX];		// completion time of the last command of each bank
+static UINT64		g_chnl_free_at[NUM_CHNLS_MAX];
+static UINT64		g_wr_free_at;						// time when Waiting Room becomes empty
+
+#define FCP_REG(ADDR)	g_fcp_reg[((ADDR) - FCP_BASE) / sizeof(UINT32)]
+
+static UINT32 virtual_bank(UINT32 const rbank)
+{
+	return c_bank_rmap[rbank];
+}
+
+static sim_page_t* get_page(UINT32 const rbank, UINT32 const row)
+{
+	ASSERT(row < ROWS_PER_SIM_BANK);
+
+	return g_nand[rbank][row];
+}
+
+static void free_page(UINT32 const rbank, UINT32 const row)
+{
+	sim_page_t* page = get_page(rbank, row);
+	UINT32 sect;
+
+	if (page == NULL)
+		return;
+
+	for (sect = 0; sect < SECTORS_PER_PAGE; sect++)
+	{
+		free(page->data[sect]);
+	}
+
+	free(page);
+	g_nand[rbank][row] = NULL;
+}
+
+// flash array -> page register
+static BOOL32 load_page_reg(UINT32 const rbank, UINT32 const row)
+{
+	sim_page_t* page = get_page(rbank, row);
+	UINT8* reg = g_page_reg[rbank];
+	UINT32 sect, i;
+
+	g_page_reg_row[rbank] = row;
+
+	if (page == NULL)
+	{
+		memset(reg, 0xFF, BYTES_PER_PAGE);
+		return TRUE;
+	}
+
+	for (sect = 0; sect < SECTORS_PER_PAGE; sect++)
+	{
+		UINT8* dst = reg + sect * BYTES_PER_SECTOR;
+
+		if (page->data[sect] != NULL)
+		{
+			memcpy(dst, page->data[sect], BYTES_PER_SECTOR);
+		}
+		else
+		{
+			for (i = 0; i < BYTES_PER_SECTOR; i += sizeof(UINT32))
+			{
+				memcpy(dst + i, &page->fill[sect], sizeof(UINT32));
+			}
+		}
+	}
+
+	return FALSE;
+}
+
+// page register -> flash array
+static void store_page_reg(UINT32 const rbank, UINT32 const row)
+{
+	sim_page_t* page;
+	UINT8* reg = g_page_reg[rbank];
+	UINT32 sect, i, word;
+
+	ASSERT(get_page(rbank, row) == NULL);	// a page is programmed once between two erases of its block
+
+	page = (sim_page_t*) calloc(1, sizeof(sim_page_t));
+	ASSERT(page != NULL);
+
+	for (sect = 0; sect < SECTORS_PER_PAGE; sect++)
+	{
+		UINT8* src = reg + sect * BYTES_PER_SECTOR;
+
+		memcpy(&word, src, sizeof(UINT32));
+
+		for (i = sizeof(UINT32); i < BYTES_PER_SECTOR; i += sizeof(UINT32))
+		{
+			if (memcmp(src + i, &word, sizeof(UINT32)) != 0)
+				break;
+		}
+
+		if (i == BYTES_PER_SECTOR)
+		{
+			page->fill[sect] = word;
+		}
+		else
+		{
+			page->data[sect] = (UINT8*) malloc(BYTES_PER_SECTOR);
+			ASSERT(page->data[sect] != NULL);
+			memcpy(page->data[sect], src, BYTES_PER_SECTOR);
+		}
+	}
+
+	g_nand[rbank][row] = page;
+}
+
+// [memory -> page register]
+// memory address = FCP_DMA_ADDR + FCP_COL * BYTES_PER_SECTOR (see the notes in flash.h)
+static void data_in(UINT32 const rbank, sim_cmd_t const* cmd, UINT32 const col, UINT64 const data_done)
+{
+	UINT32 offset = col * BYTES_PER_SECTOR;
+
+	ASSERT(offset + cmd->dma_cnt <= BYTES_PER_PAGE);
+
+	sim_mem_read(cmd->dma_addr + offset, g_page_reg[rbank] + offset, cmd->dma_cnt);
+
+	g_sim_stat.bank[virtual_bank(rbank)].sect_program += (cmd->dma_cnt + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR;
+
+	if (cmd->option & FO_B_SATA_W)
+	{
+		sim_sata_write_done(cmd->dma_addr, data_done);
+	}
+}
+
+// [page register -> memory]
+static void data_out(UINT32 const rbank, sim_cmd_t const* cmd, UINT64 const data_done)
+{
+	UINT32 offset = cmd->col * BYTES_PER_SECTOR;
+	UINT32 sect, word;
+	BOOL32 all_ff = TRUE;
+
+	ASSERT(offset + cmd->dma_cnt <= BYTES_PER_PAGE);
+
+	sim_mem_write(cmd->dma_addr + offset, g_page_reg[rbank] + offset, cmd->dma_cnt);
+
+	for (sect = 0; sect < cmd->dma_cnt && all_ff; sect += sizeof(UINT32))
+	{
+		memcpy(&word, g_page_reg[rbank] + offset + sect, sizeof(UINT32));
+		all_ff = (word == 0xFFFFFFFF);
+	}
+
+	if (all_ff)
+	{
+		g_bsp_intr[rbank] |= FIRQ_ALL_FF;
+	}
+
+	g_sim_stat.bank[virtual_bank(rbank)].sect_read += (cmd->dma_cnt + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR;
+
+	if (cmd->option & FO_B_SATA_R)
+	{
+		sim_sata_read_done(cmd->dma_addr, data_done);
+	}
+}
+
+static void program(UINT32 const rbank, UINT32 const row)
+{
+	store_page_reg(rbank, row);
+	g_sim_stat.bank[virtual_bank(rbank)].page_program++;
+}
+
+// occupy the channel of the bank for num_bytes of data (or a command sequence if num_bytes is zero)
+static UINT64 transfer(UINT32 const rbank, UINT64 const t, UINT32 const num_bytes)
+{
+	UINT32 chnl = CHANNEL(rbank);
+	UINT64 start = MAX(t, g_chnl_free_at[chnl]);
+	UINT64 ns = (num_bytes == 0) ? g_sim_timing.t_cmd
+			  : (UINT64) num_bytes / CHN_WIDTH * g_sim_timing.ps_per_cycle / 1000;
+
+	g_chnl_free_at[chnl] = start + ns;
+	g_sim_stat.chnl_busy_ns[chnl] += ns;
+
+	return start + ns;
+}
+
+static UINT64 array_busy(sim_cmd_t const* cmd, UINT64 const t, UINT32 const t_op)
+{
+	return t + t_op + ((cmd->option & FO_P) ? g_sim_timing.t_dbsy : 0);
+}
+
+// returns the time when the bank finishes the command
+// *data_done is set to the time when the data of a read command is in memory,
+// or when a program command has taken its data from memory
+static UINT64 schedule(UINT32 const rbank, sim_cmd_t const* cmd, UINT64 const accept, UINT64* const data_done)
+{
+	UINT64 t = transfer(rbank, accept, 0);
+	UINT64 data_in_done = 0;
+
+	switch (cmd->cmd)
+	{
+		case FC_COL_ROW_IN_PROG:
+		case FC_IN_PROG:
+			t = transfer(rbank, t, cmd->dma_cnt);
+			data_in_done = t;
+			t = array_busy(cmd, t, g_sim_timing.t_prog);
+			break;
+
+		case FC_COL_ROW_IN:
+		case FC_IN:
+			t = transfer(rbank, t, cmd->dma_cnt);
+			break;
+
+		case FC_PROG:
+			t = array_busy(cmd, t, g_sim_timing.t_prog);
+			break;
+
+		case FC_COL_ROW_READ_OUT:
+			t = array_busy(cmd, t, g_sim_timing.t_r);
+			t = transfer(rbank, t, cmd->dma_cnt);
+			break;
+
+		case FC_COL_ROW_READ:
+			t = array_busy(cmd, t, g_sim_timing.t_r);
+			break;
+
+		case FC_OUT:
+		case FC_COL_OUT:
+			t = transfer(rbank, t, cmd->dma_cnt);
+			break;
+
+		case FC_COPYBACK:
+		case FC_MODIFY_COPYBACK:
+			// the entire page goes through the ECC engine (see flash.h)
+			t = array_busy(cmd, t, g_sim_timing.t_r);
+			t = transfer(rbank, t, BYTES_PER_PAGE);
+
+			if (cmd->cmd == FC_MODIFY_COPYBACK)
+			{
+				t = transfer(rbank, t, cmd->dma_cnt);
+			}
+
+			t = array_busy(cmd, t, g_sim_timing.t_prog);
+			break;
+
+		case FC_ERASE:
+			t = array_busy(cmd, t, g_sim_timing.t_bers);
+			break;
+
+		default:
+			break;
+	}
+
+	*data_done = (data_in_done != 0) ? data_in_done : t;
+
+	return t;
+}
+
+static void execute(UINT32 const rbank, sim_cmd_t const* cmd, UINT64 const data_done)
+{
+	UINT32 vbank = virtual_bank(rbank);
+	UINT32 row = cmd->row_l;
+	UINT32 dst_row = cmd->dst_row_l;
+	UINT32 i;
+
+	switch (cmd->cmd)
+	{
+		case FC_COL_ROW_IN_PROG:
+			memset(g_page_reg[rbank], 0xFF, BYTES_PER_PAGE);
+			data_in(rbank, cmd, cmd->col, data_done);
+			program(rbank, row);
+			break;
+
+		case FC_COL_ROW_IN:
+			memset(g_page_reg[rbank], 0xFF, BYTES_PER_PAGE);
+			g_page_reg_row[rbank] = row;
+			data_in(rbank, cmd, cmd->col, data_done);
+			break;
+
+		case FC_IN:
+			data_in(rbank, cmd, cmd->col, data_done);
+			break;
+
+		case FC_IN_PROG:
+			data_in(rbank, cmd, cmd->col, data_done);
+			program(rbank, g_page_reg_row[rbank]);
+			break;
+
+		case FC_PROG:
+			program(rbank, g_page_reg_row[rbank]);
+			break;
+
+		case FC_COL_ROW_READ_OUT:
+			load_page_reg(rbank, row);
+			g_sim_stat.bank[vbank].page_read++;
+			data_out(rbank, cmd, data_done);
+			break;
+
+		case FC_COL_ROW_READ:
+			load_page_reg(rbank, row);
+			g_sim_stat.bank[vbank].page_read++;
+			break;
+
+		case FC_OUT:
+		case FC_COL_OUT:
+			data_out(rbank, cmd, data_done);
+			break;
+
+		case FC_COPYBACK:
+		case FC_MODIFY_COPYBACK:
+			load_page_reg(rbank, row);
+
+			if (cmd->cmd == FC_MODIFY_COPYBACK)
+			{
+				data_in(rbank, cmd, cmd->dst_col, data_done);
+			}
+
+			store_page_reg(rbank, dst_row);
+			g_sim_stat.bank[vbank].copyback++;
+			break;
+
+		case FC_ERASE:
+			row = row / PAGES_PER_VBLK * PAGES_PER_VBLK;
+
+			for (i = 0; i < PAGES_PER_VBLK; i++)
+			{
+				free_page(rbank, row + i);
+			}
+
+			g_sim_stat.bank[vbank].erase++;
+			break;
+
+		case FC_WAIT:
+		case FC_GENERIC:
+		case FC_GENERIC_ADDR:
+		case FC_READ_ID:
+			break;
+
+		default:
+			ASSERT(0);
+	}
+}
+
+static void issue(void)
+{
+	UINT32 rbank = FCP_REG(FCP_BANK);
+	UINT64 now = sim_clock_ns();
+	UINT64 accept, done, data_done;
+	sim_cmd_t* cmd;
+
+	ASSERT(rbank < NUM_BANKS_MAX && g_nand[rbank] != NULL);
+
+	cmd = &g_bsp[rbank];
+	cmd->cmd		= FCP_REG(FCP_CMD);
+	cmd->option		= FCP_REG(FCP_OPTION);
+	cmd->dma_addr	= FCP_REG(FCP_DMA_ADDR);
+	cmd->dma_cnt	= FCP_REG(FCP_DMA_CNT);
+	cmd->col		= FCP_REG(FCP_COL);
+	cmd->row_l		= FCP_REG(_FCP_ROW_L(rbank));
+	cmd->row_h		= FCP_REG(_FCP_ROW_H(rbank));
+	cmd->dst_col	= FCP_REG(FCP_DST_COL);
+	cmd->dst_row_l	= FCP_REG(FCP_DST_ROW_L);
+	cmd->dst_row_h	= FCP_REG(FCP_DST_ROW_H);
+	cmd->cmd_id		= FCP_REG(FCP_CMD_ID);
+
+	// The command waits in Waiting Room until the target bank finishes its previous command.
+	accept = MAX(now, g_bank_free_at[rbank]);
+	done = schedule(rbank, cmd, accept, &data_done);
+
+	g_wr_free_at = accept;
+	g_bank_free_at[rbank] = done;
+	g_sim_stat.bank[virtual_bank(rbank)].busy_ns += done - accept;
+
+	execute(rbank, cmd, data_done);
+}
+
+// A busy-wait loop reads the same register over and over again. On the second consecutive read,
+// let the clock jump to the time when the answer changes.
+static BOOL32 wait_until(UINT32 const addr, UINT64 const t)
+{
+	UINT64 now = sim_clock_ns();
+
+	if (now >= t)
+		return FALSE;
+
+	if (sim_last_reg() != addr)
+		return TRUE;
+
+	sim_clock_advance(t - now);
+
+	return FALSE;
+}
+
+UINT64 sim_flash_idle_time(void)
+{
+	UINT64 t = g_wr_free_at;
+	UINT32 rbank;
+
+	for (rbank = 0; rbank < NUM_BANKS_MAX; rbank++)
+	{
+		t = MAX(t, g_bank_free_at[rbank]);
+	}
+
+	return t;
+}
+
+UINT32 sim_flash_getreg(UINT32 const addr)
+{
+	if (addr >= FCP_BASE && addr <= FCP_ISSUE)
+	{
+		return FCP_REG(addr);
+	}
+	else if (addr >= BSP_INTR_BASE && addr < BSP_INTR_BASE + NUM_BANKS_MAX)
+	{
+		return g_bsp_intr[addr - BSP_INTR_BASE];
+	}
+	else if (addr >= BSP_FSM_BASE && addr < BSP_FSM_BASE + NUM_BANKS_MAX)
+	{
+		return wait_until(addr, g_bank_free_at[addr - BSP_FSM_BASE]) ? BANK_WAIT : BANK_IDLE;
+	}
+	else if (addr >= BSP_BASE && addr < BSP_BASE + SIZE_OF_BSP * NUM_BANKS_MAX)
+	{
+		sim_cmd_t* bsp = &g_bsp[(addr - BSP_BASE) / SIZE_OF_BSP];
+
+		switch ((addr - BSP_BASE) % SIZE_OF_BSP)
+		{
+			case 0x00: return bsp->cmd;
+			case 0x04: return bsp->option;
+			case 0x08: return bsp->dma_addr;
+			case 0x0C: return bsp->dma_cnt;
+			case 0x10: return bsp->col;
+			case 0x14: return bsp->row_h;
+			case 0x18: return bsp->row_l;
+			case 0x1C: return bsp->dst_col;
+			case 0x20: return bsp->dst_row_h;
+			case 0x24: return bsp->dst_row_l;
+			case 0x28: return bsp->cmd_id;
+			default: return 0;
+		}
+	}
+	else if (addr == WR_STAT)
+	{
+		return wait_until(addr, g_wr_free_at) ? 1 : 0;
+	}
+	else if (addr == MON_CHABANKIDLE)
+	{
+		return wait_until(addr, sim_flash_idle_time()) ? 1 : 0;
+	}
+
+	return 0;
+}
+
+void sim_flash_setreg(UINT32 const addr, UINT32 const val)
+{
+	if (addr == FCP_ISSUE)
+	{
+		issue();
+	}
+	else if (addr >= FCP_BASE && addr < FCP_ISSUE)
+	{
+		FCP_REG(addr) = val;
+	}
+	else if (addr >= BSP_INTR_BASE && addr < BSP_INTR_BASE + NUM_BANKS_MAX)
+	{
+		// write 1 to clear, four banks per word
+		UINT32 rbank = (addr - BSP_INTR_BASE) / 4 * 4;
+		UINT32 i;
+
+		for (i = 0; i < 4; i++)
+		{
+			g_bsp_intr[rbank + i] &= ~(UINT8)(val >> (i * 8));
+		}
+	}
+}
+
+void sim_nand_init(void)
+{
+	UINT32 bank;
+
+	for (bank = 0; bank < NUM_BANKS; bank++)
+	{
+		UINT32 rbank = REAL_BANK(bank);
+
+		g_nand[rbank] = (sim_page_t**) calloc(ROWS_PER_SIM_BANK, sizeof(sim_page_t*));
+		ASSERT(g_nand[rbank] != NULL);
+	}
+}
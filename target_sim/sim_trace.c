@@ -0,0 +1,269 @@
+// Copyright 2011 INDILINX Co., Ltd.
+//
+// This file is part of Jasmine.
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Jasmine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Jasmine. See the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//
+// Block trace reader for the host-native simulation
+//
+// The trace file is memory-mapped and parsed one line at a time, so that traces larger than
+// the host memory can be replayed. Supported formats (detected from the first line):
+//
+//	blkparse	default text output of blkparse
+//				"  8,0    3       11     0.009507758   697  Q   W 223490 + 8 [kjournald]"
+//				Only one event type is replayed: Q (queued) if the trace has it, otherwise D (issued).
+//	fio iolog	"fio version 2 iolog" or "fio version 3 iolog" header
+//				v2: "filename action offset length", v3: "timestamp(ms) filename action offset length"
+//	SNIA		comma separated values of the MSR Cambridge traces
+//				"Timestamp,Hostname,DiskNumber,Type,Offset,Size,ResponseTime"
+//				(timestamp in 100ns units, offset and size in bytes)
+//
+// Byte offsets are converted to 512-byte sectors, rounding the end of the request up.
+// Events other than reads and writes (flush, discard, open, close, ...) are skipped.
+
+#include "jasmine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TRACE_BLKPARSE	0
+#define TRACE_IOLOG2	1
+#define TRACE_IOLOG3	2
+#define TRACE_SNIA		3
+
+static const char* const c_trace_format_name[] = { "blkparse", "fio iolog v2", "fio iolog v3", "SNIA csv" };
+
+#define MAX_LINE_LEN	512
+
+static const char*	g_trace_base;
+static size_t		g_trace_bytes;
+static size_t		g_trace_pos;
+static UINT32		g_trace_format;
+static char			g_blk_action;		// blkparse event type being replayed
+static BOOL32		g_time_valid;
+static UINT64		g_time_base;
+static UINT64		g_num_skipped;
+
+// copy the next line into buf, returns FALSE at the end of the trace
+static BOOL32 next_line(char* const buf)
+{
+	const char* line;
+	const char* eol;
+	size_t len;
+
+	if (g_trace_pos >= g_trace_bytes)
+		return FALSE;
+
+	line = g_trace_base + g_trace_pos;
+	eol = memchr(line, '\n', g_trace_bytes - g_trace_pos);
+	len = (eol != NULL) ? (size_t)(eol - line) : g_trace_bytes - g_trace_pos;
+
+	g_trace_pos += len + 1;
+
+	if (len > 0 && line[len - 1] == '\r')
+		len--;
+
+	if (len >= MAX_LINE_LEN)
+		len = MAX_LINE_LEN - 1;
+
+	memcpy(buf, line, len);
+	buf[len] = '\0';
+
+	return TRUE;
+}
+
+static void set_extent(sim_trace_io_t* const io, UINT64 const offset, UINT64 const num_bytes)
+{
+	io->sector = offset / BYTES_PER_SECTOR;
+	io->num_sectors = (UINT32)((offset + num_bytes + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR - io->sector);
+}
+
+static BOOL32 parse_blkparse(const char* line, sim_trace_io_t* const io, UINT64* const time_ns)
+{
+	char action[8], rwbs[8];
+	unsigned long long sector;
+	unsigned num_sectors;
+	double sec;
+
+	if (sscanf(line, "%*s %*u %*u %lf %*u %7s %7s %llu + %u", &sec, action, rwbs, &sector, &num_sectors) != 5)
+		return FALSE;
+
+	if (action[1] != '\0' || (action[0] != 'Q' && action[0] != 'D'))
+		return FALSE;
+
+	if (g_blk_action == 0)
+		g_blk_action = action[0];
+	else if (g_blk_action != action[0])
+		return FALSE;
+
+	if (strchr(rwbs, 'D') != NULL)		// discard
+		return FALSE;
+
+	if (strchr(rwbs, 'W') != NULL)
+		io->is_write = TRUE;
+	else if (strchr(rwbs, 'R') != NULL)
+		io->is_write = FALSE;
+	else
+		return FALSE;
+
+	io->sector = sector;
+	io->num_sectors = num_sectors;
+	*time_ns = (UINT64)(sec * 1e9);
+
+	return TRUE;
+}
+
+static BOOL32 parse_iolog(const char* line, sim_trace_io_t* const io, UINT64* const time_ns)
+{
+	char action[16];
+	unsigned long long msec = 0, offset, num_bytes;
+
+	if (g_trace_format == TRACE_IOLOG3)
+	{
+		if (sscanf(line, "%llu %*s %15s %llu %llu", &msec, action, &offset, &num_bytes) != 4)
+			return FALSE;
+	}
+	else if (sscanf(line, "%*s %15s %llu %llu", action, &offset, &num_bytes) != 3)
+	{
+		return FALSE;
+	}
+
+	if (strcmp(action, "write") == 0)
+		io->is_write = TRUE;
+	else if (strcmp(action, "read") == 0)
+		io->is_write = FALSE;
+	else
+		return FALSE;
+
+	set_extent(io, offset, num_bytes);
+	*time_ns = msec * 1000000;
+
+	return TRUE;
+}
+
+static BOOL32 parse_snia(const char* line, sim_trace_io_t* const io, UINT64* const time_ns)
+{
+	char type[16];
+	unsigned long long ticks, offset, num_bytes;
+
+	if (sscanf(line, "%llu,%*[^,],%*[^,],%15[^,],%llu,%llu", &ticks, type, &offset, &num_bytes) != 4)
+		return FALSE;
+
+	if (strcasecmp(type, "Write") == 0)
+		io->is_write = TRUE;
+	else if (strcasecmp(type, "Read") == 0)
+		io->is_write = FALSE;
+	else
+		return FALSE;
+
+	set_extent(io, offset, num_bytes);
+	*time_ns = ticks * 100;
+
+	return TRUE;
+}
+
+const char* sim_trace_open(const char* const path)
+{
+	char line[MAX_LINE_LEN];
+	struct stat st;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		fprintf(stderr, "sim: cannot open trace %s\n", path);
+		exit(1);
+	}
+
+	g_trace_bytes = (size_t) st.st_size;
+	g_trace_base = (const char*) mmap(NULL, g_trace_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (g_trace_base == MAP_FAILED)
+	{
+		fprintf(stderr, "sim: cannot map trace %s\n", path);
+		exit(1);
+	}
+
+	madvise((void*) g_trace_base, g_trace_bytes, MADV_SEQUENTIAL);
+
+	g_trace_pos = 0;
+	next_line(line);
+
+	if (strncmp(line, "fio version 2 iolog", 19) == 0)
+	{
+		g_trace_format = TRACE_IOLOG2;
+	}
+	else if (strncmp(line, "fio version 3 iolog", 19) == 0)
+	{
+		g_trace_format = TRACE_IOLOG3;
+	}
+	else
+	{
+		g_trace_format = (strchr(line, ',') != NULL && strstr(line, " + ") == NULL) ? TRACE_SNIA : TRACE_BLKPARSE;
+		g_trace_pos = 0;	// the first line is an event (or a header that does not parse)
+	}
+
+	return c_trace_format_name[g_trace_format];
+}
+
+// returns FALSE at the end of the trace
+// io->time_ns is relative to the first event of the trace
+BOOL32 sim_trace_next(sim_trace_io_t* const io)
+{
+	char line[MAX_LINE_LEN];
+	UINT64 time_ns = 0;
+	BOOL32 ok;
+
+	while (next_line(line))
+	{
+		switch (g_trace_format)
+		{
+			case TRACE_BLKPARSE:	ok = parse_blkparse(line, io, &time_ns);	break;
+			case TRACE_SNIA:		ok = parse_snia(line, io, &time_ns);		break;
+			default:				ok = parse_iolog(line, io, &time_ns);		break;
+		}
+
+		if (!ok || io->num_sectors == 0)
+		{
+			g_num_skipped++;
+			continue;
+		}
+
+		if (!g_time_valid)
+		{
+			g_time_base = time_ns;
+			g_time_valid = TRUE;
+		}
+
+		io->time_ns = (time_ns > g_time_base) ? time_ns - g_time_base : 0;
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+// number of trace lines that were not replayed
+UINT64 sim_trace_skipped(void)
+{
+	return g_num_skipped;
+}
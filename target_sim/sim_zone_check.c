@@ -0,0 +1,426 @@
+// Copyright 2011 INDILINX Co., Ltd.
+//
+// This file is part of Jasmine.
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Jasmine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Jasmine. See the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//
+// Data checks of the zone commands (jasmine_sim_zns -C, make check)
+//
+// Every sector written by the simulated host carries its own LBA (see sim_sata_write_arrive()), so a sector read back
+// is right if it holds its LBA below the write pointer of its zone and 0xFF above it. The checks go through the paths
+// that keep the partial page at the write pointer somewhere else than in the zone: the pool buffers and their spills,
+// closed zones, FINISH, unaligned Zone Appends, RESET, commands that cross from the conventional zones into the first
+// sequential write zone, and ftl_flush() followed by a power loss, after which every zone written so far is checked again.
+// The last check loses the power without a flush, after conventional writes and a spill. The NAND of the simulator asserts
+// that a page is erased when it is programmed, so a page the FTL programs again after the power loss stops the check.
+
+#include "jasmine.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef FTL_ZONE_MGMT
+
+#define CHECK_ZONES		(NUM_ZONE_BUFFERS * 3)		// zones used by the checks, from the first sequential write zone on
+#define OTHER_ZONES		10							// zones of the checks but the partial pages of check_straddle() and check_spill()
+#define ANY_STATE		INVALID32
+#define MAX_REPORTED	5							// wrong sectors printed per check
+#define NO_FLUSH_PAGES	MIN((PAGES_PER_BLK + 8) * NUM_BANKS, CONV_LPAGES / 2)	// conventional pages of check_no_flush()
+
+extern UINT32 g_ftl_read_buf_id;
+
+// what the host has written to a zone, and what of it has to survive a power loss
+typedef struct
+{
+	UINT32	zslba;
+	UINT32	written;		// sectors from the zone start
+	UINT32	durable;		// at the last ftl_flush() or RESET
+	BOOL32	full;			// finished: the sectors from 'written' on read as 0xFF
+}
+zone_model_t;
+
+static zone_model_t g_zone[CHECK_ZONES];
+static UINT32 g_num_zones;
+static UINT32 g_num_partial;				// zones that check_straddle() and check_spill() leave a partial page in
+static UINT32 g_conv_lba, g_conv_sectors;	// conventional sectors written by the straddling command
+static UINT32 g_failed;
+
+static zone_model_t* new_zone(void)
+{
+	zone_model_t* z = &g_zone[g_num_zones];
+
+	ASSERT(g_num_zones < CHECK_ZONES && NUM_CONV_ZONES + g_num_zones < NZONE);
+
+	z->zslba = (NUM_CONV_ZONES + g_num_zones++) * ZONE_SIZE;
+	z->written = 0;
+	z->durable = 0;
+	z->full = FALSE;
+
+	return z;
+}
+
+static void zone_write(zone_model_t* const z, UINT32 const num_sectors)
+{
+	sim_host_write(z->zslba + z->written, num_sectors);
+	z->written += num_sectors;
+}
+
+static void zone_append(zone_model_t* const z, UINT32 const num_sectors)
+{
+	sim_host_append(z->zslba, z->zslba + z->written, num_sectors);
+	z->written += num_sectors;
+}
+
+static void zone_mgmt(const char* const name, zone_model_t* const z, UINT32 const action)
+{
+	if (ftl_zone_mgmt(action, z->zslba, FALSE) == FALSE)
+	{
+		printf("%s: zone management action %u on zone %u failed\n", name, action, z->zslba / ZONE_SIZE);
+		g_failed++;
+		return;
+	}
+
+	if (action == ZM_FINISH_ZONE)
+	{
+		z->full = TRUE;
+	}
+	else if (action == ZM_RESET_WP)
+	{
+		z->written = 0;
+		z->durable = 0;
+		z->full = FALSE;
+	}
+}
+
+// num_sectors from lba, in host commands of at most 4 pages, of which the first num_written sectors hold their LBAs
+// (or 0xFF if may_be_lost, for the sectors written since the last page map checkpoint before a power loss)
+static void check_data(const char* const name, UINT32 const lba, UINT32 const num_sectors, UINT32 const num_written,
+					   BOOL32 const may_be_lost)
+{
+	UINT32 sect[BYTES_PER_SECTOR / sizeof(UINT32)];
+	UINT32 done, i, w, num_bad = 0;
+
+	for (done = 0; done < num_sectors; done += i)
+	{
+		UINT32 start = lba + done;
+		UINT32 n = MIN(num_sectors - done, 4 * SECTORS_PER_PAGE);
+		UINT32 buf_id = g_ftl_read_buf_id;
+
+		sim_host_read(start, n);
+		flash_finish();
+
+		for (i = 0; i < n; i++)
+		{
+			UINT32 expected = (done + i < num_written) ? start + i : 0xFFFFFFFF;
+			UINT32 buf = (buf_id + (start % SECTORS_PER_PAGE + i) / SECTORS_PER_PAGE) % NUM_RD_BUFFERS;
+
+			sim_mem_read(RD_BUF_PTR(buf) + (start + i) % SECTORS_PER_PAGE * BYTES_PER_SECTOR, sect, sizeof(sect));
+
+			if (may_be_lost && sect[0] == 0xFFFFFFFF)
+				expected = 0xFFFFFFFF;
+
+			for (w = 0; w < sizeof(sect) / sizeof(UINT32) && sect[w] == expected; w++);
+
+			if (w < sizeof(sect) / sizeof(UINT32) && num_bad++ < MAX_REPORTED)
+				printf("%s: lba %u holds %08X, expected %08X\n", name, start + i, sect[w], expected);
+		}
+	}
+
+	g_failed += num_bad;
+}
+
+// the zone as ZONE REPORT COMPACT gives it, and its data up to the page after the write pointer
+static void check_zone(const char* const name, zone_model_t const* const z, UINT32 const state)
+{
+	zone_report_desc_t desc;
+	UINT32 zone = z->zslba / ZONE_SIZE;
+	UINT32 buf_id = g_ftl_read_buf_id;
+	UINT32 wp = z->full ? z->zslba + ZONE_SIZE : z->zslba + z->written;
+
+	// the data begins at the sector offset of the LBA field, the start zone, and slot 0 is the header
+	ftl_read(ZONE_CMD_REPORT_COMPACT | zone, 1);
+	flash_finish();
+	sim_mem_read(RD_BUF_PTR(buf_id) + zone % SECTORS_PER_PAGE * BYTES_PER_SECTOR + sizeof(zone_report_hdr_t), &desc, sizeof(desc));
+
+	if (desc.zone_start_lba != z->zslba || desc.write_pointer != wp || (state != ANY_STATE && desc.zone_state != state) ||
+		(z->full && desc.zone_state != ZR_STATE_FULL))
+	{
+		printf("%s: zone %u is in state %u at %u, expected ", name, zone, desc.zone_state, desc.write_pointer - z->zslba);
+
+		if (z->full || state != ANY_STATE)
+			printf("%u at %u\n", z->full ? ZR_STATE_FULL : state, wp - z->zslba);
+		else
+			printf("%u\n", wp - z->zslba);
+
+		g_failed++;
+	}
+
+	check_data(name, z->zslba, MIN(ZONE_SIZE, (z->written / SECTORS_PER_PAGE + 2) * SECTORS_PER_PAGE), z->written, FALSE);
+}
+
+static void check_all(const char* const name)
+{
+	UINT32 i;
+
+	for (i = 0; i < g_num_zones; i++)
+	{
+		check_zone(name, &g_zone[i], ANY_STATE);
+	}
+
+	check_data(name, g_conv_lba, g_conv_sectors, g_conv_sectors, FALSE);
+}
+
+static void flush(void)
+{
+	UINT32 i;
+
+	ftl_flush();
+
+	for (i = 0; i < g_num_zones; i++)
+	{
+		g_zone[i].durable = g_zone[i].written;
+	}
+}
+
+// What was flushed survives, and so do the zone pages programmed since (the roll forward of load_metadata()).
+static void power_loss(void)
+{
+	UINT32 i;
+
+	flash_finish();
+	sim_power_loss();
+
+	for (i = 0; i < g_num_zones; i++)
+	{
+		zone_model_t* z = &g_zone[i];
+
+		if (z->full == FALSE)
+			z->written = MAX(z->durable, z->written / SECTORS_PER_PAGE * SECTORS_PER_PAGE);
+	}
+}
+
+// Partial pages in the zones next to the conventional zones, then a write and a read that run from the last
+// conventional page into the first sequential write zone: they must not reach the spilled pages.
+static void check_straddle(void)
+{
+	zone_model_t* first = new_zone();
+	UINT32 i;
+
+	if (NUM_CONV_ZONES == 0)
+		return;
+
+	for (i = 0; i < g_num_partial; i++)
+	{
+		zone_write(new_zone(), SECTORS_PER_PAGE / 2 + 1);
+	}
+
+	g_conv_lba = CONV_SECTORS - SECTORS_PER_PAGE / 8;
+	g_conv_sectors = CONV_SECTORS - g_conv_lba;
+
+	sim_host_write(g_conv_lba, g_conv_sectors + SECTORS_PER_PAGE + 8);
+	first->written = SECTORS_PER_PAGE + 8;
+
+	check_data("straddle", g_conv_lba, g_conv_sectors + 2 * SECTORS_PER_PAGE, g_conv_sectors + first->written, FALSE);
+
+	for (i = 0; i < g_num_zones; i++)
+	{
+		check_zone("straddle", &g_zone[i], ZR_STATE_OPEN);
+	}
+}
+
+// more partial pages than pool buffers (on a drive with enough zones), each read back from its spill
+// when its zone is written again
+static void check_spill(void)
+{
+	zone_model_t* z = &g_zone[g_num_zones];
+	UINT32 i;
+
+	for (i = 0; i < g_num_partial; i++)
+	{
+		zone_write(new_zone(), SECTORS_PER_PAGE / 2 + 3);
+	}
+
+	while (ftl_idle());
+
+	for (i = 0; i < g_num_partial; i++)
+	{
+		check_zone("spill", &z[i], ZR_STATE_OPEN);
+		zone_write(&z[i], SECTORS_PER_PAGE);
+	}
+
+	for (i = 0; i < g_num_partial; i++)
+	{
+		check_zone("spill", &z[i], ZR_STATE_OPEN);
+	}
+}
+
+static void check_close(void)
+{
+	zone_model_t* z = new_zone();
+
+	zone_write(z, 10);
+	zone_mgmt("close", z, ZM_CLOSE_ZONE);
+	check_zone("close", z, ZR_STATE_CLOSED);
+
+	zone_write(z, SECTORS_PER_PAGE);		// opened again
+	check_zone("close", z, ZR_STATE_OPEN);
+
+	zone_mgmt("close", z, ZM_CLOSE_ZONE);
+	check_zone("close", z, ZR_STATE_CLOSED);
+}
+
+static void check_finish(void)
+{
+	zone_model_t* z = new_zone();
+
+	zone_write(z, SECTORS_PER_PAGE + 20);
+	zone_mgmt("finish", z, ZM_FINISH_ZONE);
+	check_zone("finish", z, ZR_STATE_FULL);
+
+	sim_host_write(z->zslba + z->written, 3 * SECTORS_PER_PAGE);	// rejected, and all of its write buffers are released
+	check_zone("finish", z, ZR_STATE_FULL);
+}
+
+// the first append is at a page boundary, the others are not, and some of them span several write buffers
+static void check_append(void)
+{
+	zone_model_t* z = new_zone();
+
+	zone_append(z, 5);
+	zone_append(z, SECTORS_PER_PAGE + 7);
+	zone_append(z, 3);
+	zone_append(z, 2 * SECTORS_PER_PAGE);
+	check_zone("append", z, ZR_STATE_OPEN);
+}
+
+static void check_reset(void)
+{
+	zone_model_t* z = new_zone();
+
+	zone_write(z, 2 * SECTORS_PER_PAGE + 9);
+	zone_mgmt("reset", z, ZM_RESET_WP);
+	check_zone("reset", z, ZR_STATE_EMPTY);
+	check_data("reset", z->zslba, 3 * SECTORS_PER_PAGE, 0, FALSE);
+
+	zone_write(z, 9);
+	check_zone("reset", z, ZR_STATE_OPEN);
+}
+
+// Partial pages flushed, then written further in the same page and in the next one, or reset and written again,
+// before the power is lost. Every zone checked so far has been flushed with them.
+static void check_power_loss(void)
+{
+	zone_model_t* tail = new_zone();
+	zone_model_t* same_page = new_zone();
+	zone_model_t* next_page = new_zone();
+	zone_model_t* reset = new_zone();
+	zone_model_t* boundary = new_zone();
+
+	zone_write(tail, SECTORS_PER_PAGE + 36);
+	zone_write(same_page, 20);
+	zone_write(next_page, 20);
+	zone_write(reset, 20);
+	zone_write(boundary, 2 * SECTORS_PER_PAGE);
+	flush();
+
+	zone_write(same_page, 20);
+	zone_write(next_page, SECTORS_PER_PAGE - 4);
+	zone_mgmt("power loss", reset, ZM_RESET_WP);
+	zone_write(reset, 10);
+	check_all("before the power loss");
+
+	power_loss();
+	check_all("power loss");
+
+	zone_write(tail, SECTORS_PER_PAGE);
+	zone_write(same_page, 5);
+	check_all("after the power loss");
+
+	power_loss();
+	check_all("second power loss");
+}
+
+static void write_conv(UINT32 const num_sectors)
+{
+	UINT32 lba;
+
+	for (lba = 0; lba < num_sectors; lba += 4 * SECTORS_PER_PAGE)
+	{
+		sim_host_write(lba, MIN(num_sectors - lba, 4 * SECTORS_PER_PAGE));
+	}
+}
+
+// Conventional pages over more than a block of each bank (so that the page mapped blocks change on every bank)
+// and a partial page spilled by CLOSE, written since the last flush, before a power loss. They are written again
+// after it, into pages the FTL has to skip, and flushed this time.
+static void check_no_flush(void)
+{
+	zone_model_t* z = new_zone();
+	UINT32 num_sectors = (NUM_CONV_ZONES != 0) ? NO_FLUSH_PAGES * SECTORS_PER_PAGE : 0;
+
+	flush();
+
+	write_conv(num_sectors);
+	zone_write(z, SECTORS_PER_PAGE / 2);
+	zone_mgmt("no flush", z, ZM_CLOSE_ZONE);
+	check_data("no flush", 0, num_sectors, num_sectors, FALSE);
+	check_zone("no flush", z, ZR_STATE_CLOSED);
+
+	power_loss();
+	check_all("no flush");
+	check_data("no flush", 0, num_sectors, num_sectors, TRUE);
+
+	write_conv(num_sectors);
+	zone_write(z, SECTORS_PER_PAGE / 2 + 1);
+	check_data("after no flush", 0, num_sectors, num_sectors, FALSE);
+	check_zone("after no flush", z, ZR_STATE_OPEN);
+
+	flush();
+	power_loss();
+	check_all("flush after no flush");
+	check_data("flush after no flush", 0, num_sectors, num_sectors, FALSE);
+}
+
+UINT32 sim_zone_check(void)
+{
+	// the reported zones of a drive of OPTION_REDUCED_CAPACITY are fewer than NZONE
+	g_num_zones = 0;
+	g_num_partial = MIN(NUM_ZONE_BUFFERS + 8, (MIN(NZONE, NUM_LSECTORS / ZONE_SIZE) - NUM_CONV_ZONES - OTHER_ZONES) / 2);
+	g_conv_lba = g_conv_sectors = 0;
+	g_failed = 0;
+
+	check_straddle();
+	check_spill();
+	check_close();
+	check_finish();
+	check_append();
+	check_reset();
+	check_power_loss();
+	check_no_flush();
+
+	printf("zone check: %u zones, %u failed\n", g_num_zones, g_failed);
+
+	return g_failed;
+}
+
+#else
+
+UINT32 sim_zone_check(void)
+{
+	printf("zone check: ftl %s has no zones\n", SIM_FTL_NAME);
+
+	return 0;
+}
+
+#endif // FTL_ZONE_MGMT
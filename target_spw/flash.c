@@ -31,6 +31,8 @@ void flash_issue_cmd(UINT32 const bank, UINT32 const sync)
 	// You should not issue a new command when Waiting Room is not empty.
 	while ((GETREG(WR_STAT) & 0x00000001) != 0);
 
+	ftl_stat_flash_cmd(bank, GETREG(FCP_CMD), sync);
+
 	// If you write any value to FCP_ISSUE, FCP register contents are copied to Waiting Room.
 	// The hardware does not read FCP registers unless you write any value to FCP_ISSUE.
 	// The hardware never changes the values of FCP registers unless reset.
@@ -47,7 +49,11 @@ void flash_issue_cmd(UINT32 const bank, UINT32 const sync)
 		return;
 
 	// wail until the target bank finishes the command
+	UINT32 start_time = ftl_stat_time();
+
 	while (_BSP_FSM(rbank) != BANK_IDLE);
+
+	ftl_stat_lat(LAT_FLASH_WAIT, start_time);
 }
 
 void flash_copy(UINT32 const bank, UINT32 const dst_row, UINT32 const src_row)
@@ -62,6 +68,7 @@ void flash_copy(UINT32 const bank, UINT32 const dst_row, UINT32 const src_row)
 	SETREG(FCP_DST_ROW_H, dst_row);
 	SETREG(FCP_DST_ROW_L, dst_row);
 	while ((GETREG(WR_STAT) & 0x00000001) != 0);
+	ftl_stat_flash_cmd(bank, FC_COPYBACK, RETURN_ON_ISSUE);
 	SETREG(FCP_ISSUE, NULL);
 }
 
@@ -82,6 +89,7 @@ void flash_modify_copy(UINT32 const bank, UINT32 const dst_row, UINT32 const src
 	SETREG(FCP_DST_ROW_H, dst_row);
 	SETREG(FCP_DST_ROW_L, dst_row);
 	while ((GETREG(WR_STAT) & 0x00000001) != 0);
+	ftl_stat_flash_cmd(bank, FC_MODIFY_COPYBACK, RETURN_ON_ISSUE);
 	SETREG(FCP_ISSUE, NULL);
 }
 
@@ -95,13 +103,18 @@ void flash_erase(UINT32 const bank, UINT16 const vblk_offset)
 	SETREG(FCP_ROW_H(bank), vblk_offset * PAGES_PER_VBLK);
 	SETREG(FCP_ROW_L(bank), vblk_offset * PAGES_PER_VBLK);
 	while ((GETREG(WR_STAT) & 0x00000001) != 0);
+	ftl_stat_flash_cmd(bank, FC_ERASE, RETURN_ON_ISSUE);
 	SETREG(FCP_ISSUE, NULL);
 }
 
 void flash_finish(void)
 {
+	UINT32 start_time = ftl_stat_time();
+
 	// When the value of MON_CHABANKIDLE is zero, Waiting Room is empty and all the banks are idle.
 	while (GETREG(MON_CHABANKIDLE) != 0);
+
+	ftl_stat_lat(LAT_FLASH_WAIT, start_time);
 }
 
 void flash_clear_irq(void)
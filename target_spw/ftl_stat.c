@@ -0,0 +1,196 @@
+// Copyright 2011 INDILINX Co., Ltd.
+//
+// This file is part of Jasmine.
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Jasmine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Jasmine. See the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//
+// FTL statistics common to all FTLs (see ftl_stat.h)
+
+
+#include "jasmine.h"
+
+// timer ticks (CLOCK_SPEED / 2 / 16 per second) to microseconds
+#define TICKS_TO_US(TICKS)		((UINT32)((UINT64)(TICKS) * 2 * 16 * 1000000 / CLOCK_SPEED))
+
+ftl_stat_t g_ftl_stat;
+ftl_lat_t g_ftl_lat;
+
+static UINT32 g_gc_start[NUM_BANKS];	// FTL_STAT_TIMER value at ftl_stat_gc_begin()
+static BOOL8 g_in_gc[NUM_BANKS];
+static UINT32 g_trace_count;
+
+void ftl_stat_init(void)
+{
+	UINT32 bank;
+
+	mem_set_sram(&g_ftl_stat, 0, sizeof(g_ftl_stat));
+
+	g_ftl_stat.signature = FTL_STAT_SIGNATURE;
+	g_ftl_stat.version = FTL_STAT_VERSION;
+	g_ftl_stat.num_banks = NUM_BANKS;
+	g_ftl_stat.sectors_per_page = SECTORS_PER_PAGE;
+	g_ftl_stat.pages_per_vblk = PAGES_PER_VBLK;
+	g_ftl_stat.vblks_per_bank = VBLKS_PER_BANK;
+
+	for (bank = 0; bank < NUM_BANKS; bank++)
+	{
+		g_ftl_stat.bank[bank].free_blk_min = INVALID32;
+		g_in_gc[bank] = FALSE;
+	}
+
+	mem_set_sram(&g_ftl_lat, 0, sizeof(g_ftl_lat));
+
+	g_ftl_lat.signature = FTL_LAT_SIGNATURE;
+	g_ftl_lat.version = FTL_LAT_VERSION;
+	g_ftl_lat.num_hists = NUM_LAT_HISTS;
+	g_ftl_lat.timer_hz = FTL_STAT_TIMER_HZ;
+
+	g_trace_count = 0;
+
+	start_interval_measurement(FTL_STAT_TIMER, TIMER_PRESCALE_1);
+}
+
+#if OPTION_FLASH_TRACE
+static void trace_flash_cmd(UINT32 const bank, UINT32 const cmd, UINT32 const sync)
+{
+	flash_trace_t entry;
+
+	entry.time = GET_TIMER_VALUE(FTL_STAT_TIMER);
+	entry.row = GETREG(FCP_ROW_L(bank));
+	entry.dma_addr = GETREG(FCP_DMA_ADDR);
+	entry.dma_sects = (UINT8) (GETREG(FCP_DMA_CNT) / BYTES_PER_SECTOR);
+	entry.cmd = (UINT8) cmd;
+	entry.bank = (UINT8) bank;
+	entry.flags = (UINT8) (sync | ((GETREG(FCP_OPTION) & FO_P) ? 4 : 0));
+
+	mem_copy(FLASH_TRACE_ADDR + (g_trace_count % FLASH_TRACE_ENTRIES) * sizeof(flash_trace_t), &entry, sizeof(flash_trace_t));
+
+	g_trace_count++;
+}
+#endif
+
+void ftl_stat_trace_header(flash_trace_hdr_t* const hdr)
+{
+	UINT32 bank;
+
+	mem_set_sram(hdr, 0, sizeof(flash_trace_hdr_t));
+
+	hdr->signature = FLASH_TRACE_SIGNATURE;
+	hdr->version = FLASH_TRACE_VERSION;
+	hdr->entry_bytes = sizeof(flash_trace_t);
+	hdr->num_entries = FLASH_TRACE_ENTRIES;
+	hdr->count = g_trace_count;
+	hdr->timer_hz = FTL_STAT_TIMER_HZ;
+	hdr->num_banks = NUM_BANKS;
+	hdr->num_chnls = NUM_CHNLS_MAX;
+	hdr->sectors_per_page = SECTORS_PER_PAGE;
+
+	for (bank = 0; bank < NUM_BANKS; bank++)
+	{
+		hdr->rbank[bank] = REAL_BANK(bank);
+	}
+}
+
+// called for every flash command issued through flash.c, before FCP_ISSUE
+void ftl_stat_flash_cmd(UINT32 const bank, UINT32 const cmd, UINT32 const sync)
+{
+	ftl_bank_stat_t* stat = &g_ftl_stat.bank[bank];
+
+	#if OPTION_FLASH_TRACE
+	trace_flash_cmd(bank, cmd, sync);
+	#endif
+
+	switch (cmd)
+	{
+		case FC_COL_ROW_IN_PROG:
+		case FC_IN_PROG:
+		case FC_PROG:
+			stat->nand_write++;
+			break;
+		case FC_COL_ROW_READ_OUT:
+		case FC_COL_ROW_READ:
+			stat->nand_read++;
+			break;
+		case FC_COPYBACK:
+		case FC_MODIFY_COPYBACK:
+			stat->copyback++;
+			break;
+		case FC_ERASE:
+			stat->erase++;
+			return;
+		default:
+			return;
+	}
+
+	if (g_in_gc[bank] && cmd != FC_COL_ROW_READ_OUT && cmd != FC_COL_ROW_READ)
+	{
+		stat->gc_write++;
+	}
+}
+
+void ftl_stat_gc_begin(UINT32 const bank)
+{
+	ASSERT(bank < NUM_BANKS);
+
+	g_ftl_stat.bank[bank].gc_cnt++;
+	g_gc_start[bank] = GET_TIMER_VALUE(FTL_STAT_TIMER);
+	g_in_gc[bank] = TRUE;
+}
+
+void ftl_stat_gc_end(UINT32 const bank)
+{
+	// The timer counts down and wraps around, so the unsigned difference is correct across one wrap.
+	UINT32 ticks = g_gc_start[bank] - GET_TIMER_VALUE(FTL_STAT_TIMER);
+
+	g_ftl_stat.bank[bank].gc_time_us += TICKS_TO_US(ticks);
+	g_in_gc[bank] = FALSE;
+
+	ftl_stat_lat(LAT_GC, g_gc_start[bank]);
+}
+
+// called when the number of free blocks of a bank decreases
+void ftl_stat_free_blks(UINT32 const bank, UINT32 const num_free_blks)
+{
+	if (num_free_blks < g_ftl_stat.bank[bank].free_blk_min)
+	{
+		g_ftl_stat.bank[bank].free_blk_min = num_free_blks;
+	}
+}
+
+// add one sample (from the ftl_stat_time() value 'start' to now) to a latency histogram
+void ftl_stat_lat(UINT32 const hist, UINT32 const start)
+{
+	ftl_lat_hist_t* h = &g_ftl_lat.hist[hist];
+	UINT32 ticks = start - GET_TIMER_VALUE(FTL_STAT_TIMER);
+	UINT32 val = ticks;
+	UINT32 bucket = 0;
+
+	// ARM7TDMI has no CLZ instruction
+	if (val >> 16) { bucket += 16; val >>= 16; }
+	if (val >> 8)  { bucket += 8;  val >>= 8; }
+	if (val >> 4)  { bucket += 4;  val >>= 4; }
+	if (val >> 2)  { bucket += 2;  val >>= 2; }
+	if (val >> 1)  { bucket += 1;  val >>= 1; }
+
+	bucket += val;	// floor(log2(ticks)) + 1, or 0 if ticks == 0
+
+	h->bucket[MIN(bucket, NUM_LAT_BUCKETS - 1)]++;
+	h->total += ticks;
+
+	if (ticks > h->max)
+	{
+		h->max = ticks;
+	}
+}
@@ -0,0 +1,237 @@
+// Copyright 2011 INDILINX Co., Ltd.
+//
+// This file is part of Jasmine.
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Jasmine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Jasmine. See the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//
+// FTL statistics common to all FTLs
+//
+// Flash commands are counted in flash.c, host commands in Main(), and each FTL reports
+// its garbage collection and free block count through ftl_stat_gc_begin()/ftl_stat_gc_end()
+// and ftl_stat_free_blks(). The host reads the whole structure with READ LOG EXT
+// (log address FTL_STAT_LOG_ADDR, one 512-byte log page per command).
+//
+// Latency histograms (log address FTL_LAT_LOG_ADDR) have log2 buckets of FTL_STAT_TIMER ticks:
+// bucket 0 counts zero-tick samples and bucket N (N >= 1) counts samples of 2^(N-1) ~ 2^N - 1 ticks.
+// A code path is measured with
+//
+//	UINT32 t = ftl_stat_time();
+//	...
+//	ftl_stat_lat(LAT_FTL_WRITE, t);
+//
+// With OPTION_FLASH_TRACE, every flash command issued through flash.c is also recorded in a ring
+// of FLASH_TRACE_ENTRIES entries at FLASH_TRACE_ADDR (each FTL reserves it in its DRAM segmentation).
+// Log FLASH_TRACE_LOG_ADDR is flash_trace_hdr_t in page 0 followed by the ring in pages 1 ~ .
+// The ring is not frozen while the host reads it. target_sim/flash_trace.c decodes a dump.
+//
+// An FTL that defines FTL_ZONE_APPEND (ftl_zns) reports the LBA it assigned to each Zone Append command
+// in log ZONE_APPEND_LOG_ADDR: zone_append_hdr_t in page 0 followed by a ring of ZONE_APPEND_ENTRIES entries
+// in pages 1 ~ , kept at ZONE_APPEND_ADDR. The commands are completed before the FTL takes them out of the event queue,
+// so the host matches the entries with its commands in submission order.
+// Its Simple Copy commands (ZC_SIMPLE_COPY in include/sata.h) are reported the same way in log SIMPLE_COPY_LOG_ADDR,
+// a zone_append_hdr_t followed by a ring of SIMPLE_COPY_ENTRIES simple_copy_t at SIMPLE_COPY_ADDR.
+
+#ifndef FTL_STAT_H
+#define FTL_STAT_H
+
+#define FTL_STAT_LOG_ADDR		0xA0			// READ LOG EXT log address (0xA0 ~ 0xDF: device vendor specific)
+#define FTL_STAT_SIGNATURE		0x54534A46		// "FJST"
+#define FTL_STAT_VERSION		1
+#define FTL_STAT_LOG_PAGES		((sizeof(ftl_stat_t) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR)
+
+#define FTL_STAT_TIMER			TIMER_CH2		// free running, TIMER_PRESCALE_1 (182ns per tick, wraps every 785 seconds)
+#define FTL_STAT_TIMER_HZ		(CLOCK_SPEED / 2 / 16)
+
+#define FTL_LAT_LOG_ADDR		0xA1
+#define FTL_LAT_SIGNATURE		0x544C4A46		// "FJLT"
+#define FTL_LAT_VERSION			1
+#define FTL_LAT_LOG_PAGES		((sizeof(ftl_lat_t) + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR)
+#define NUM_LAT_BUCKETS			32				// the last bucket also counts everything above it
+
+#define FLASH_TRACE_LOG_ADDR	0xA2
+#define FLASH_TRACE_SIGNATURE	0x52544A46		// "FJTR"
+#define FLASH_TRACE_VERSION		1
+#define FLASH_TRACE_ENTRY_BYTES	16
+#if OPTION_FLASH_TRACE
+#define FLASH_TRACE_ENTRIES		65536
+#else
+#define FLASH_TRACE_ENTRIES		0
+#endif
+#define FLASH_TRACE_BYTES		(FLASH_TRACE_ENTRIES * FLASH_TRACE_ENTRY_BYTES)
+#define FLASH_TRACE_LOG_PAGES	(1 + FLASH_TRACE_BYTES / BYTES_PER_SECTOR)
+
+#define ZONE_APPEND_LOG_ADDR	0xA3
+#define ZONE_APPEND_SIGNATURE	0x415A4A46		// "FJZA"
+#define ZONE_APPEND_VERSION		1
+#define ZONE_APPEND_ENTRY_BYTES	16
+#define ZONE_APPEND_ENTRIES		1024
+#define ZONE_APPEND_BYTES		(BYTES_PER_SECTOR + ZONE_APPEND_ENTRIES * ZONE_APPEND_ENTRY_BYTES)	// header page and ring
+#define ZONE_APPEND_LOG_PAGES	(ZONE_APPEND_BYTES / BYTES_PER_SECTOR)
+
+// zone_append_t status
+#define ZONE_APPEND_OK			0
+#define ZONE_APPEND_INVALID		1				// the LBA is not the start of a sequential write zone
+#define ZONE_APPEND_FULL		2				// the data does not fit into the rest of the zone
+#define ZONE_APPEND_BUSY		3				// the zone is under compaction (TL_OPEN)
+#define ZONE_APPEND_NOT_OPEN	4				// the zone cannot be opened (every open zone id is held by a TL_OPEN zone)
+
+#define SIMPLE_COPY_LOG_ADDR	0xA4
+#define SIMPLE_COPY_SIGNATURE	0x43534A46		// "FJSC"
+#define SIMPLE_COPY_VERSION		1
+#define SIMPLE_COPY_ENTRY_BYTES	16
+#define SIMPLE_COPY_ENTRIES		256
+#define SIMPLE_COPY_BYTES		(BYTES_PER_SECTOR + SIMPLE_COPY_ENTRIES * SIMPLE_COPY_ENTRY_BYTES)	// header page and ring
+#define SIMPLE_COPY_LOG_PAGES	(SIMPLE_COPY_BYTES / BYTES_PER_SECTOR)
+
+// simple_copy_t status
+#define SIMPLE_COPY_OK			0
+#define SIMPLE_COPY_INVALID		1				// the destination is not an empty, open or closed zone with its write pointer on a page boundary
+#define SIMPLE_COPY_RANGE		2				// source range num_ranges is not in the programmed pages of a sequential write zone
+#define SIMPLE_COPY_FULL		3				// source range num_ranges does not fit into the rest of the destination zone
+
+// latency histograms
+#define LAT_FTL_READ			0				// ftl_read() (returns when the last read command is issued)
+#define LAT_FTL_WRITE			1				// ftl_write()
+#define LAT_GC					2				// garbage_collection()
+#define LAT_PMAP_LOG			3				// logging_pmap_table()
+#define LAT_FLASH_WAIT			4				// flash_finish() and flash_issue_cmd(RETURN_WHEN_DONE) waiting for the banks
+#define NUM_LAT_HISTS			5
+
+// all counters are reset when the firmware boots
+typedef struct
+{
+	UINT64	gc_time_us;			// time spent in garbage collection
+	UINT32	nand_read;			// page read commands (FC_*_READ*)
+	UINT32	nand_write;			// page program commands (FC_*_PROG), copybacks excluded
+	UINT32	copyback;			// FC_COPYBACK and FC_MODIFY_COPYBACK
+	UINT32	erase;				// FC_ERASE
+	UINT32	gc_cnt;				// garbage collection invocations
+	UINT32	gc_write;			// programs and copybacks issued by garbage collection
+	UINT32	free_blk_min;		// lowest number of free blocks seen so far, INVALID32 if never reported
+	UINT32	reserved;
+}
+ftl_bank_stat_t;
+
+typedef struct
+{
+	UINT32	signature;
+	UINT16	version;
+	UINT16	num_banks;
+	UINT16	sectors_per_page;
+	UINT16	pages_per_vblk;
+	UINT32	vblks_per_bank;
+	UINT64	host_read_sects;
+	UINT64	host_write_sects;
+	ftl_bank_stat_t	bank[NUM_BANKS];	// indexed by virtual bank number
+}
+ftl_stat_t;
+
+typedef struct
+{
+	UINT64	total;				// sum of all samples in ticks
+	UINT32	max;				// longest sample in ticks
+	UINT32	reserved;
+	UINT32	bucket[NUM_LAT_BUCKETS];
+}
+ftl_lat_hist_t;
+
+typedef struct
+{
+	UINT32	signature;
+	UINT16	version;
+	UINT16	num_hists;
+	UINT32	timer_hz;			// ticks per second
+	UINT32	reserved;
+	ftl_lat_hist_t	hist[NUM_LAT_HISTS];	// indexed by LAT_*
+}
+ftl_lat_t;
+
+// one issued flash command
+typedef struct
+{
+	UINT32	time;				// FTL_STAT_TIMER value (counts down)
+	UINT32	row;				// FCP_ROW_L
+	UINT32	dma_addr;			// FCP_DMA_ADDR (not significant for FC_ERASE and FC_COPYBACK)
+	UINT8	dma_sects;			// FCP_DMA_CNT in sectors
+	UINT8	cmd;				// FC_*
+	UINT8	bank;				// virtual bank number
+	UINT8	flags;				// bit 1:0 = RETURN_ON_ISSUE/ACCEPT/WHEN_DONE, bit 2 = FO_P
+}
+flash_trace_t;
+
+typedef struct
+{
+	UINT32	signature;
+	UINT16	version;
+	UINT16	entry_bytes;		// sizeof(flash_trace_t)
+	UINT32	num_entries;		// ring size
+	UINT32	count;				// commands recorded since boot; the newest one is at (count - 1) % num_entries
+	UINT32	timer_hz;
+	UINT16	num_banks;
+	UINT16	num_chnls;			// the channel of a real bank is rbank % num_chnls
+	UINT16	sectors_per_page;
+	UINT16	reserved;
+	UINT8	rbank[NUM_BANKS_MAX];	// real bank number of each virtual bank
+}
+flash_trace_hdr_t;
+
+// one Zone Append command
+typedef struct
+{
+	UINT32	zslba;				// start LBA of the zone, as given by the host
+	UINT32	lba;				// LBA assigned to the first sector, INVALID32 if the command failed
+	UINT32	num_sectors;
+	UINT32	status;				// ZONE_APPEND_*
+}
+zone_append_t;
+
+typedef struct
+{
+	UINT32	signature;
+	UINT16	version;
+	UINT16	entry_bytes;		// sizeof(zone_append_t)
+	UINT32	num_entries;		// ring size
+	UINT32	count;				// commands recorded since boot; the newest one is at (count - 1) % num_entries
+	UINT32	zone_sectors;
+	UINT32	reserved;
+}
+zone_append_hdr_t;
+
+// one Simple Copy command
+// The ranges are copied in order up to the first one that fails, so num_ranges and num_sectors tell how far the copy went.
+typedef struct
+{
+	UINT32	zslba;				// start LBA of the destination zone
+	UINT32	lba;				// LBA of the first copied sector (write pointer of the destination zone before the copy)
+	UINT32	num_sectors;		// sectors copied
+	UINT16	num_ranges;			// source ranges copied
+	UINT16	status;				// SIMPLE_COPY_*
+}
+simple_copy_t;
+
+extern ftl_stat_t g_ftl_stat;
+extern ftl_lat_t g_ftl_lat;
+
+#define ftl_stat_time()			GET_TIMER_VALUE(FTL_STAT_TIMER)
+
+void	ftl_stat_init(void);
+void	ftl_stat_flash_cmd(UINT32 const bank, UINT32 const cmd, UINT32 const sync);
+void	ftl_stat_trace_header(flash_trace_hdr_t* const hdr);
+void	ftl_stat_gc_begin(UINT32 const bank);
+void	ftl_stat_gc_end(UINT32 const bank);
+void	ftl_stat_free_blks(UINT32 const bank, UINT32 const num_free_blks);
+void	ftl_stat_lat(UINT32 const hist, UINT32 const start);
+
+#endif	// FTL_STAT_H
@@ -131,6 +131,7 @@ void init_jasmine(void)
 	#endif
 
     ftl_open();
+    ftl_stat_init();
 
 	#if OPTION_FTL_TEST == TRUE
 	extern void ftl_test();
@@ -47,6 +47,8 @@ void led_blink(void)
 	}
 }
 
+#ifndef PROGRAM_HOST_SIM
+
 #if OPTION_ENABLE_ASSERT
 volatile UINT32 g_barrier2;
 #endif
@@ -133,6 +135,8 @@ __irq void irq_handler(void)
 	}
 }
 
+#endif	// PROGRAM_HOST_SIM
+
 #include <stdlib.h>
 
 typedef struct
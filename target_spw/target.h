@@ -58,11 +58,26 @@
 #define SRAM_BASE		0x10000000		// before remap
 #define ROM_BASE		0x10000000		// after remap
 
+#ifdef PROGRAM_HOST_SIM
+
+// host-native build (build_host): every register access goes to the software model in target_sim
+#include "sim.h"
+
+#define SETREG(ADDR, VAL)	sim_setreg((UINT32)(ADDR), (UINT32)(VAL))
+#define GETREG(ADDR)		sim_getreg((UINT32)(ADDR))
+
+// Firmware variables live in the host process image below DRAM_BASE.
+#define SRAM_SIZE		DRAM_BASE
+
+#else
+
 #define SETREG(ADDR, VAL)	*(volatile UINT32*)(ADDR) = (UINT32)(VAL)
 #define GETREG(ADDR)		(*(volatile UINT32*)(ADDR))
 
 #define SRAM_SIZE		(96*1024)
 
+#endif
+
 #if NAND_SPEC_SPEED == NAND_SPEC_VERY_FAST
 #define PS_PER_FLASH_CYCLE 	20000	// pico seconds
 #elif NAND_SPEC_SPEED == NAND_SPEC_FAST
@@ -156,7 +171,7 @@
 // interrupt
 ///////////////
 
-#ifdef __GNUC__
+#if defined(__GNUC__) || defined(PROGRAM_HOST_SIM)
 
 UINT32 disable_irq(void);
 void enable_irq(void);
@@ -175,7 +190,15 @@ void enable_fiq(void);
 void enable_interrupt(void);
 void disable_interrupt(void);
 
-#if OPTION_ENABLE_ASSERT
+#if OPTION_ENABLE_ASSERT && defined(PROGRAM_HOST_SIM)
+	#define ASSERT(X)				       \
+	{								       \
+		if (!(X))					       \
+		{                                  \
+			sim_assert_fail(__FILE__, __LINE__); \
+		}							       \
+	}
+#elif OPTION_ENABLE_ASSERT
 	#define ASSERT(X)				       \
 	{								       \
 		if (!(X))					       \